@@ -0,0 +1,520 @@
+/** @file
+  Compare the streaming DEBUG() path of BaseDebugLibSerialPortMp with the
+  buffered path it replaced.
+
+  The buffered path is reproduced here as LegacyDebugPrint: format into a
+  MAX_DEBUG_MESSAGE_LENGTH stack buffer, AsciiStrLen, SerialPortWrite. Both
+  paths write to the same SerialPortLib instance. UnitTestPkgBenchmark.dsc
+  links MemorySerialPortLib, so the cycles are those of the logging path
+  rather than of the UART. With a real UART the write dominates them; the
+  stack figures do not depend on it. The truncated case is longer than the
+  buffer of the buffered path. The filtered case uses a level that is off,
+  where the streaming path returns before the console lock and the buffered
+  path does not.
+
+  Each case is measured on the BSP alone, then with every enabled AP logging
+  at once through EFI_MP_SERVICES_PROTOCOL: messages per second of all APs
+  together, and the time an AP waits for the console lock, estimated as its
+  cycles per message beyond those of the BSP alone.
+
+  "DebugLibBenchApp level <Mask> [<ModuleGuid>]" writes the
+  DEBUG_LEVEL_CONTROL block at PcdDebugLevelControlAddress instead: it sets
+  the mask of every module, or of the module with FILE_GUID ModuleGuid.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DebugPrintErrorLevelLib.h>
+#include <Library/PrintLib.h>
+#include <Library/SerialPortLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Protocol/ShellParameters.h>
+#include <Protocol/MpService.h>
+#include <DebugLevelControl.h>
+
+#define DEBUG_LIB_BENCH_SAMPLES         FixedPcdGet32 (PcdDebugLibBenchSamples)
+#define DEBUG_LIB_BENCH_PAINT_SIZE      SIZE_8KB
+#define DEBUG_LIB_BENCH_LONG_LENGTH     200
+#define DEBUG_LIB_BENCH_TRUNCATED_LENGTH  400
+#define DEBUG_LIB_BENCH_CALIBRATE_US    1000
+
+//
+// Message length limit of the buffered path.
+//
+#define LEGACY_MAX_DEBUG_MESSAGE_LENGTH 0x100
+
+typedef
+VOID
+(EFIAPI *DEBUG_LIB_BENCH_PRINT)(
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  );
+
+typedef enum {
+  BenchCaseLiteral,
+  BenchCaseMixed,
+  BenchCaseLong,
+  BenchCaseTruncated,
+  BenchCaseFiltered,
+  BenchCaseMax
+} DEBUG_LIB_BENCH_CASE;
+
+STATIC CONST CHAR8  *mCaseName[BenchCaseMax] = {
+  "short literal",
+  "mixed arguments",
+  "long string",
+  "truncated string",
+  "filtered out"
+};
+
+typedef struct {
+  DEBUG_LIB_BENCH_PRINT     PrintFunction;
+  DEBUG_LIB_BENCH_CASE      Case;
+  EFI_MP_SERVICES_PROTOCOL  *Mp;
+  UINTN                     ApCount;
+  volatile UINT32           *Arrived;
+  //
+  // Per processor logging time in TSC cycles, MP_BENCH_SLOT_STRIDE
+  // UINT64s apart.
+  //
+  volatile UINT64           *Cycles;
+} DEBUG_LIB_BENCH_CONCURRENT;
+
+SPIN_LOCK    mLegacyLock;
+//
+// DEBUG_LIB_BENCH_TRUNCATED_LENGTH characters, the long case prints its
+// tail.
+//
+CHAR8        mLongString[DEBUG_LIB_BENCH_TRUNCATED_LENGTH + 1];
+UINTN        mLegacyWritten;
+UINTN        mFilteredLevel;
+UINT64       mTscMhz;
+
+/**
+  The buffered DEBUG() path of BaseDebugLibSerialPortMp before streaming,
+  folded into one function.
+
+  @param  ErrorLevel  The error level of the debug message.
+  @param  Format      Format string for the debug message to print.
+  @param  ...         Variable argument list.
+**/
+VOID
+EFIAPI
+LegacyDebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+  CHAR8    Buffer[LEGACY_MAX_DEBUG_MESSAGE_LENGTH];
+  VA_LIST  Marker;
+
+  AcquireSpinLock (&mLegacyLock);
+
+  if ((ErrorLevel & GetDebugPrintErrorLevel ()) != 0) {
+    VA_START (Marker, Format);
+    AsciiVSPrint (Buffer, sizeof (Buffer), Format, Marker);
+    VA_END (Marker);
+
+    mLegacyWritten = AsciiStrLen (Buffer);
+    SerialPortWrite ((UINT8 *)Buffer, mLegacyWritten);
+  }
+
+  ReleaseSpinLock (&mLegacyLock);
+}
+
+/**
+  Print the message of one benchmark case.
+
+  @param[in]  PrintFunction   DebugPrint or LegacyDebugPrint.
+  @param[in]  Case            The benchmark case.
+**/
+VOID
+DebugLibBenchPrint (
+  IN DEBUG_LIB_BENCH_PRINT  PrintFunction,
+  IN DEBUG_LIB_BENCH_CASE   Case
+  )
+{
+  switch (Case) {
+  case BenchCaseLiteral:
+    PrintFunction (DEBUG_ERROR, "DebugLib bench: short literal message\n");
+    break;
+
+  case BenchCaseMixed:
+    PrintFunction (
+      DEBUG_ERROR,
+      "DebugLib bench: Ap 0x%x done, MagicNum = 0x%08x, Status = %r, Ticks = %ld, Name = %a\n",
+      (UINTN) 3,
+      (UINTN) 0x1234,
+      EFI_TIMEOUT,
+      (UINT64) 1234567890,
+      "SingleApAsyncProcedure"
+      );
+    break;
+
+  case BenchCaseLong:
+    PrintFunction (DEBUG_ERROR, "DebugLib bench: %a\n", mLongString + DEBUG_LIB_BENCH_TRUNCATED_LENGTH - DEBUG_LIB_BENCH_LONG_LENGTH);
+    break;
+
+  case BenchCaseTruncated:
+    PrintFunction (DEBUG_ERROR, "DebugLib bench: %a\n", mLongString);
+    break;
+
+  default:
+    PrintFunction (mFilteredLevel, "DebugLib bench: filtered message %d\n", (UINTN) Case);
+    break;
+  }
+}
+
+/**
+  Measure one path on one case.
+
+  @param[in]  Label           Name of the path.
+  @param[in]  PrintFunction   DebugPrint or LegacyDebugPrint.
+  @param[in]  Case            The benchmark case.
+
+  @return Mean cycles per message.
+**/
+UINT64
+DebugLibBenchRun (
+  IN CONST CHAR16           *Label,
+  IN DEBUG_LIB_BENCH_PRINT  PrintFunction,
+  IN DEBUG_LIB_BENCH_CASE   Case
+  )
+{
+  MP_BENCH_STATS            Cycles;
+  MP_BENCH_STATS            Stack;
+  MP_BENCH_STACK_PAINT      Paint;
+  UINTN                     Sample;
+  UINTN                     Used;
+  UINT64                    Start;
+  UINT64                    End;
+
+  MpBenchStatsReset (&Cycles);
+  MpBenchStatsReset (&Stack);
+
+  for (Sample = 0; Sample < DEBUG_LIB_BENCH_SAMPLES; Sample++) {
+    MpBenchStackPaint (&Paint, DEBUG_LIB_BENCH_PAINT_SIZE);
+    Start = AsmReadTsc ();
+    DebugLibBenchPrint (PrintFunction, Case);
+    End   = AsmReadTsc ();
+    Used  = MpBenchStackScan (&Paint);
+
+    MpBenchStatsAdd (&Cycles, End - Start);
+    if (Used != MP_BENCH_STACK_OVERFLOW) {
+      MpBenchStatsAdd (&Stack, Used);
+    }
+  }
+
+  Print (
+    L"  %-8s cycles min %ld mean %ld max %ld, stack max %ld bytes\n",
+    Label,
+    Cycles.Min,
+    MpBenchStatsMean (&Cycles),
+    Cycles.Max,
+    Stack.Max
+    );
+
+  return MpBenchStatsMean (&Cycles);
+}
+
+/**
+  AP procedure: wait for the other APs, then log DEBUG_LIB_BENCH_SAMPLES
+  messages of one case and record the time it took.
+
+  @param[in]  ProcedureArgument   The DEBUG_LIB_BENCH_CONCURRENT.
+**/
+VOID
+EFIAPI
+DebugLibBenchApProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  DEBUG_LIB_BENCH_CONCURRENT  *Concurrent;
+  UINTN                       ProcessorIndex;
+  UINTN                       Sample;
+  UINT64                      Start;
+
+  Concurrent = (DEBUG_LIB_BENCH_CONCURRENT *)ProcedureArgument;
+  if (EFI_ERROR (Concurrent->Mp->WhoAmI (Concurrent->Mp, &ProcessorIndex))) {
+    return;
+  }
+
+  if (!MpBenchBarrierWait (Concurrent->Arrived, Concurrent->ApCount)) {
+    return;
+  }
+
+  Start = AsmReadTsc ();
+  for (Sample = 0; Sample < DEBUG_LIB_BENCH_SAMPLES; Sample++) {
+    DebugLibBenchPrint (Concurrent->PrintFunction, Concurrent->Case);
+  }
+  Concurrent->Cycles[ProcessorIndex * MP_BENCH_SLOT_STRIDE] = AsmReadTsc () - Start;
+}
+
+/**
+  Measure one path on one case with every enabled AP logging at once.
+
+  The console lock sits inside the DebugLib instance and cannot be timed
+  from here. The cycles per message beyond SingleCycles are printed as an
+  estimate of the lock wait, cache line transfers included.
+
+  @param[in]  Label           Name of the path.
+  @param[in]  Concurrent      The AP procedure argument, Mp, ApCount,
+                              Arrived and Cycles set.
+  @param[in]  PrintFunction   DebugPrint or LegacyDebugPrint.
+  @param[in]  Case            The benchmark case.
+  @param[in]  SingleCycles    Cycles per message on the BSP alone.
+  @param[in]  CpuCount        Number of processors.
+**/
+VOID
+DebugLibBenchRunConcurrent (
+  IN CONST CHAR16                    *Label,
+  IN DEBUG_LIB_BENCH_CONCURRENT      *Concurrent,
+  IN DEBUG_LIB_BENCH_PRINT           PrintFunction,
+  IN DEBUG_LIB_BENCH_CASE            Case,
+  IN UINT64                          SingleCycles,
+  IN UINTN                           CpuCount
+  )
+{
+  EFI_STATUS                Status;
+  MP_BENCH_STATS            PerMessage;
+  UINT64                    Slowest;
+  UINT64                    Cycles;
+  UINT64                    Rate;
+  UINTN                     Index;
+
+  Concurrent->PrintFunction = PrintFunction;
+  Concurrent->Case          = Case;
+  *Concurrent->Arrived      = 0;
+  ZeroMem ((VOID *) Concurrent->Cycles, CpuCount * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+
+  Status = Concurrent->Mp->StartupAllAPs (Concurrent->Mp, DebugLibBenchApProcedure, FALSE, NULL, 0, Concurrent, NULL);
+  if (EFI_ERROR (Status)) {
+    Print (L"  %-8s StartupAllAPs: %r\n", Label, Status);
+    return;
+  }
+
+  MpBenchStatsReset (&PerMessage);
+  Slowest = 0;
+  for (Index = 0; Index < CpuCount; Index++) {
+    Cycles = Concurrent->Cycles[Index * MP_BENCH_SLOT_STRIDE];
+    if (Cycles != 0) {
+      MpBenchStatsAdd (&PerMessage, DivU64x32 (Cycles, DEBUG_LIB_BENCH_SAMPLES));
+      Slowest = MAX (Slowest, Cycles);
+    }
+  }
+  if (PerMessage.Count != Concurrent->ApCount) {
+    Print (L"  %-8s 0x%x of 0x%x Aps logged, skipped\n", Label, PerMessage.Count, Concurrent->ApCount);
+    return;
+  }
+
+  //
+  // The APs start together, the slowest one bounds the run.
+  //
+  Rate = DivU64x64Remainder (
+           MultU64x64 (MultU64x32 (Concurrent->ApCount, DEBUG_LIB_BENCH_SAMPLES), MultU64x32 (mTscMhz, 1000000)),
+           MAX (Slowest, 1),
+           NULL
+           );
+  Print (
+    L"  %-8s 0x%x Aps: cycles per message mean %ld max %ld, %ld messages/s, %ld cycles above the BSP alone (lock wait estimate)\n",
+    Label,
+    Concurrent->ApCount,
+    MpBenchStatsMean (&PerMessage),
+    PerMessage.Max,
+    Rate,
+    MpBenchStatsMean (&PerMessage) - MIN (MpBenchStatsMean (&PerMessage), SingleCycles)
+    );
+}
+
+/**
+  Set a mask in the DEBUG_LEVEL_CONTROL block at PcdDebugLevelControlAddress.
+
+  @param[in]  Mask         The DEBUG_* mask.
+  @param[in]  ModuleGuid   FILE_GUID of the module, NULL for the global mask.
+
+  @retval EFI_SUCCESS            The mask is set and published.
+  @retval EFI_UNSUPPORTED        PcdDebugLevelControlAddress is 0.
+  @retval EFI_OUT_OF_RESOURCES   The module table is full.
+**/
+EFI_STATUS
+DebugLibBenchSetLevel (
+  IN UINT32      Mask,
+  IN EFI_GUID    *ModuleGuid  OPTIONAL
+  )
+{
+  volatile DEBUG_LEVEL_CONTROL  *Control;
+  UINT32                        Generation;
+  UINTN                         Index;
+  UINTN                         Count;
+
+  Control = (volatile DEBUG_LEVEL_CONTROL *)(UINTN) PcdGet64 (PcdDebugLevelControlAddress);
+  if (Control == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Control->Signature != DEBUG_LEVEL_CONTROL_SIGNATURE) {
+    ZeroMem ((VOID *) Control, sizeof (DEBUG_LEVEL_CONTROL));
+    Control->GlobalMask = (UINT32) GetDebugPrintErrorLevel ();
+    Control->Signature  = DEBUG_LEVEL_CONTROL_SIGNATURE;
+  }
+
+  if (ModuleGuid != NULL) {
+    //
+    // The block is shared memory, do not trust its count.
+    //
+    Count = MIN (Control->ModuleCount, DEBUG_LEVEL_CONTROL_MAX_MODULES);
+    for (Index = 0; Index < Count; Index++) {
+      if (CompareGuid ((EFI_GUID *) &Control->Module[Index].ModuleGuid, ModuleGuid)) {
+        break;
+      }
+    }
+    if (Index == DEBUG_LEVEL_CONTROL_MAX_MODULES) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  //
+  // Odd while the block is being written, see DebugLevelControl.h.
+  //
+  Generation          = Control->Generation & ~BIT0;
+  Control->Generation = Generation + 1;
+  MemoryFence ();
+
+  if (ModuleGuid == NULL) {
+    Control->GlobalMask = Mask;
+  } else {
+    CopyGuid ((EFI_GUID *) &Control->Module[Index].ModuleGuid, ModuleGuid);
+    Control->Module[Index].Mask = Mask;
+    if (Index == Control->ModuleCount) {
+      Control->ModuleCount = (UINT32) Index + 1;
+    }
+  }
+
+  MemoryFence ();
+  Control->Generation = Generation + 2;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Run every case on the streaming and the buffered path.
+
+  @param[in] ImageHandle    The image handle.
+  @param[in] SystemTable    The system table.
+
+  @retval EFI_SUCCESS       The benchmark ran.
+**/
+EFI_STATUS
+EFIAPI
+DebugLibBenchEntryPoint (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL   *ShellParameters;
+  EFI_GUID                        ModuleGuid;
+  UINTN                           Mask;
+  DEBUG_LIB_BENCH_CASE            Case;
+  DEBUG_LIB_BENCH_CONCURRENT      Concurrent;
+  UINTN                           NumberOfProcessors;
+  UINTN                           NumberOfEnabledProcessors;
+  UINT64                          StreamCycles;
+  UINT64                          BufferedCycles;
+  UINT64                          Start;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **) &ShellParameters);
+  if (!EFI_ERROR (Status) && ShellParameters->Argc > 2 && StrCmp (ShellParameters->Argv[1], L"level") == 0) {
+    Mask = StrHexToUintn (ShellParameters->Argv[2]);
+    if (ShellParameters->Argc > 3) {
+      Status = StrToGuid (ShellParameters->Argv[3], &ModuleGuid);
+      if (EFI_ERROR (Status)) {
+        Print (L"Invalid module GUID %s\n", ShellParameters->Argv[3]);
+        return Status;
+      }
+      Status = DebugLibBenchSetLevel ((UINT32) Mask, &ModuleGuid);
+    } else {
+      Status = DebugLibBenchSetLevel ((UINT32) Mask, NULL);
+    }
+    Print (L"Set debug level 0x%08x: %r\n", Mask, Status);
+    return Status;
+  }
+
+  //
+  // Lowest level bit that is off, so the filtered case prints nothing.
+  //
+  Mask           = ~GetDebugPrintErrorLevel () & MAX_UINT32;
+  mFilteredLevel = Mask & (0 - Mask);
+
+  InitializeSpinLock (&mLegacyLock);
+  SetMem (mLongString, DEBUG_LIB_BENCH_TRUNCATED_LENGTH, 'L');
+  mLongString[DEBUG_LIB_BENCH_TRUNCATED_LENGTH] = '\0';
+
+  Start = AsmReadTsc ();
+  gBS->Stall (DEBUG_LIB_BENCH_CALIBRATE_US);
+  mTscMhz = MAX (DivU64x32 (AsmReadTsc () - Start, DEBUG_LIB_BENCH_CALIBRATE_US), 1);
+
+  //
+  // Without MP services, or without an enabled AP, only the BSP is measured.
+  //
+  ZeroMem (&Concurrent, sizeof (Concurrent));
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &Concurrent.Mp);
+  if (!EFI_ERROR (Status)) {
+    Status = Concurrent.Mp->GetNumberOfProcessors (Concurrent.Mp, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+  if (!EFI_ERROR (Status) && NumberOfEnabledProcessors > 1) {
+    Concurrent.ApCount = NumberOfEnabledProcessors - 1;
+    Concurrent.Cycles  = AllocateZeroPool ((NumberOfProcessors + 1) * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+    if (Concurrent.Cycles != NULL) {
+      Concurrent.Arrived = (volatile UINT32 *)(Concurrent.Cycles + NumberOfProcessors * MP_BENCH_SLOT_STRIDE);
+    }
+  }
+
+  Print (
+    L"DebugLib streaming vs buffered DEBUG(), %d samples per case, TSC %ld MHz, 0x%x Aps logging at once\n",
+    DEBUG_LIB_BENCH_SAMPLES,
+    mTscMhz,
+    Concurrent.Cycles != NULL ? Concurrent.ApCount : 0
+    );
+
+  for (Case = 0; Case < BenchCaseMax; Case++) {
+    if (Case == BenchCaseFiltered && mFilteredLevel == 0) {
+      continue;
+    }
+    Print (L"%a:\n", mCaseName[Case]);
+    StreamCycles   = DebugLibBenchRun (L"stream", DebugPrint, Case);
+    BufferedCycles = DebugLibBenchRun (L"buffered", LegacyDebugPrint, Case);
+    if (Concurrent.Cycles != NULL) {
+      DebugLibBenchRunConcurrent (L"stream", &Concurrent, DebugPrint, Case, StreamCycles, NumberOfProcessors);
+      DebugLibBenchRunConcurrent (L"buffered", &Concurrent, LegacyDebugPrint, Case, BufferedCycles, NumberOfProcessors);
+    }
+  }
+
+  //
+  // The buffered path cuts every message at MAX_DEBUG_MESSAGE_LENGTH - 1 bytes.
+  //
+  DebugLibBenchPrint (LegacyDebugPrint, BenchCaseTruncated);
+  Print (
+    L"truncated string: buffered path wrote %d of %d bytes\n",
+    mLegacyWritten,
+    AsciiStrLen ("DebugLib bench: \n") + DEBUG_LIB_BENCH_TRUNCATED_LENGTH
+    );
+
+  if (Concurrent.Cycles != NULL) {
+    FreePool ((VOID *) Concurrent.Cycles);
+  }
+  return EFI_SUCCESS;
+}
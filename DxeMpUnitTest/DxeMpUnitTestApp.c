@@ -0,0 +1,587 @@
+/** @file
+  Test and benchmark EFI_MP_SERVICES_PROTOCOL, the DXE counterpart of
+  PeiMp2UnitTest and MmMpTestSmm.
+
+  The API part runs StartupAllAPs in blocking and event mode, StartupThisAP
+  and EnableDisableAP, and checks on which APs the procedure ran.
+
+  The benchmark times every dispatch with a no-op procedure and with the
+  fixed work of the PEI test, DXE_MP_FIXED_WORK_US, and prints the summary
+  and the histogram of each, in ns, through DEBUG like the other phases, so
+  the PEI, DXE and MM costs of one platform land in one log. Unlike
+  StartupAllCPUs of PEI, StartupAllAPs leaves the BSP out. In event mode
+  the time runs from the call to the event being signaled, which the MP
+  services do from a periodic timer, so it shows that timer period rather
+  than the AP wake up.
+
+  "DxeMpUnitTestApp [<Profile>]" runs the procedures with the
+  MP_WORKLOAD_PROFILE Profile of MpWorkloadLib, the CpuPause spin without.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Protocol/MpService.h>
+#include <Protocol/ShellParameters.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Library/MpWorkloadLib.h>
+
+#define DXE_MP_SAMPLES                 FixedPcdGet32 (PcdDxeMpTestSamples)
+
+//
+// Fixed work per AP, the 0x30 us SleepTime of PeiMp2UnitTest.
+//
+#define DXE_MP_FIXED_WORK_US           0x30
+
+//
+// Time an event mode call gets to signal its event.
+//
+#define DXE_MP_EVENT_TIMEOUT_US        1000000
+
+//
+// Buffer of the memory workload profiles.
+//
+#define DXE_MP_WORKLOAD_SLOT_SIZE      SIZE_2MB
+#define DXE_MP_WORKLOAD_SLOTS          8
+#define DXE_MP_WORKLOAD_STREAM_MBPS    2000
+
+typedef struct {
+  //
+  // Performance counter ticks of work, 0 for a no-op.
+  //
+  UINT64              WorkTicks;
+  //
+  // Body of the work, NULL to spin.
+  //
+  MP_WORKLOAD         *Workload;
+  //
+  // Per processor run count, MP_BENCH_SLOT_STRIDE UINT64s apart, NULL for none.
+  //
+  volatile UINT64     *Ran;
+} DXE_MP_PROCEDURE_PARAM;
+
+typedef enum {
+  DxeMpStartupAllAPs,
+  DxeMpStartupAllAPsSingleThread,
+  DxeMpStartupAllAPsEvent,
+  DxeMpStartupThisAP,
+  DxeMpStartupThisAPEvent,
+  DxeMpDispatchMax
+} DXE_MP_DISPATCH;
+
+STATIC CONST CHAR8  *mDispatchName[DxeMpDispatchMax] = {
+  "StartupAllAPs",
+  "StartupAllAPs single thread",
+  "StartupAllAPs event",
+  "StartupThisAP",
+  "StartupThisAP event"
+};
+
+EFI_MP_SERVICES_PROTOCOL   *mMp;
+UINTN                      mNumberOfProcessors;
+UINTN                      mBspIndex;
+
+MP_WORKLOAD                mWorkloadStorage;
+VOID                       *mWorkloadBuffer;
+
+/**
+  Convert microseconds to performance counter ticks.
+
+  @param[in]  Microseconds   The duration.
+
+  @return Ticks.
+**/
+UINT64
+DxeMpUsToTicks (
+  IN UINTN  Microseconds
+  )
+{
+  return DivU64x32 (MultU64x64 (GetPerformanceCounterProperties (NULL, NULL), Microseconds), 1000000);
+}
+
+/**
+  The test procedure: count the run in the slot of the calling processor,
+  then run the work.
+
+  @param[in]  ProcedureArgument   The DXE_MP_PROCEDURE_PARAM.
+**/
+VOID
+EFIAPI
+DxeMpProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  DXE_MP_PROCEDURE_PARAM  *Param;
+  UINTN                   ProcessorIndex;
+  UINT64                  Start;
+
+  Param = (DXE_MP_PROCEDURE_PARAM *)ProcedureArgument;
+  if (Param->Ran != NULL && !EFI_ERROR (mMp->WhoAmI (mMp, &ProcessorIndex)) && ProcessorIndex < mNumberOfProcessors) {
+    Param->Ran[ProcessorIndex * MP_BENCH_SLOT_STRIDE]++;
+  }
+
+  if (Param->WorkTicks == 0) {
+    return;
+  }
+  if (Param->Workload != NULL) {
+    MpWorkloadRun (Param->Workload, Param->WorkTicks);
+    return;
+  }
+  Start = GetPerformanceCounter ();
+  while (MpBenchElapsedTicks (Start, GetPerformanceCounter ()) < Param->WorkTicks) {
+    CpuPause ();
+  }
+}
+
+/**
+  Wait for the event of an event mode call.
+
+  @param[in]  Event   The event.
+
+  @retval EFI_SUCCESS   The event was signaled.
+  @retval EFI_TIMEOUT   It was not within DXE_MP_EVENT_TIMEOUT_US.
+**/
+EFI_STATUS
+DxeMpWaitEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  UINT64  Start;
+
+  Start = GetPerformanceCounter ();
+  while (gBS->CheckEvent (Event) == EFI_NOT_READY) {
+    if (MpBenchElapsedNs (Start, GetPerformanceCounter ()) > DXE_MP_EVENT_TIMEOUT_US * 1000ULL) {
+      return EFI_TIMEOUT;
+    }
+    CpuPause ();
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Run one dispatch and wait for it to complete.
+
+  An event mode call whose event does not come within DXE_MP_EVENT_TIMEOUT_US
+  is reported as EFI_TIMEOUT, but only once its event came after all: the
+  APs run DxeMpProcedure, which lives in this image, on Param, which lives
+  on the stack of the caller, so neither may go away before they are done.
+
+  @param[in]  Dispatch   The MP services call.
+  @param[in]  ApIndex    The AP of StartupThisAP.
+  @param[in]  Event      A signal-less event for the event mode calls.
+  @param[in]  Param      The procedure argument.
+
+  @retval EFI_SUCCESS   The procedure ran on every AP it was sent to.
+  @retval EFI_TIMEOUT   The event came late, the APs are done.
+  @retval Others        The call failed.
+**/
+EFI_STATUS
+DxeMpDispatch (
+  IN DXE_MP_DISPATCH          Dispatch,
+  IN UINTN                    ApIndex,
+  IN EFI_EVENT                Event,
+  IN DXE_MP_PROCEDURE_PARAM   *Param
+  )
+{
+  EFI_STATUS  Status;
+
+  switch (Dispatch) {
+  case DxeMpStartupAllAPs:
+    return mMp->StartupAllAPs (mMp, DxeMpProcedure, FALSE, NULL, 0, Param, NULL);
+
+  case DxeMpStartupAllAPsSingleThread:
+    return mMp->StartupAllAPs (mMp, DxeMpProcedure, TRUE, NULL, 0, Param, NULL);
+
+  case DxeMpStartupAllAPsEvent:
+    Status = mMp->StartupAllAPs (mMp, DxeMpProcedure, FALSE, Event, 0, Param, NULL);
+    break;
+
+  case DxeMpStartupThisAP:
+    return mMp->StartupThisAP (mMp, DxeMpProcedure, ApIndex, NULL, 0, Param, NULL);
+
+  default:
+    Status = mMp->StartupThisAP (mMp, DxeMpProcedure, ApIndex, Event, 0, Param, NULL);
+    break;
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = DxeMpWaitEvent (Event);
+  if (Status == EFI_TIMEOUT) {
+    DEBUG ((DEBUG_ERROR, "%a: no event within 0x%x us, waiting for the Aps!\n", mDispatchName[Dispatch], DXE_MP_EVENT_TIMEOUT_US));
+    while (gBS->CheckEvent (Event) == EFI_NOT_READY) {
+      CpuPause ();
+    }
+  }
+  return Status;
+}
+
+/**
+  Return the first enabled AP.
+
+  @param[out] ApIndex   The AP.
+
+  @retval EFI_SUCCESS     ApIndex is valid.
+  @retval EFI_NOT_FOUND   No AP is enabled.
+**/
+EFI_STATUS
+DxeMpFirstEnabledAp (
+  OUT UINTN  *ApIndex
+  )
+{
+  EFI_PROCESSOR_INFORMATION  Info;
+  UINTN                      Index;
+
+  for (Index = 0; Index < mNumberOfProcessors; Index++) {
+    if (Index != mBspIndex &&
+        !EFI_ERROR (mMp->GetProcessorInfo (mMp, Index, &Info)) &&
+        (Info.StatusFlag & PROCESSOR_ENABLED_BIT) != 0) {
+      *ApIndex = Index;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Count the processors that ran the procedure since Ran was cleared, and
+  check the BSP did not.
+
+  @param[in]  Ran   Per processor run count.
+
+  @return Number of APs that ran, MAX_UINTN if the BSP ran or an AP ran
+          more than once.
+**/
+UINTN
+DxeMpCountRan (
+  IN volatile UINT64  *Ran
+  )
+{
+  UINTN  Index;
+  UINTN  Count;
+
+  Count = 0;
+  for (Index = 0; Index < mNumberOfProcessors; Index++) {
+    if (Ran[Index * MP_BENCH_SLOT_STRIDE] > 1 || (Index == mBspIndex && Ran[Index * MP_BENCH_SLOT_STRIDE] != 0)) {
+      return MAX_UINTN;
+    }
+    Count += (UINTN) Ran[Index * MP_BENCH_SLOT_STRIDE];
+  }
+  return Count;
+}
+
+/**
+  Run every dispatch once and check the APs it reached.
+
+  @param[in]  Param                       The procedure argument, Ran set.
+  @param[in]  Event                       A signal-less event.
+  @param[in]  NumberOfEnabledProcessors   Enabled processors, BSP included.
+
+  @retval EFI_SUCCESS   Every dispatch returned.
+  @retval EFI_TIMEOUT   An event mode call signaled its event late.
+**/
+EFI_STATUS
+TestAPIStartup (
+  IN DXE_MP_PROCEDURE_PARAM   *Param,
+  IN EFI_EVENT                Event,
+  IN UINTN                    NumberOfEnabledProcessors
+  )
+{
+  EFI_STATUS       Status;
+  DXE_MP_DISPATCH  Dispatch;
+  UINTN            ApIndex;
+  UINTN            Expected;
+  UINTN            Count;
+
+  Status = DxeMpFirstEnabledAp (&ApIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  DEBUG ((DEBUG_INFO, "1.Test Startup begin, work 0x%x us\n", DXE_MP_FIXED_WORK_US));
+  for (Dispatch = 0; Dispatch < DxeMpDispatchMax; Dispatch++) {
+    ZeroMem ((VOID *)Param->Ran, mNumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+    Status   = DxeMpDispatch (Dispatch, ApIndex, Event, Param);
+    Expected = (Dispatch >= DxeMpStartupThisAP) ? 1 : NumberOfEnabledProcessors - 1;
+    Count    = DxeMpCountRan (Param->Ran);
+    DEBUG ((
+      DEBUG_INFO,
+      "1. %a: %r, ran on 0x%x of 0x%x Aps ==== %a !\n",
+      mDispatchName[Dispatch],
+      Status,
+      (Count == MAX_UINTN) ? 0 : Count,
+      Expected,
+      (!EFI_ERROR (Status) && Count == Expected) ? "Pass" : "Fail"
+      ));
+    if (Status == EFI_TIMEOUT) {
+      DEBUG ((DEBUG_ERROR, "1. %a: Aps did not finish in time, test aborted!\n", mDispatchName[Dispatch]));
+      return Status;
+    }
+  }
+
+  //
+  // The BSP is not an AP.
+  //
+  Status = mMp->StartupThisAP (mMp, DxeMpProcedure, mBspIndex, NULL, 0, Param, NULL);
+  DEBUG ((DEBUG_INFO, "1. StartupThisAP to the BSP: %r ==== %a !\n", Status, (Status == EFI_INVALID_PARAMETER) ? "Pass" : "Fail"));
+  DEBUG ((DEBUG_INFO, "1. Test Startup End\n"));
+  return EFI_SUCCESS;
+}
+
+/**
+  Disable the first enabled AP, check StartupAllAPs and StartupThisAP skip
+  it, and enable it again with its original health.
+
+  @param[in]  Param   The procedure argument, Ran set.
+**/
+VOID
+TestAPIEnableDisableAP (
+  IN DXE_MP_PROCEDURE_PARAM   *Param
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_PROCESSOR_INFORMATION  Info;
+  UINTN                      NumberOfProcessors;
+  UINTN                      NumberOfEnabledProcessors;
+  UINTN                      ApIndex;
+  UINT32                     HealthFlag;
+
+  DEBUG ((DEBUG_INFO, "2.Test EnableDisableAP begin!\n"));
+  Status = DxeMpFirstEnabledAp (&ApIndex);
+  if (!EFI_ERROR (Status)) {
+    Status = mMp->GetProcessorInfo (mMp, ApIndex, &Info);
+  }
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "2. No enabled Ap to disable: %r ==== Fail !\n", Status));
+    return;
+  }
+  HealthFlag = Info.StatusFlag & PROCESSOR_HEALTH_STATUS_BIT;
+
+  Status = mMp->EnableDisableAP (mMp, ApIndex, FALSE, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "2. EnableDisableAP disable Ap 0x%x: %r ==== Fail !\n", ApIndex, Status));
+    return;
+  }
+  Status = mMp->GetNumberOfProcessors (mMp, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  ASSERT_EFI_ERROR (Status);
+  DEBUG ((DEBUG_INFO, "After disable Ap 0x%x, NumOfProc = 0x%x, NumOfEnableProc = 0x%x!\n", ApIndex, NumberOfProcessors, NumberOfEnabledProcessors));
+
+  ZeroMem ((VOID *)Param->Ran, mNumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+  Status = mMp->StartupAllAPs (mMp, DxeMpProcedure, FALSE, NULL, 0, Param, NULL);
+  if (NumberOfEnabledProcessors == 1) {
+    //
+    // No AP left, StartupAllAPs has none to start.
+    //
+    DEBUG ((DEBUG_INFO, "2. StartupAllAPs without enabled Ap: %r ==== %a !\n", Status, (Status == EFI_NOT_STARTED) ? "Pass" : "Fail"));
+  } else {
+    DEBUG ((
+      DEBUG_INFO,
+      "2. StartupAllAPs skips the disabled Ap: %r ==== %a !\n",
+      Status,
+      (!EFI_ERROR (Status) && Param->Ran[ApIndex * MP_BENCH_SLOT_STRIDE] == 0) ? "Pass" : "Fail"
+      ));
+  }
+  Status = mMp->StartupThisAP (mMp, DxeMpProcedure, ApIndex, NULL, 0, Param, NULL);
+  DEBUG ((DEBUG_INFO, "2. StartupThisAP to the disabled Ap: %r ==== %a !\n", Status, (Status == EFI_INVALID_PARAMETER) ? "Pass" : "Fail"));
+
+  Status = mMp->EnableDisableAP (mMp, ApIndex, TRUE, &HealthFlag);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "2. EnableDisableAP enable Ap 0x%x: %r ==== Fail !\n", ApIndex, Status));
+    return;
+  }
+  Status = mMp->GetNumberOfProcessors (mMp, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  ASSERT_EFI_ERROR (Status);
+  DEBUG ((DEBUG_INFO, "After enable Ap 0x%x, NumOfProc = 0x%x, NumOfEnableProc = 0x%x!\n", ApIndex, NumberOfProcessors, NumberOfEnabledProcessors));
+
+  ZeroMem ((VOID *)Param->Ran, mNumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+  Status = mMp->StartupThisAP (mMp, DxeMpProcedure, ApIndex, NULL, 0, Param, NULL);
+  DEBUG ((
+    DEBUG_INFO,
+    "2. StartupThisAP to the enabled Ap: %r ==== %a !\n",
+    Status,
+    (!EFI_ERROR (Status) && Param->Ran[ApIndex * MP_BENCH_SLOT_STRIDE] == 1) ? "Pass" : "Fail"
+    ));
+  DEBUG ((DEBUG_INFO, "2. Test EnableDisableAP End\n"));
+}
+
+/**
+  Time every dispatch with a no-op procedure and with fixed work, and print
+  the summary and histogram of each.
+
+  @param[in]  Param   The procedure argument, Workload set.
+  @param[in]  Event   A signal-less event.
+
+  @retval EFI_SUCCESS   The benchmark ran.
+  @retval EFI_TIMEOUT   An event mode call signaled its event late.
+**/
+EFI_STATUS
+TestDispatchBenchmark (
+  IN DXE_MP_PROCEDURE_PARAM   *Param,
+  IN EFI_EVENT                Event
+  )
+{
+  EFI_STATUS       Status;
+  DXE_MP_DISPATCH  Dispatch;
+  MP_BENCH_STATS   Stats;
+  UINTN            Work;
+  UINTN            Sample;
+  UINTN            ApIndex;
+  UINT64           Start;
+  CHAR8            Label[48];
+
+  Status = DxeMpFirstEnabledAp (&ApIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  DEBUG ((DEBUG_INFO, "3.Test DXE MP benchmark begin, %d samples, StartupThisAP to Ap 0x%x\n", DXE_MP_SAMPLES, ApIndex));
+
+  Param->Ran = NULL;
+  for (Work = 0; Work < 2; Work++) {
+    Param->WorkTicks = (Work == 0) ? 0 : DxeMpUsToTicks (DXE_MP_FIXED_WORK_US);
+    for (Dispatch = 0; Dispatch < DxeMpDispatchMax; Dispatch++) {
+      MpBenchStatsReset (&Stats);
+      for (Sample = 0; Sample < DXE_MP_SAMPLES; Sample++) {
+        Start  = GetPerformanceCounter ();
+        Status = DxeMpDispatch (Dispatch, ApIndex, Event, Param);
+        if (Status == EFI_TIMEOUT) {
+          DEBUG ((DEBUG_ERROR, "3. %a: %r, Aps did not finish in time, benchmark aborted!\n", mDispatchName[Dispatch], Status));
+          return Status;
+        }
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_INFO, "3. %a: %r, samples dropped\n", mDispatchName[Dispatch], Status));
+          break;
+        }
+        MpBenchStatsAdd (&Stats, MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+      }
+      if (Stats.Count == 0) {
+        continue;
+      }
+
+      AsciiSPrint (Label, sizeof (Label), "%a %a", mDispatchName[Dispatch], (Work == 0) ? "no-op" : "fixed work");
+      MpBenchStatsPrint (DEBUG_INFO, Label, "ns", &Stats);
+      MpBenchStatsPrintHistogram (DEBUG_INFO, Label, "ns", &Stats);
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "3. Test DXE MP benchmark End, fixed work is 0x%x us per Ap\n", DXE_MP_FIXED_WORK_US));
+  return EFI_SUCCESS;
+}
+
+/**
+  Set up the workload the procedure runs as its body.
+
+  @param[in]  Profile   The MP_WORKLOAD_PROFILE.
+
+  @return The workload, or NULL to keep the CpuPause spin.
+**/
+MP_WORKLOAD *
+SelectWorkload (
+  IN UINTN  Profile
+  )
+{
+  if (MpWorkloadSelect (
+        &mWorkloadStorage,
+        Profile,
+        &mWorkloadBuffer,
+        DXE_MP_WORKLOAD_SLOT_SIZE,
+        DXE_MP_WORKLOAD_SLOTS,
+        DXE_MP_WORKLOAD_STREAM_MBPS
+        ) == NULL) {
+    return NULL;
+  }
+
+  DEBUG ((DEBUG_INFO, "Procedure body: %a workload\n", MpWorkloadProfileName ((MP_WORKLOAD_PROFILE) Profile)));
+  return &mWorkloadStorage;
+}
+
+/**
+  Run the EFI_MP_SERVICES_PROTOCOL tests and benchmark.
+
+  @param[in] ImageHandle    The image handle.
+  @param[in] SystemTable    The system table.
+
+  @retval EFI_SUCCESS             The tests ran.
+  @retval EFI_UNSUPPORTED         No MP services or no enabled AP.
+  @retval EFI_OUT_OF_RESOURCES    No memory for the run counts.
+  @retval EFI_TIMEOUT             An event mode call signaled its event late
+                                  and the run was aborted.
+**/
+EFI_STATUS
+EFIAPI
+DxeMpUnitTestEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  EFI_EVENT                      Event;
+  UINTN                          NumberOfEnabledProcessors;
+  UINTN                          Profile;
+  DXE_MP_PROCEDURE_PARAM         Param;
+
+  Profile = MpWorkloadSpin;
+  Status  = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **) &ShellParameters);
+  if (!EFI_ERROR (Status) && ShellParameters->Argc > 1) {
+    Profile = StrDecimalToUintn (ShellParameters->Argv[1]);
+  }
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &mMp);
+  if (!EFI_ERROR (Status)) {
+    Status = mMp->GetNumberOfProcessors (mMp, &mNumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = mMp->WhoAmI (mMp, &mBspIndex);
+  }
+  if (EFI_ERROR (Status) || NumberOfEnabledProcessors < 2) {
+    Print (L"DxeMpUnitTest: needs MP services and an enabled Ap\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  ZeroMem (&Param, sizeof (Param));
+  Param.Ran = AllocateZeroPool (mNumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+  if (Param.Ran == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Event);
+  if (EFI_ERROR (Status)) {
+    FreePool ((VOID *)Param.Ran);
+    return Status;
+  }
+
+  Print (L"DxeMpUnitTest: 0x%x Cpus, 0x%x enabled, results go to the debug log\n", mNumberOfProcessors, NumberOfEnabledProcessors);
+  DEBUG ((DEBUG_INFO, "=========================================\n"));
+  DEBUG ((DEBUG_INFO, "Begin do Efi Mp Services Protocol test, 0x%x Cpus, 0x%x enabled!\n", mNumberOfProcessors, NumberOfEnabledProcessors));
+
+  Param.Workload  = SelectWorkload (Profile);
+  Param.WorkTicks = DxeMpUsToTicks (DXE_MP_FIXED_WORK_US);
+  Status = TestAPIStartup (&Param, Event, NumberOfEnabledProcessors);
+  if (Status != EFI_TIMEOUT) {
+    TestAPIEnableDisableAP (&Param);
+  }
+
+  FreePool ((VOID *)Param.Ran);
+  if (Status != EFI_TIMEOUT) {
+    Status = TestDispatchBenchmark (&Param, Event);
+  }
+
+  gBS->CloseEvent (Event);
+  if (Status == EFI_TIMEOUT) {
+    Print (L"DxeMpUnitTest: an Ap did not finish in time, run aborted\n");
+    return Status;
+  }
+
+  DEBUG ((DEBUG_INFO, "Efi Mp Services Protocol test End!\n"));
+  DEBUG ((DEBUG_INFO, "=========================================\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,46 @@
+/** @file
+  Runtime debug level control block of BaseDebugLibSerialPortMp.
+
+  The platform reserves one DEBUG_LEVEL_CONTROL in memory readable by every
+  module linked with the library and sets PcdDebugLevelControlAddress to it.
+  Each module caches its mask and reloads it only when Generation changes,
+  so a live system can raise or lower verbosity per module without a
+  rebuild, while filtered-out DEBUG() calls keep away from the console lock.
+
+  Writers bump Generation to an odd value, update the masks, then bump it to
+  the next even value. Readers ignore the block while Generation is odd and
+  treat Generation 0 as "no override".
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _DEBUG_LEVEL_CONTROL_H_
+#define _DEBUG_LEVEL_CONTROL_H_
+
+#define DEBUG_LEVEL_CONTROL_SIGNATURE     SIGNATURE_32 ('D', 'L', 'V', 'C')
+
+#define DEBUG_LEVEL_CONTROL_MAX_MODULES   16
+
+typedef struct {
+  //
+  // FILE_GUID of the module, gEfiCallerIdGuid inside the library.
+  //
+  GUID      ModuleGuid;
+  UINT32    Mask;
+  UINT32    Reserved;
+} DEBUG_LEVEL_CONTROL_MODULE;
+
+typedef struct {
+  UINT32                      Signature;
+  UINT32                      Generation;
+  //
+  // DEBUG_* mask of every module without an entry in Module[].
+  //
+  UINT32                      GlobalMask;
+  UINT32                      ModuleCount;
+  DEBUG_LEVEL_CONTROL_MODULE  Module[DEBUG_LEVEL_CONTROL_MAX_MODULES];
+} DEBUG_LEVEL_CONTROL;
+
+#endif
@@ -0,0 +1,110 @@
+/** @file
+  Results of the PeiMp2UnitTest benchmarks, handed to DXE in GUIDed HOBs.
+
+  The PEIM builds one HOB per benchmark run, in the order it runs: the entry
+  run first, then the memory discovered run. Each holds a PEI_MP2_BENCHMARK_RESULT
+  followed by ApStampCount UINT64 start stamps.
+
+  PeiMp2BenchReportApp saves a PEI_MP2_BENCHMARK_SUMMARY per record in the
+  PEI_MP2_BENCHMARK_VARIABLE_NAME variable to compare later boots against,
+  and in a variable per AP loop mode to compare the modes side by side.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PEI_MP2_BENCHMARK_HOB_H_
+#define _PEI_MP2_BENCHMARK_HOB_H_
+
+#include <Library/MpBenchmarkLib.h>
+
+#define PEI_MP2_BENCHMARK_HOB_GUID \
+  { \
+    0xa40f84f1, 0x6ca9, 0x4f7d, { 0xa6, 0x85, 0xd6, 0xb7, 0xe5, 0x70, 0xef, 0xf1 } \
+  }
+
+#define PEI_MP2_BENCHMARK_REVISION       3
+
+//
+// Room for the records of both phases, the memory discovered run of a PEIM
+// loaded after memory puts them in one HOB.
+//
+#define PEI_MP2_BENCHMARK_MAX_RECORDS    48
+#define PEI_MP2_BENCHMARK_NAME_SIZE      32
+#define PEI_MP2_BENCHMARK_UNIT_SIZE      16
+
+#define PEI_MP2_BENCHMARK_VARIABLE_NAME  L"PeiMp2Benchmark"
+
+//
+// PcdCpuApLoopMode of UefiCpuPkg: how the APs of the MP services wait for
+// the next procedure. Summaries of each requested mode are saved in the
+// variable named by PEI_MP2_BENCHMARK_MODE_VARIABLE_FORMAT with the mode.
+//
+#define PEI_MP2_AP_LOOP_HLT              1
+#define PEI_MP2_AP_LOOP_MWAIT            2
+#define PEI_MP2_AP_LOOP_RUN              3
+#define PEI_MP2_AP_LOOP_MODES            3
+
+#define PEI_MP2_BENCHMARK_MODE_VARIABLE_FORMAT  L"PeiMp2BenchmarkApLoop%d"
+
+typedef enum {
+  PeiMp2BenchmarkPreMemory,
+  PeiMp2BenchmarkPostMemory
+} PEI_MP2_BENCHMARK_PHASE;
+
+typedef struct {
+  CHAR8             Name[PEI_MP2_BENCHMARK_NAME_SIZE];
+  CHAR8             Unit[PEI_MP2_BENCHMARK_UNIT_SIZE];
+  MP_BENCH_STATS    Stats;
+} PEI_MP2_BENCHMARK_RECORD;
+
+typedef struct {
+  UINT32                      Revision;
+  //
+  // A PEI_MP2_BENCHMARK_PHASE.
+  //
+  UINT32                      Phase;
+  UINT32                      NumberOfProcessors;
+  UINT32                      BspIndex;
+  UINT64                      TscMhz;
+  UINT32                      RecordCount;
+  //
+  // Number of UINT64 after the structure: nanoseconds from the
+  // StartupAllCPUs call to the start of each processor in the last sample,
+  // with the AP TSC translated to the BSP TSC by the measured offset,
+  // indexed by processor number, 0 for the BSP and processors that did not
+  // run.
+  //
+  UINT32                      ApStampCount;
+  //
+  // PcdCpuApLoopMode PeiMp2UnitTest was built with, a PEI_MP2_AP_LOOP_*
+  // value. CpuMpPei has its own copy of the PCD, so this is the mode the MP
+  // services run only if the platform builds CpuMpPei with the same value.
+  //
+  UINT32                      RequestedApLoopMode;
+  //
+  // Records that did not fit in Record.
+  //
+  UINT32                      DroppedRecordCount;
+  PEI_MP2_BENCHMARK_RECORD    Record[PEI_MP2_BENCHMARK_MAX_RECORDS];
+} PEI_MP2_BENCHMARK_RESULT;
+
+//
+// Saved form of one record, without the histogram.
+//
+typedef struct {
+  UINT32    Sequence;
+  UINT32    Phase;
+  CHAR8     Name[PEI_MP2_BENCHMARK_NAME_SIZE];
+  CHAR8     Unit[PEI_MP2_BENCHMARK_UNIT_SIZE];
+  UINT64    Count;
+  UINT64    Min;
+  UINT64    Mean;
+  UINT64    P99;
+  UINT64    Max;
+} PEI_MP2_BENCHMARK_SUMMARY;
+
+extern EFI_GUID gPeiMp2BenchmarkHobGuid;
+
+#endif
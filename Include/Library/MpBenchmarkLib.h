@@ -0,0 +1,335 @@
+/** @file
+  Helpers shared by the MP benchmarks of UnitTestPkg: sample statistics with
+  a log2 histogram, performance counter conversions, stack high-watermark
+  measurement, cross-CPU TSC offsets and a start barrier.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_BENCHMARK_LIB_H_
+#define _MP_BENCHMARK_LIB_H_
+
+//
+// Bucket 0 holds the value 0, bucket N holds [2^(N-1), 2^N).
+// The last bucket also takes everything above its lower bound.
+//
+#define MP_BENCH_HISTOGRAM_BUCKETS    64
+
+typedef struct {
+  UINT64    Count;
+  UINT64    Sum;
+  UINT64    Min;
+  UINT64    Max;
+  UINT32    Histogram[MP_BENCH_HISTOGRAM_BUCKETS];
+} MP_BENCH_STATS;
+
+#define MP_BENCH_STACK_PATTERN        0x5AA5C33C5AA5C33CULL
+
+//
+// Cache line size, and the stride in UINT64s of per CPU slots that must not
+// share a line.
+//
+#define MP_BENCH_CACHE_LINE_SIZE      64
+#define MP_BENCH_SLOT_STRIDE          (MP_BENCH_CACHE_LINE_SIZE / sizeof (UINT64))
+
+//
+// CpuPause rounds MpBenchBarrierWait waits for the other CPUs.
+//
+#define MP_BENCH_BARRIER_SPINS        0x4000000
+
+//
+// Returned by MpBenchStackScan when the whole painted window was used.
+//
+#define MP_BENCH_STACK_OVERFLOW       MAX_UINTN
+
+//
+// Stack window painted by MpBenchStackPaint. Base is the address of the
+// structure itself, which lives in the frame of the measuring function.
+//
+typedef struct {
+  UINTN     Base;
+  UINTN     Bottom;
+} MP_BENCH_STACK_PAINT;
+
+//
+// Request of the TSC exchange telling the measured CPU to return.
+//
+#define MP_BENCH_TSC_EXCHANGE_STOP    MAX_UINT64
+
+//
+// Mailbox of the TSC exchange between the reference CPU and one measured
+// CPU, zeroed before the exchange. Request is written by the reference CPU,
+// Reply and Stamp by the measured CPU, 64 bytes apart so the two sides never
+// write the same cache line. An array of mailboxes keeps that property.
+//
+typedef struct {
+  volatile UINT64    Request;
+  UINT64             Reserved0[7];
+  volatile UINT64    Reply;
+  volatile UINT64    Stamp;
+  UINT64             Reserved1[6];
+} MP_BENCH_TSC_EXCHANGE;
+
+//
+// TSC of a measured CPU relative to the reference CPU. The true offset lies
+// within Offset - Error and Offset + Error. Consistent is FALSE when the
+// rounds disagree with any constant offset, which means the TSCs drift
+// apart; Offset and Error then come from the shortest round trip alone.
+//
+typedef struct {
+  INT64      Offset;
+  UINT64     Error;
+  UINT64     RoundTrip;
+  BOOLEAN    Valid;
+  BOOLEAN    Consistent;
+} MP_BENCH_TSC_OFFSET;
+
+/**
+  Clear a statistics accumulator.
+
+  @param[out] Stats   The accumulator to clear.
+**/
+VOID
+EFIAPI
+MpBenchStatsReset (
+  OUT MP_BENCH_STATS  *Stats
+  );
+
+/**
+  Add one sample to a statistics accumulator.
+
+  @param[in, out] Stats   The accumulator.
+  @param[in]      Value   The sample, in whatever unit the caller uses.
+**/
+VOID
+EFIAPI
+MpBenchStatsAdd (
+  IN OUT MP_BENCH_STATS  *Stats,
+  IN     UINT64          Value
+  );
+
+/**
+  Merge all samples of one accumulator into another.
+
+  @param[in, out] Stats   The accumulator receiving the samples.
+  @param[in]      Other   The accumulator to merge.
+**/
+VOID
+EFIAPI
+MpBenchStatsMerge (
+  IN OUT MP_BENCH_STATS        *Stats,
+  IN     CONST MP_BENCH_STATS  *Other
+  );
+
+/**
+  Return the mean of the samples, or 0 if there is none.
+
+  @param[in] Stats   The accumulator.
+
+  @return The mean, rounded down.
+**/
+UINT64
+EFIAPI
+MpBenchStatsMean (
+  IN CONST MP_BENCH_STATS  *Stats
+  );
+
+/**
+  Return an upper bound of the given percentile.
+
+  The value is the upper edge of the histogram bucket holding the percentile,
+  clamped to the largest sample, so it is exact to within a factor of two.
+
+  @param[in] Stats     The accumulator.
+  @param[in] Percent   The percentile, 0 to 100.
+
+  @return The percentile bound, or 0 if there is no sample.
+**/
+UINT64
+EFIAPI
+MpBenchStatsPercentile (
+  IN CONST MP_BENCH_STATS  *Stats,
+  IN UINTN                 Percent
+  );
+
+/**
+  Print a one line summary: count, min, mean, p50, p99 and max.
+
+  @param[in] ErrorLevel   The DEBUG error level to print at.
+  @param[in] Label        Prefix of the line.
+  @param[in] Unit         Unit of the samples, e.g. "ns".
+  @param[in] Stats        The accumulator.
+**/
+VOID
+EFIAPI
+MpBenchStatsPrint (
+  IN UINTN                 ErrorLevel,
+  IN CONST CHAR8           *Label,
+  IN CONST CHAR8           *Unit,
+  IN CONST MP_BENCH_STATS  *Stats
+  );
+
+/**
+  Print one line per non-empty histogram bucket.
+
+  @param[in] ErrorLevel   The DEBUG error level to print at.
+  @param[in] Label        Prefix of every line.
+  @param[in] Unit         Unit of the samples, e.g. "ns".
+  @param[in] Stats        The accumulator.
+**/
+VOID
+EFIAPI
+MpBenchStatsPrintHistogram (
+  IN UINTN                 ErrorLevel,
+  IN CONST CHAR8           *Label,
+  IN CONST CHAR8           *Unit,
+  IN CONST MP_BENCH_STATS  *Stats
+  );
+
+/**
+  Return the number of performance counter ticks between two counter values,
+  taking the counting direction and wrap around into account.
+
+  @param[in] Start   Counter value at the start of the interval.
+  @param[in] End     Counter value at the end of the interval.
+
+  @return Elapsed ticks.
+**/
+UINT64
+EFIAPI
+MpBenchElapsedTicks (
+  IN UINT64  Start,
+  IN UINT64  End
+  );
+
+/**
+  Return the nanoseconds between two performance counter values.
+
+  @param[in] Start   Counter value at the start of the interval.
+  @param[in] End     Counter value at the end of the interval.
+
+  @return Elapsed nanoseconds.
+**/
+UINT64
+EFIAPI
+MpBenchElapsedNs (
+  IN UINT64  Start,
+  IN UINT64  End
+  );
+
+/**
+  Paint the stack below the caller's frame with MP_BENCH_STACK_PATTERN.
+
+  Call it on the CPU being measured, right before the code to measure, and
+  call MpBenchStackScan from the same function afterwards. The caller must
+  know the stack has Size bytes below the current frame: painting beyond the
+  stack bottom corrupts whatever lies below it.
+
+  @param[out] Paint   Painted window, must be a local variable of the caller.
+  @param[in]  Size    Bytes to paint.
+**/
+VOID
+EFIAPI
+MpBenchStackPaint (
+  OUT MP_BENCH_STACK_PAINT  *Paint,
+  IN  UINTN                 Size
+  );
+
+/**
+  Scan a painted window for the deepest byte used since it was painted.
+
+  The result includes the frames of the measured code and a few bytes of the
+  caller's own frame.
+
+  @param[in] Paint   Window painted by MpBenchStackPaint in the same frame.
+
+  @return Stack bytes used below the caller's frame, or MP_BENCH_STACK_OVERFLOW
+          if the whole window was used.
+**/
+UINTN
+EFIAPI
+MpBenchStackScan (
+  IN CONST MP_BENCH_STACK_PAINT  *Paint
+  );
+
+/**
+  Answer the TSC exchange requests of the reference CPU until it sends
+  MP_BENCH_TSC_EXCHANGE_STOP.
+
+  Call it on the measured CPU while the reference CPU runs
+  MpBenchTscExchangeMeasure on the same mailbox.
+
+  @param[in, out] Exchange   The mailbox.
+**/
+VOID
+EFIAPI
+MpBenchTscExchangeServe (
+  IN OUT MP_BENCH_TSC_EXCHANGE  *Exchange
+  );
+
+/**
+  Estimate the TSC offset of the CPU serving a mailbox.
+
+  Each round posts a request between two TSC reads of the reference CPU, and
+  the measured CPU stamps its TSC when it sees the request. The offset of
+  the round lies between the stamp minus the two reads, and the estimate is
+  the intersection of all rounds. The mailbox always ends with
+  MP_BENCH_TSC_EXCHANGE_STOP, also when the measured CPU never answers.
+
+  @param[in, out] Exchange                The mailbox.
+  @param[in]      Rounds                  Number of request rounds.
+  @param[in]      TimeoutInMicroseconds   Time to wait for each reply.
+  @param[out]     Offset                  The estimate.
+
+  @retval TRUE    Offset is valid.
+  @retval FALSE   The measured CPU did not answer in time.
+**/
+BOOLEAN
+EFIAPI
+MpBenchTscExchangeMeasure (
+  IN OUT MP_BENCH_TSC_EXCHANGE  *Exchange,
+  IN     UINTN                  Rounds,
+  IN     UINTN                  TimeoutInMicroseconds,
+  OUT    MP_BENCH_TSC_OFFSET    *Offset
+  );
+
+/**
+  Translate a TSC value read on a measured CPU to the reference CPU TSC.
+
+  @param[in] Offset   Offset of the measured CPU, may be NULL.
+  @param[in] Tsc      TSC value read on the measured CPU.
+
+  @return The reference TSC value, or Tsc unchanged if there is no valid
+          offset.
+**/
+UINT64
+EFIAPI
+MpBenchTscToReference (
+  IN CONST MP_BENCH_TSC_OFFSET  *Offset,
+  IN UINT64                     Tsc
+  );
+
+/**
+  Arrive at a barrier and wait until Count CPUs have arrived.
+
+  Every CPU taking part calls it once on the same counter, which the caller
+  zeroes before it starts them, so their timed loops overlap. A CPU gives up
+  after MP_BENCH_BARRIER_SPINS CpuPause rounds, in case some CPU never runs
+  the procedure.
+
+  @param[in, out] Arrived   The barrier counter, alone in its cache line.
+  @param[in]      Count     Number of CPUs taking part.
+
+  @retval TRUE    All Count CPUs arrived.
+  @retval FALSE   The wait gave up.
+**/
+BOOLEAN
+EFIAPI
+MpBenchBarrierWait (
+  IN OUT volatile UINT32  *Arrived,
+  IN     UINTN            Count
+  );
+
+#endif
@@ -0,0 +1,163 @@
+/** @file
+  Constant time processor index and per CPU data for MP procedures.
+
+  WhoAmI of the PEI MP services and of the SMM CPU service reads the APIC ID
+  and searches the processor list for it, its cost grows with the number of
+  processors. A MP_PER_CPU_TABLE maps every APIC ID to its processor index
+  directly. It is built once by the BSP from GetProcessorInfo and then read
+  by any CPU with one APIC ID read and one table load.
+
+  The table and the per CPU data areas live in one caller provided buffer,
+  so the caller decides where they live: PEI pool, permanent memory, SMRAM.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_PER_CPU_LIB_H_
+#define _MP_PER_CPU_LIB_H_
+
+//
+// Returned by MpPerCpuIndex for a CPU missing from the table.
+//
+#define MP_PER_CPU_INVALID_INDEX      MAX_UINTN
+
+//
+// Per CPU data areas start on their own cache line, and are a multiple of
+// it in size, so CPUs writing their own area never share a line.
+//
+#define MP_PER_CPU_DATA_ALIGNMENT     64
+
+typedef struct {
+  //
+  // How the APIC ID of the calling CPU is read, fixed when the table is
+  // built: the x2APIC ID MSR, or the xAPIC ID register at XApicIdAddress.
+  //
+  BOOLEAN   X2Apic;
+  UINTN     XApicIdAddress;
+  UINT32    MaxApicId;
+  UINT32    CpuCount;
+  UINTN     DataSize;
+  UINT8     *Data;
+  //
+  // MaxApicId + 1 entries, MAX_UINT32 for an APIC ID of no processor.
+  //
+  UINT32    *IndexByApicId;
+} MP_PER_CPU_TABLE;
+
+/**
+  Return the buffer size MpPerCpuTableInitialize needs.
+
+  @param[in] MaxApicId   Largest APIC ID of any processor.
+  @param[in] CpuCount    Number of processors.
+  @param[in] DataSize    Size of the data area of each processor, may be 0.
+
+  @return Bytes, alignment slack included.
+**/
+UINTN
+EFIAPI
+MpPerCpuTableSize (
+  IN UINT32  MaxApicId,
+  IN UINTN   CpuCount,
+  IN UINTN   DataSize
+  );
+
+/**
+  Build an empty table in Buffer, with zeroed data areas. Called by the BSP,
+  with the local APIC enabled in the mode every processor is in.
+
+  @param[out] Buffer       At least MpPerCpuTableSize bytes.
+  @param[in]  BufferSize   Size of Buffer.
+  @param[in]  MaxApicId    Largest APIC ID of any processor.
+  @param[in]  CpuCount     Number of processors.
+  @param[in]  DataSize     Size of the data area of each processor, may be 0.
+
+  @return The table at the start of Buffer, or NULL if Buffer is too small.
+**/
+MP_PER_CPU_TABLE *
+EFIAPI
+MpPerCpuTableInitialize (
+  OUT VOID    *Buffer,
+  IN  UINTN   BufferSize,
+  IN  UINT32  MaxApicId,
+  IN  UINTN   CpuCount,
+  IN  UINTN   DataSize
+  );
+
+/**
+  Enter the APIC ID of one processor.
+
+  @param[in, out] Table      The table.
+  @param[in]      CpuIndex   Processor index of the MP services.
+  @param[in]      ApicId     Its APIC ID, from GetProcessorInfo.
+
+  @retval RETURN_SUCCESS             The processor is in the table.
+  @retval RETURN_INVALID_PARAMETER   CpuIndex or ApicId is out of range.
+**/
+RETURN_STATUS
+EFIAPI
+MpPerCpuTableAdd (
+  IN OUT MP_PER_CPU_TABLE  *Table,
+  IN     UINTN             CpuIndex,
+  IN     UINT32            ApicId
+  );
+
+/**
+  Return the APIC ID of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The APIC ID.
+**/
+UINT32
+EFIAPI
+MpPerCpuApicId (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  );
+
+/**
+  Return the processor index of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The index, or MP_PER_CPU_INVALID_INDEX if the CPU is not in the
+          table.
+**/
+UINTN
+EFIAPI
+MpPerCpuIndex (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  );
+
+/**
+  Return the data area of a processor.
+
+  @param[in] Table      The table.
+  @param[in] CpuIndex   The processor.
+
+  @return The data area, or NULL if CpuIndex is out of range or the table
+          has no data areas.
+**/
+VOID *
+EFIAPI
+MpPerCpuDataOf (
+  IN CONST MP_PER_CPU_TABLE  *Table,
+  IN UINTN                   CpuIndex
+  );
+
+/**
+  Return the data area of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The data area, or NULL if the CPU is not in the table or the table
+          has no data areas.
+**/
+VOID *
+EFIAPI
+MpPerCpuData (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  );
+
+#endif
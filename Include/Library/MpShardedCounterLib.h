@@ -0,0 +1,158 @@
+/** @file
+  Sharded event counters for MP procedures.
+
+  A counter every AP increments with InterlockedIncrement bounces its cache
+  line from CPU to CPU, each increment waits for the line, and the count
+  distorts the timing it is meant to describe. A MP_SHARDED_COUNTER gives
+  every CPU a shard of its own, one cache line holding up to
+  MP_SHARDED_COUNTER_MAX counters: a CPU adds to its own shard with a plain
+  add, and the BSP sums the shards when it reads a counter.
+
+  The shards are indexed by processor number and live in one buffer of the
+  caller. They are not built on the data areas of a MP_PER_CPU_TABLE: those
+  are sized once when the table is built, so a counter could not be added
+  next to the data a module already keeps there, and a table needs every
+  APIC ID, which the callers that fall back to WhoAmI do not have. The shard
+  stride is the MP_PER_CPU_DATA_ALIGNMENT cache line all the same.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_SHARDED_COUNTER_LIB_H_
+#define _MP_SHARDED_COUNTER_LIB_H_
+
+//
+// Counters per shard, one UINT64 each, which fill one cache line.
+//
+#define MP_SHARDED_COUNTER_MAX          8
+
+//
+// Shards start on their own cache line, so CPUs adding to their own shard
+// never share a line.
+//
+#define MP_SHARDED_COUNTER_ALIGNMENT    64
+
+typedef struct {
+  volatile UINT64   Value[MP_SHARDED_COUNTER_MAX];
+} MP_SHARDED_COUNTER_SHARD;
+
+typedef struct {
+  UINT32                      ShardCount;
+  UINT32                      CounterCount;
+  MP_SHARDED_COUNTER_SHARD    *Shard;
+} MP_SHARDED_COUNTER;
+
+/**
+  Return the buffer size MpShardedCounterInitialize needs.
+
+  @param[in] ShardCount   Number of shards, usually the number of processors.
+
+  @return Bytes, alignment slack included, or 0 if that overflows.
+**/
+UINTN
+EFIAPI
+MpShardedCounterSize (
+  IN UINTN  ShardCount
+  );
+
+/**
+  Build zeroed counters in Buffer.
+
+  @param[out] Buffer         At least MpShardedCounterSize bytes.
+  @param[in]  BufferSize     Size of Buffer.
+  @param[in]  ShardCount     Number of shards, usually the number of
+                             processors.
+  @param[in]  CounterCount   Number of counters, 1 to MP_SHARDED_COUNTER_MAX.
+
+  @return The counters at the start of Buffer, or NULL if Buffer is too small
+          or CounterCount is out of range.
+**/
+MP_SHARDED_COUNTER *
+EFIAPI
+MpShardedCounterInitialize (
+  OUT VOID   *Buffer,
+  IN  UINTN  BufferSize,
+  IN  UINTN  ShardCount,
+  IN  UINTN  CounterCount
+  );
+
+/**
+  Add to a counter in one shard. Only the CPU owning the shard may call it,
+  usually with its own processor index as Shard.
+
+  @param[in, out] Counter   The counters.
+  @param[in]      Shard     The shard of the calling CPU.
+  @param[in]      Id        The counter.
+  @param[in]      Value     Amount to add.
+**/
+VOID
+EFIAPI
+MpShardedCounterAdd (
+  IN OUT MP_SHARDED_COUNTER  *Counter,
+  IN     UINTN               Shard,
+  IN     UINTN               Id,
+  IN     UINT64              Value
+  );
+
+/**
+  Add 1 to a counter in one shard. Only the CPU owning the shard may call it.
+
+  @param[in, out] Counter   The counters.
+  @param[in]      Shard     The shard of the calling CPU.
+  @param[in]      Id        The counter.
+**/
+VOID
+EFIAPI
+MpShardedCounterIncrement (
+  IN OUT MP_SHARDED_COUNTER  *Counter,
+  IN     UINTN               Shard,
+  IN     UINTN               Id
+  );
+
+/**
+  Return the sum of a counter over all shards. Exact once the procedures
+  adding to it have completed, an estimate while they run.
+
+  @param[in]  Counter   The counters.
+  @param[in]  Id        The counter.
+
+  @return The sum, 0 for an Id out of range.
+**/
+UINT64
+EFIAPI
+MpShardedCounterRead (
+  IN CONST MP_SHARDED_COUNTER  *Counter,
+  IN UINTN                     Id
+  );
+
+/**
+  Return a counter of one shard.
+
+  @param[in]  Counter   The counters.
+  @param[in]  Shard     The shard.
+  @param[in]  Id        The counter.
+
+  @return The value, 0 for a Shard or Id out of range.
+**/
+UINT64
+EFIAPI
+MpShardedCounterReadShard (
+  IN CONST MP_SHARDED_COUNTER  *Counter,
+  IN UINTN                     Shard,
+  IN UINTN                     Id
+  );
+
+/**
+  Zero all counters of all shards. Called while no procedure adds to them.
+
+  @param[in, out] Counter   The counters.
+**/
+VOID
+EFIAPI
+MpShardedCounterReset (
+  IN OUT MP_SHARDED_COUNTER  *Counter
+  );
+
+#endif
@@ -0,0 +1,173 @@
+/** @file
+  Synthetic procedure bodies for the MP tests of UnitTestPkg.
+
+  A procedure body that only spins on CpuPause keeps its caches and the
+  memory subsystem idle. The profiles here keep a CPU busy for a given time
+  the way real handlers do: computing, streaming through memory, missing in
+  the caches, or contending on a shared counter.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_WORKLOAD_LIB_H_
+#define _MP_WORKLOAD_LIB_H_
+
+typedef enum {
+  //
+  // CpuPause busy wait, what Sleep () does.
+  //
+  MpWorkloadSpin,
+  //
+  // Integer multiply/xorshift chain, registers only.
+  //
+  MpWorkloadInteger,
+  //
+  // SSE2 double precision multiply-add chains. Every batch saves and
+  // restores the SSE state around the kernel, as a handler using SSE in SMM
+  // has to. X64 only, on CPUs with CR4.OSFXSR set.
+  //
+  MpWorkloadFloatingPoint,
+  //
+  // Read-modify-write pass over a per-CPU buffer, optionally throttled to a
+  // target bandwidth.
+  //
+  MpWorkloadStream,
+  //
+  // Dependent loads along a random cycle through a per-CPU buffer, one cache
+  // line per hop.
+  //
+  MpWorkloadPointerChase,
+  //
+  // Locked increments of one counter shared by all CPUs running the workload.
+  //
+  MpWorkloadSharedCounter,
+  MpWorkloadProfileMax
+} MP_WORKLOAD_PROFILE;
+
+//
+// One workload, shared by all CPUs running it. Each run claims the next
+// buffer slot, so up to SlotCount CPUs get a buffer of their own.
+//
+typedef struct {
+  MP_WORKLOAD_PROFILE    Profile;
+  UINT8                  *Buffer;
+  UINTN                  SlotSize;
+  UINTN                  SlotCount;
+  UINT32                 BandwidthMBps;
+  volatile UINT32        NextSlot;
+  volatile UINT32        SharedCounter;
+} MP_WORKLOAD;
+
+/**
+  Set up a workload.
+
+  The memory profiles need Buffer, SlotCount slots of SlotSize bytes each.
+  For MpWorkloadPointerChase the random cycle of every slot is built here.
+  MpWorkloadFloatingPoint is checked on the calling CPU, the CPUs running
+  the workload are expected to match it.
+
+  @param[out] Workload        The workload to set up.
+  @param[in]  Profile         The profile to run.
+  @param[in]  Buffer          Buffer of the memory profiles, may be NULL for
+                              the others.
+  @param[in]  SlotSize        Bytes per slot, a multiple of the cache line size.
+  @param[in]  SlotCount       Number of slots.
+  @param[in]  BandwidthMBps   Target bandwidth of MpWorkloadStream per CPU in
+                              MB/s, 0 for as fast as possible.
+
+  @retval RETURN_SUCCESS            The workload is ready.
+  @retval RETURN_INVALID_PARAMETER  Profile is unknown, or a memory profile
+                                    has no usable buffer.
+  @retval RETURN_UNSUPPORTED        MpWorkloadFloatingPoint on a CPU that
+                                    cannot run it.
+**/
+RETURN_STATUS
+EFIAPI
+MpWorkloadInitialize (
+  OUT MP_WORKLOAD          *Workload,
+  IN  MP_WORKLOAD_PROFILE  Profile,
+  IN  VOID                 *Buffer     OPTIONAL,
+  IN  UINTN                SlotSize,
+  IN  UINTN                SlotCount,
+  IN  UINT32               BandwidthMBps
+  );
+
+/**
+  Set up the workload a test runs as its procedure body, for a profile
+  chosen at run time.
+
+  The buffer of the memory profiles is allocated here on first use, SlotCount
+  slots of SlotSize bytes, and returned in Buffer for the caller to keep for
+  later selections. A buffer allocated by a failing selection is freed again.
+
+  @param[out]     Workload        The workload to set up.
+  @param[in]      Profile         The MP_WORKLOAD_PROFILE.
+  @param[in, out] Buffer          Buffer of the memory profiles, NULL until
+                                  one is allocated.
+  @param[in]      SlotSize        Bytes per slot, a multiple of the cache line
+                                  size.
+  @param[in]      SlotCount       Number of slots.
+  @param[in]      BandwidthMBps   Target bandwidth of MpWorkloadStream per CPU
+                                  in MB/s, 0 for as fast as possible.
+
+  @return Workload, or NULL to keep the CpuPause spin: for MpWorkloadSpin, an
+          unknown profile or no memory for the buffer.
+**/
+MP_WORKLOAD *
+EFIAPI
+MpWorkloadSelect (
+  OUT    MP_WORKLOAD  *Workload,
+  IN     UINTN        Profile,
+  IN OUT VOID         **Buffer,
+  IN     UINTN        SlotSize,
+  IN     UINTN        SlotCount,
+  IN     UINT32       BandwidthMBps
+  );
+
+/**
+  Run a workload on the calling CPU.
+
+  May be called by several CPUs at the same time.
+
+  @param[in, out] Workload        The workload.
+  @param[in]      DurationTicks   Performance counter ticks to run, 0 returns
+                                  at once.
+
+  @return Work done, in the unit returned by MpWorkloadProfileUnit.
+**/
+UINT64
+EFIAPI
+MpWorkloadRun (
+  IN OUT MP_WORKLOAD  *Workload,
+  IN     UINT64       DurationTicks
+  );
+
+/**
+  Return the name of a profile.
+
+  @param[in] Profile   The profile.
+
+  @return The name, "unknown" for an invalid profile.
+**/
+CONST CHAR8 *
+EFIAPI
+MpWorkloadProfileName (
+  IN MP_WORKLOAD_PROFILE  Profile
+  );
+
+/**
+  Return the unit of the work MpWorkloadRun reports for a profile.
+
+  @param[in] Profile   The profile.
+
+  @return The unit, e.g. "bytes".
+**/
+CONST CHAR8 *
+EFIAPI
+MpWorkloadProfileUnit (
+  IN MP_WORKLOAD_PROFILE  Profile
+  );
+
+#endif
@@ -1,6 +1,11 @@
 /** @file
   Base Debug library instance base on Serial Port library.
   It uses PrintLib to send debug messages to serial port device.
+  Disabled levels are rejected against a cached mask before the console lock
+  is taken; the mask can be changed at runtime through DEBUG_LEVEL_CONTROL.
+  Messages are formatted one conversion at a time and streamed to the serial
+  port in small chunks, so neither their length nor the stack use is bound
+  to a message buffer.
 
   NOTE: If the Serial Port library enables hardware flow control, then a call
   to DebugPrint() or DebugAssert() may hang if writes to the serial port are
@@ -21,13 +26,28 @@
 #include <Library/SerialPortLib.h>
 #include <Library/DebugPrintErrorLevelLib.h>
 #include <Library/SynchronizationLib.h>
+#include <DebugLevelControl.h>
+
+SPIN_LOCK                                   mConsoleLogLock;
 
 //
-// Define the maximum debug and assert message length that this library supports
+// Level mask of this module. DebugPrint tests it before it takes
+// mConsoleLogLock, so the padding keeps the lock and every other written
+// global off its cache line. Generation is the DEBUG_LEVEL_CONTROL
+// generation the mask was loaded from, 0 while nothing is cached. Without
+// a control block the mask is never cached but read from
+// GetDebugPrintErrorLevel () on every call, which follows dynamic
+// DebugPrintErrorLevelLib instances and works in modules that run in
+// place, where writes to globals are lost.
 //
-#define MAX_DEBUG_MESSAGE_LENGTH  0x100
+typedef struct {
+  UINT8     Pad0[64];
+  UINT32    Mask;
+  UINT32    Generation;
+  UINT8     Pad1[56];
+} DEBUG_LEVEL_CACHE;
 
-SPIN_LOCK                                   mConsoleLogLock;
+DEBUG_LEVEL_CACHE                           mDebugLevel;
 
 //
 // VA_LIST can not initialize to NULL for all compiler, so we use this to
@@ -35,6 +55,552 @@ SPIN_LOCK                                   mConsoleLogLock;
 //
 VA_LIST     mVaListNull;
 
+//
+// Output is collected in a chunk of DEBUG_STREAM_CHUNK_SIZE bytes and sent to
+// the serial port whenever the chunk is full, so neither the stack use nor the
+// message length depends on MAX_DEBUG_MESSAGE_LENGTH.
+//
+#define DEBUG_STREAM_CHUNK_SIZE     32
+
+//
+// Numbers, characters, GUIDs, times and status codes are converted one at a
+// time with PrintLib into a scratch buffer. Field widths beyond
+// DEBUG_STREAM_MAX_INLINE_WIDTH are padded by the stream instead.
+//
+#define DEBUG_STREAM_SCRATCH_SIZE       48
+#define DEBUG_STREAM_MAX_INLINE_WIDTH   24
+
+//
+// Longest conversion specification rebuilt for PrintLib, e.g. "%-+,24.24lx".
+//
+#define DEBUG_STREAM_SPEC_SIZE          16
+
+typedef struct {
+  UINTN     Length;
+  CHAR8     Chunk[DEBUG_STREAM_CHUNK_SIZE];
+} DEBUG_STREAM;
+
+//
+// Fields of one conversion specification.
+//
+typedef struct {
+  BOOLEAN   LeftJustify;
+  BOOLEAN   ZeroPad;
+  BOOLEAN   Long;
+  BOOLEAN   HasPrecision;
+  UINTN     Width;
+  UINTN     Precision;
+  CHAR8     Flags[4];
+  UINTN     FlagCount;
+  CHAR8     Type;
+} DEBUG_STREAM_SPEC;
+
+/**
+  Send the collected output to the serial port.
+
+  @param[in, out] Stream   The output stream.
+**/
+STATIC
+VOID
+DebugStreamFlush (
+  IN OUT DEBUG_STREAM  *Stream
+  )
+{
+  if (Stream->Length != 0) {
+    SerialPortWrite ((UINT8 *)Stream->Chunk, Stream->Length);
+    Stream->Length = 0;
+  }
+}
+
+/**
+  Append bytes to the output stream.
+
+  @param[in, out] Stream   The output stream.
+  @param[in]      Data     The bytes.
+  @param[in]      Length   Number of bytes.
+**/
+STATIC
+VOID
+DebugStreamPut (
+  IN OUT DEBUG_STREAM  *Stream,
+  IN     CONST CHAR8   *Data,
+  IN     UINTN         Length
+  )
+{
+  UINTN  Count;
+
+  while (Length != 0) {
+    if (Stream->Length == DEBUG_STREAM_CHUNK_SIZE) {
+      DebugStreamFlush (Stream);
+    }
+    Count = MIN (Length, DEBUG_STREAM_CHUNK_SIZE - Stream->Length);
+    CopyMem (Stream->Chunk + Stream->Length, Data, Count);
+    Stream->Length += Count;
+    Data           += Count;
+    Length         -= Count;
+  }
+}
+
+/**
+  Append one character to the output stream, Count times.
+
+  @param[in, out] Stream      The output stream.
+  @param[in]      Character   The character.
+  @param[in]      Count       Number of copies.
+**/
+STATIC
+VOID
+DebugStreamPutRepeat (
+  IN OUT DEBUG_STREAM  *Stream,
+  IN     CHAR8         Character,
+  IN     UINTN         Count
+  )
+{
+  while (Count-- != 0) {
+    DebugStreamPut (Stream, &Character, 1);
+  }
+}
+
+/**
+  Append a string argument, honoring precision and width.
+
+  The string is read once, unless a right justified width asks for its
+  length up front. CHAR16 characters outside ASCII are written as '?', as
+  PrintLib writes them.
+
+  @param[in, out] Stream   The output stream.
+  @param[in]      Spec     The conversion specification.
+  @param[in]      String   The string, CHAR8 or CHAR16 as Unicode says.
+  @param[in]      Unicode  TRUE for a CHAR16 string.
+**/
+STATIC
+VOID
+DebugStreamPutString (
+  IN OUT DEBUG_STREAM             *Stream,
+  IN     CONST DEBUG_STREAM_SPEC  *Spec,
+  IN     CONST VOID               *String,
+  IN     BOOLEAN                  Unicode
+  )
+{
+  UINTN         Limit;
+  UINTN         Length;
+  UINTN         Index;
+  CHAR16        Wide;
+  CHAR8         Character;
+
+  if (String == NULL) {
+    String  = "<null string>";
+    Unicode = FALSE;
+  }
+
+  Limit = Spec->HasPrecision ? Spec->Precision : MAX_UINTN;
+
+  Length = 0;
+  if (Spec->Width != 0 && !Spec->LeftJustify) {
+    while (Length < Limit &&
+           (Unicode ? ((CONST CHAR16 *)String)[Length] : ((CONST CHAR8 *)String)[Length]) != 0) {
+      Length++;
+    }
+    if (Length < Spec->Width) {
+      DebugStreamPutRepeat (Stream, ' ', Spec->Width - Length);
+    }
+  }
+
+  for (Index = 0; Index < Limit; Index++) {
+    if (Unicode) {
+      Wide = ((CONST CHAR16 *)String)[Index];
+      if (Wide == L'\0') {
+        break;
+      }
+      Character = (Wide > 0x7F) ? '?' : (CHAR8) Wide;
+    } else {
+      Character = ((CONST CHAR8 *)String)[Index];
+      if (Character == '\0') {
+        break;
+      }
+    }
+    DebugStreamPut (Stream, &Character, 1);
+  }
+
+  if (Spec->LeftJustify && Index < Spec->Width) {
+    DebugStreamPutRepeat (Stream, ' ', Spec->Width - Index);
+  }
+}
+
+/**
+  Rebuild a conversion specification for PrintLib.
+
+  @param[in]  Spec         The conversion specification.
+  @param[in]  InlineWidth  TRUE to let PrintLib apply the width.
+  @param[out] Buffer       DEBUG_STREAM_SPEC_SIZE bytes for the result.
+**/
+STATIC
+VOID
+DebugStreamBuildSpec (
+  IN  CONST DEBUG_STREAM_SPEC  *Spec,
+  IN  BOOLEAN                  InlineWidth,
+  OUT CHAR8                    *Buffer
+  )
+{
+  UINTN  Index;
+
+  Index = 0;
+  Buffer[Index++] = '%';
+  CopyMem (Buffer + Index, Spec->Flags, Spec->FlagCount);
+  Index += Spec->FlagCount;
+  if (InlineWidth) {
+    if (Spec->LeftJustify) {
+      Buffer[Index++] = '-';
+    }
+    if (Spec->ZeroPad) {
+      Buffer[Index++] = '0';
+    }
+    if (Spec->Width >= 10) {
+      Buffer[Index++] = (CHAR8) ('0' + Spec->Width / 10);
+    }
+    if (Spec->Width != 0) {
+      Buffer[Index++] = (CHAR8) ('0' + Spec->Width % 10);
+    }
+  }
+  if (Spec->HasPrecision) {
+    //
+    // Only numbers get here, their precision never exceeds the 20 digits of
+    // a UINT64 in a meaningful way.
+    //
+    Buffer[Index++] = '.';
+    Buffer[Index++] = (CHAR8) ('0' + MIN (Spec->Precision, 24) / 10);
+    Buffer[Index++] = (CHAR8) ('0' + MIN (Spec->Precision, 24) % 10);
+  }
+  if (Spec->Long) {
+    Buffer[Index++] = 'l';
+  }
+  Buffer[Index++] = Spec->Type;
+  Buffer[Index]   = '\0';
+}
+
+/**
+  Format a message and stream it to the serial port chunk by chunk.
+
+  Accepts the same format strings as PrintLib, including the translation of
+  '\n' to "\r\n", but has no limit on the message length.
+
+  @param[in, out] Stream          The output stream.
+  @param[in]      Format          Format string.
+  @param[in]      VaListMarker    VA_LIST marker, used if BaseListMarker is NULL.
+  @param[in]      BaseListMarker  BASE_LIST marker for the variable argument list.
+**/
+STATIC
+VOID
+DebugStreamFormat (
+  IN OUT DEBUG_STREAM  *Stream,
+  IN     CONST CHAR8   *Format,
+  IN     VA_LIST       VaListMarker,
+  IN     BASE_LIST     BaseListMarker
+  )
+{
+  CONST CHAR8        *Literal;
+  DEBUG_STREAM_SPEC  Spec;
+  CHAR8              SpecString[DEBUG_STREAM_SPEC_SIZE];
+  CHAR8              Scratch[DEBUG_STREAM_SCRATCH_SIZE];
+  BOOLEAN            InlineWidth;
+  BOOLEAN            Done;
+  UINTN              Length;
+  UINT64             Value;
+  VOID               *Pointer;
+
+  while (*Format != '\0') {
+    //
+    // Copy the literal run up to the next conversion or line break as is.
+    //
+    Literal = Format;
+    while (*Format != '\0' && *Format != '%' && *Format != '\n' && *Format != '\r') {
+      Format++;
+    }
+    DebugStreamPut (Stream, Literal, Format - Literal);
+
+    if (*Format == '\n' || *Format == '\r') {
+      //
+      // Translate "\n", "\r\n" and "\n\r" to "\r\n", a lone '\r' stays.
+      //
+      if (*Format == '\r' && Format[1] != '\n') {
+        DebugStreamPut (Stream, "\r", 1);
+        Format++;
+        continue;
+      }
+      if ((Format[0] == '\r' && Format[1] == '\n') || (Format[0] == '\n' && Format[1] == '\r')) {
+        Format++;
+      }
+      Format++;
+      DebugStreamPut (Stream, "\r\n", 2);
+      continue;
+    }
+    if (*Format == '\0') {
+      break;
+    }
+
+    //
+    // Parse the conversion specification.
+    //
+    Format++;
+    ZeroMem (&Spec, sizeof (Spec));
+    for (Done = FALSE; !Done && *Format != '\0'; ) {
+      switch (*Format) {
+      case '-':
+        Spec.LeftJustify = TRUE;
+        Format++;
+        break;
+      case '0':
+        if (Spec.Width == 0 && !Spec.HasPrecision) {
+          Spec.ZeroPad = TRUE;
+        } else if (Spec.HasPrecision) {
+          Spec.Precision = Spec.Precision * 10;
+        } else {
+          Spec.Width = Spec.Width * 10;
+        }
+        Format++;
+        break;
+      case '+':
+      case ' ':
+      case ',':
+        if (Spec.FlagCount < sizeof (Spec.Flags)) {
+          Spec.Flags[Spec.FlagCount++] = *Format;
+        }
+        Format++;
+        break;
+      case 'l':
+      case 'L':
+        Spec.Long = TRUE;
+        Format++;
+        break;
+      case '.':
+        Spec.HasPrecision = TRUE;
+        Format++;
+        break;
+      case '*':
+        if (BaseListMarker == NULL) {
+          Length = VA_ARG (VaListMarker, UINTN);
+        } else {
+          Length = BASE_ARG (BaseListMarker, UINTN);
+        }
+        if (Spec.HasPrecision) {
+          Spec.Precision = Length;
+        } else {
+          Spec.Width = Length;
+        }
+        Format++;
+        break;
+      default:
+        if (*Format >= '1' && *Format <= '9') {
+          if (Spec.HasPrecision) {
+            Spec.Precision = Spec.Precision * 10 + (*Format - '0');
+          } else {
+            Spec.Width = Spec.Width * 10 + (*Format - '0');
+          }
+          Format++;
+        } else {
+          Spec.Type = *Format;
+          Format++;
+          Done = TRUE;
+        }
+        break;
+      }
+    }
+    if (!Done) {
+      break;
+    }
+
+    //
+    // Strings are streamed straight from the argument.
+    //
+    if (Spec.Type == 'a' || Spec.Type == 's' || Spec.Type == 'S') {
+      if (BaseListMarker == NULL) {
+        Pointer = VA_ARG (VaListMarker, VOID *);
+      } else {
+        Pointer = BASE_ARG (BaseListMarker, VOID *);
+      }
+      DebugStreamPutString (Stream, &Spec, Pointer, (BOOLEAN) (Spec.Type != 'a'));
+      continue;
+    }
+
+    //
+    // Everything else is converted by PrintLib, one argument at a time.
+    //
+    InlineWidth = (BOOLEAN) (Spec.Width <= DEBUG_STREAM_MAX_INLINE_WIDTH);
+    DebugStreamBuildSpec (&Spec, InlineWidth, SpecString);
+
+    switch (Spec.Type) {
+    case 'd':
+    case 'u':
+    case 'x':
+    case 'X':
+      if (Spec.Long) {
+        if (BaseListMarker == NULL) {
+          Value = VA_ARG (VaListMarker, UINT64);
+        } else {
+          Value = BASE_ARG (BaseListMarker, UINT64);
+        }
+        Length = AsciiSPrint (Scratch, sizeof (Scratch), SpecString, Value);
+      } else {
+        if (BaseListMarker == NULL) {
+          Value = (UINT32) VA_ARG (VaListMarker, int);
+        } else {
+          Value = (UINT32) BASE_ARG (BaseListMarker, int);
+        }
+        Length = AsciiSPrint (Scratch, sizeof (Scratch), SpecString, (UINT32) Value);
+      }
+      break;
+
+    case 'c':
+    case 'r':
+      if (BaseListMarker == NULL) {
+        Value = VA_ARG (VaListMarker, UINTN);
+      } else {
+        Value = BASE_ARG (BaseListMarker, UINTN);
+      }
+      Length = AsciiSPrint (Scratch, sizeof (Scratch), SpecString, (UINTN) Value);
+      break;
+
+    case 'p':
+    case 'g':
+    case 't':
+      if (BaseListMarker == NULL) {
+        Pointer = VA_ARG (VaListMarker, VOID *);
+      } else {
+        Pointer = BASE_ARG (BaseListMarker, VOID *);
+      }
+      Length = AsciiSPrint (Scratch, sizeof (Scratch), SpecString, Pointer);
+      break;
+
+    case '%':
+      Length = AsciiSPrint (Scratch, sizeof (Scratch), "%%");
+      break;
+
+    default:
+      //
+      // Like PrintLib, print an unknown conversion character as is.
+      //
+      Scratch[0] = Spec.Type;
+      Length     = 1;
+      break;
+    }
+
+    if (!InlineWidth && !Spec.LeftJustify && Length < Spec.Width) {
+      DebugStreamPutRepeat (Stream, Spec.ZeroPad ? '0' : ' ', Spec.Width - Length);
+    }
+    DebugStreamPut (Stream, Scratch, Length);
+    if (!InlineWidth && Spec.LeftJustify && Length < Spec.Width) {
+      DebugStreamPutRepeat (Stream, ' ', Spec.Width - Length);
+    }
+  }
+}
+
+/**
+  Format a message with a variable argument list into the output stream.
+
+  @param[in, out] Stream   The output stream.
+  @param[in]      Format   Format string.
+  @param[in]      ...      Variable argument list.
+**/
+STATIC
+VOID
+DebugStreamPrint (
+  IN OUT DEBUG_STREAM  *Stream,
+  IN     CONST CHAR8   *Format,
+  ...
+  )
+{
+  VA_LIST  Marker;
+
+  VA_START (Marker, Format);
+  DebugStreamFormat (Stream, Format, Marker, NULL);
+  VA_END (Marker);
+}
+
+/**
+  Reload the level mask of this module from the DEBUG_LEVEL_CONTROL block.
+
+  Runs only when the block carries a generation other than the cached one.
+  A writer that changes the block while it is read leaves the cached mask
+  in place; the next call picks the update up. The mask is returned as
+  well as cached, so a module running in place, whose cache write is lost,
+  still gets it.
+
+  @param[in]  Control      The control block.
+  @param[in]  Generation   Even, non-zero generation read from Control.
+
+  @return The DEBUG_* bits enabled for this module.
+**/
+STATIC
+UINT32
+DebugLevelReload (
+  IN volatile DEBUG_LEVEL_CONTROL  *Control,
+  IN UINT32                        Generation
+  )
+{
+  UINT32  Mask;
+  UINTN   Count;
+  UINTN   Index;
+
+  Mask  = Control->GlobalMask;
+  Count = MIN (Control->ModuleCount, DEBUG_LEVEL_CONTROL_MAX_MODULES);
+  for (Index = 0; Index < Count; Index++) {
+    if (CompareGuid ((GUID *)&Control->Module[Index].ModuleGuid, &gEfiCallerIdGuid)) {
+      Mask = Control->Module[Index].Mask;
+      break;
+    }
+  }
+
+  MemoryFence ();
+  if (Control->Generation != Generation) {
+    return (mDebugLevel.Generation != 0) ? mDebugLevel.Mask : (UINT32) GetDebugPrintErrorLevel ();
+  }
+
+  mDebugLevel.Mask       = Mask;
+  mDebugLevel.Generation = Generation;
+  return Mask;
+}
+
+/**
+  Return the level mask of this module.
+
+  While the control block is unchanged this reads only the block header
+  and mDebugLevel, neither of which is written on this path. With no
+  control block, or one that overrides nothing, the mask comes from
+  GetDebugPrintErrorLevel ().
+
+  @return The DEBUG_* bits enabled for this module.
+**/
+STATIC
+UINT32
+DebugLevelMask (
+  VOID
+  )
+{
+  volatile DEBUG_LEVEL_CONTROL  *Control;
+  UINT32                        Generation;
+
+  Control = (volatile DEBUG_LEVEL_CONTROL *)(UINTN) PcdGet64 (PcdDebugLevelControlAddress);
+  if (Control == NULL || Control->Signature != DEBUG_LEVEL_CONTROL_SIGNATURE) {
+    return (UINT32) GetDebugPrintErrorLevel ();
+  }
+
+  Generation = Control->Generation;
+  if (Generation == 0) {
+    return (UINT32) GetDebugPrintErrorLevel ();
+  }
+  if (Generation == mDebugLevel.Generation) {
+    return mDebugLevel.Mask;
+  }
+  if ((Generation & BIT0) != 0) {
+    //
+    // A writer is updating the block, keep the last mask loaded from it.
+    //
+    return (mDebugLevel.Generation != 0) ? mDebugLevel.Mask : (UINT32) GetDebugPrintErrorLevel ();
+  }
+
+  return DebugLevelReload (Control, Generation);
+}
+
 /**
   The constructor function initialize the Serial Port Library
 
@@ -77,6 +643,13 @@ DebugPrint (
 {
   VA_LIST  Marker;
 
+  //
+  // Reject disabled levels before touching the lock.
+  //
+  if ((ErrorLevel & DebugLevelMask ()) == 0) {
+    return;
+  }
+
   AcquireSpinLock (&mConsoleLogLock);
 
   VA_START (Marker, Format);
@@ -113,7 +686,7 @@ DebugPrintMarker (
   IN  BASE_LIST     BaseListMarker
   )
 {
-  CHAR8    Buffer[MAX_DEBUG_MESSAGE_LENGTH];
+  DEBUG_STREAM  Stream;
 
   //
   // If Format is NULL, then ASSERT().
@@ -121,25 +694,18 @@ DebugPrintMarker (
   ASSERT (Format != NULL);
 
   //
-  // Check driver debug mask value and global mask
+  // Check the cached module mask, see DebugLevelMask ()
   //
-  if ((ErrorLevel & GetDebugPrintErrorLevel ()) == 0) {
+  if ((ErrorLevel & DebugLevelMask ()) == 0) {
     return;
   }
 
   //
-  // Convert the DEBUG() message to an ASCII String
-  //
-  if (BaseListMarker == NULL) {
-    AsciiVSPrint (Buffer, sizeof (Buffer), Format, VaListMarker);
-  } else {
-    AsciiBSPrint (Buffer, sizeof (Buffer), Format, BaseListMarker);
-  }
-
-  //
-  // Send the print string to a Serial Port
+  // Stream the DEBUG() message to the Serial Port
   //
-  SerialPortWrite ((UINT8 *)Buffer, AsciiStrLen (Buffer));
+  Stream.Length = 0;
+  DebugStreamFormat (&Stream, Format, VaListMarker, BaseListMarker);
+  DebugStreamFlush (&Stream);
 }
 
 
@@ -228,17 +794,14 @@ DebugAssert (
   IN CONST CHAR8  *Description
   )
 {
-  CHAR8  Buffer[MAX_DEBUG_MESSAGE_LENGTH];
-
-  //
-  // Generate the ASSERT() message in Ascii format
-  //
-  AsciiSPrint (Buffer, sizeof (Buffer), "ASSERT [%a] %a(%d): %a\n", gEfiCallerBaseName, FileName, LineNumber, Description);
+  DEBUG_STREAM  Stream;
 
   //
-  // Send the print string to the Console Output device
+  // Stream the ASSERT() message to the Console Output device
   //
-  SerialPortWrite ((UINT8 *)Buffer, AsciiStrLen (Buffer));
+  Stream.Length = 0;
+  DebugStreamPrint (&Stream, "ASSERT [%a] %a(%d): %a\n", gEfiCallerBaseName, FileName, LineNumber, Description);
+  DebugStreamFlush (&Stream);
 
   //
   // Generate a Breakpoint, DeadLoop, or NOP based on PCD settings
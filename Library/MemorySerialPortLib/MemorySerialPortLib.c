@@ -0,0 +1,180 @@
+/** @file
+  SerialPortLib instance writing to a ring buffer in memory.
+
+  It stands in for the UART when the cost of the debug output path is to be
+  measured apart from the line speed: a write is one CopyMem into
+  mMemorySerialPort, which keeps the last MEMORY_SERIAL_PORT_SIZE bytes for
+  a debugger to look at. There is no input.
+
+  Writes are not serialized here, callers do that, as DebugLib does with its
+  console lock.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SerialPortLib.h>
+
+//
+// A power of two, so the ring offset is a mask.
+//
+#define MEMORY_SERIAL_PORT_SIZE     SIZE_64KB
+
+UINT8    mMemorySerialPort[MEMORY_SERIAL_PORT_SIZE];
+
+//
+// Bytes written since initialization, the ring offset is its low bits.
+//
+UINT64   mMemorySerialPortWritten;
+
+/**
+  Initialize the serial device hardware.
+
+  @retval RETURN_SUCCESS   Always, there is no hardware.
+**/
+RETURN_STATUS
+EFIAPI
+SerialPortInitialize (
+  VOID
+  )
+{
+  return RETURN_SUCCESS;
+}
+
+/**
+  Write data to the ring buffer.
+
+  @param  Buffer          Pointer to the data buffer to be written.
+  @param  NumberOfBytes   Number of bytes to written to the serial device.
+
+  @retval 0      NumberOfBytes is 0 or Buffer is NULL.
+  @retval >0     The number of bytes written, always NumberOfBytes.
+**/
+UINTN
+EFIAPI
+SerialPortWrite (
+  IN UINT8  *Buffer,
+  IN UINTN  NumberOfBytes
+  )
+{
+  UINTN  Offset;
+  UINTN  Count;
+  UINTN  Left;
+
+  if (Buffer == NULL) {
+    return 0;
+  }
+
+  //
+  // Of a write longer than the ring only the tail survives.
+  //
+  Left = NumberOfBytes;
+  if (Left > MEMORY_SERIAL_PORT_SIZE) {
+    Buffer += Left - MEMORY_SERIAL_PORT_SIZE;
+    Left    = MEMORY_SERIAL_PORT_SIZE;
+  }
+
+  Offset = (UINTN) mMemorySerialPortWritten & (MEMORY_SERIAL_PORT_SIZE - 1);
+  Count  = MIN (Left, MEMORY_SERIAL_PORT_SIZE - Offset);
+  CopyMem (&mMemorySerialPort[Offset], Buffer, Count);
+  CopyMem (&mMemorySerialPort[0], Buffer + Count, Left - Count);
+
+  mMemorySerialPortWritten += NumberOfBytes;
+  return NumberOfBytes;
+}
+
+/**
+  Read data from the serial device, which has none.
+
+  @param  Buffer          Pointer to the data buffer to store the data read from the serial device.
+  @param  NumberOfBytes   Number of bytes to read from the serial device.
+
+  @retval 0   Always.
+**/
+UINTN
+EFIAPI
+SerialPortRead (
+  OUT UINT8  *Buffer,
+  IN  UINTN  NumberOfBytes
+  )
+{
+  return 0;
+}
+
+/**
+  Polls a serial device to see if there is any data waiting to be read.
+
+  @retval FALSE   Always, there is no input.
+**/
+BOOLEAN
+EFIAPI
+SerialPortPoll (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Sets the control bits on a serial device.
+
+  @param Control   Sets the bits of Control that are settable.
+
+  @retval RETURN_UNSUPPORTED   There are no control bits.
+**/
+RETURN_STATUS
+EFIAPI
+SerialPortSetControl (
+  IN UINT32  Control
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  Retrieve the status of the control bits on a serial device.
+
+  @param Control   A pointer to return the current control signals from the serial device.
+
+  @retval RETURN_SUCCESS   The output buffer is always empty.
+**/
+RETURN_STATUS
+EFIAPI
+SerialPortGetControl (
+  OUT UINT32  *Control
+  )
+{
+  *Control = EFI_SERIAL_OUTPUT_BUFFER_EMPTY;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Sets the baud rate, receive FIFO depth, transmit/receive time out, parity,
+  data bits, and stop bits on a serial device.
+
+  @param BaudRate           The requested baud rate.
+  @param ReceiveFifoDepth   The requested depth of the FIFO on the receive side.
+  @param Timeout            The requested time out for a single character in microseconds.
+  @param Parity             The type of parity to use on this serial device.
+  @param DataBits           The number of data bits to use on the serial device.
+  @param StopBits           The number of stop bits to use on this serial device.
+
+  @retval RETURN_UNSUPPORTED   There are no attributes.
+**/
+RETURN_STATUS
+EFIAPI
+SerialPortSetAttributes (
+  IN OUT UINT64              *BaudRate,
+  IN OUT UINT32              *ReceiveFifoDepth,
+  IN OUT UINT32              *Timeout,
+  IN OUT EFI_PARITY_TYPE     *Parity,
+  IN OUT UINT8               *DataBits,
+  IN OUT EFI_STOP_BITS_TYPE  *StopBits
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
@@ -0,0 +1,45 @@
+/** @file
+  Start barrier of the MP benchmarks, run by every CPU taking part.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/MpBenchmarkLib.h>
+
+/**
+  Arrive at a barrier and wait until Count CPUs have arrived.
+
+  Every CPU taking part calls it once on the same counter, which the caller
+  zeroes before it starts them, so their timed loops overlap. A CPU gives up
+  after MP_BENCH_BARRIER_SPINS CpuPause rounds, in case some CPU never runs
+  the procedure.
+
+  @param[in, out] Arrived   The barrier counter, alone in its cache line.
+  @param[in]      Count     Number of CPUs taking part.
+
+  @retval TRUE    All Count CPUs arrived.
+  @retval FALSE   The wait gave up.
+**/
+BOOLEAN
+EFIAPI
+MpBenchBarrierWait (
+  IN OUT volatile UINT32  *Arrived,
+  IN     UINTN            Count
+  )
+{
+  UINTN  Spin;
+
+  InterlockedIncrement (Arrived);
+  for (Spin = 0; *Arrived < Count; Spin++) {
+    if (Spin == MP_BENCH_BARRIER_SPINS) {
+      return FALSE;
+    }
+    CpuPause ();
+  }
+  return TRUE;
+}
@@ -0,0 +1,77 @@
+/** @file
+  Stack high-watermark helpers of MpBenchmarkLib.
+
+  Unlike the rest of the library these run on the AP being measured. They are
+  leaf functions and touch memory through volatile pointers only, so the
+  compiler neither calls SetMem for the paint loop nor drops it.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/MpBenchmarkLib.h>
+
+//
+// Bytes left unpainted below the local variable of MpBenchStackPaint, so the
+// paint loop does not overwrite its own frame.
+//
+#define MP_BENCH_STACK_GUARD    64
+
+/**
+  Paint the stack below the caller's frame.
+
+  @param[out] Paint   Painted window, must be a local variable of the caller.
+  @param[in]  Size    Bytes to paint.
+**/
+VOID
+EFIAPI
+MpBenchStackPaint (
+  OUT MP_BENCH_STACK_PAINT  *Paint,
+  IN  UINTN                 Size
+  )
+{
+  volatile UINT64  Probe;
+  volatile UINT64  *Slot;
+  UINTN            Top;
+
+  Probe = MP_BENCH_STACK_PATTERN;
+  Top   = ((UINTN) &Probe - MP_BENCH_STACK_GUARD) & ~(UINTN) (sizeof (UINT64) - 1);
+  Size  = Size & ~(UINTN) (sizeof (UINT64) - 1);
+
+  for (Slot = (volatile UINT64 *) (Top - Size); (UINTN) Slot < Top; Slot++) {
+    *Slot = MP_BENCH_STACK_PATTERN;
+  }
+
+  Paint->Base   = (UINTN) Paint;
+  Paint->Bottom = Top - Size;
+}
+
+/**
+  Scan a painted window for the deepest byte used since it was painted.
+
+  @param[in] Paint   Window painted by MpBenchStackPaint in the same frame.
+
+  @return Stack bytes used below the caller's frame, or MP_BENCH_STACK_OVERFLOW
+          if the whole window was used.
+**/
+UINTN
+EFIAPI
+MpBenchStackScan (
+  IN CONST MP_BENCH_STACK_PAINT  *Paint
+  )
+{
+  volatile UINT64  *Slot;
+
+  Slot = (volatile UINT64 *) Paint->Bottom;
+  if (*Slot != MP_BENCH_STACK_PATTERN) {
+    return MP_BENCH_STACK_OVERFLOW;
+  }
+
+  while ((UINTN) Slot < Paint->Base && *Slot == MP_BENCH_STACK_PATTERN) {
+    Slot++;
+  }
+
+  return Paint->Base - (UINTN) Slot;
+}
@@ -0,0 +1,166 @@
+/** @file
+  Cross-CPU TSC offset helpers of MpBenchmarkLib.
+
+  MpBenchTscExchangeServe runs on the measured CPU and MpBenchTscExchangeMeasure
+  on the reference CPU, concurrently, on the same mailbox. Neither spin loop
+  calls CpuPause: it would add its own latency to every reply and widen the
+  error bound.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/TimerLib.h>
+#include <Library/MpBenchmarkLib.h>
+
+//
+// Spins between two reads of the performance counter while waiting for a
+// reply. Reading it may be slow, an I/O port access for the ACPI timer, and
+// a round whose reply lands during the read only gets a wider interval.
+//
+#define MP_BENCH_TSC_TIMEOUT_CHECK    1024
+
+/**
+  Answer the TSC exchange requests of the reference CPU until it sends
+  MP_BENCH_TSC_EXCHANGE_STOP.
+
+  @param[in, out] Exchange   The mailbox.
+**/
+VOID
+EFIAPI
+MpBenchTscExchangeServe (
+  IN OUT MP_BENCH_TSC_EXCHANGE  *Exchange
+  )
+{
+  UINT64  Request;
+
+  for ( ; ;) {
+    Request = Exchange->Request;
+    if (Request == Exchange->Reply) {
+      continue;
+    }
+    if (Request == MP_BENCH_TSC_EXCHANGE_STOP) {
+      return;
+    }
+
+    //
+    // Stamp is written before Reply, and x86 stores are not reordered with
+    // each other, so the reference CPU reads the stamp of this round.
+    //
+    Exchange->Stamp = AsmReadTsc ();
+    Exchange->Reply = Request;
+  }
+}
+
+/**
+  Estimate the TSC offset of the CPU serving a mailbox.
+
+  @param[in, out] Exchange                The mailbox.
+  @param[in]      Rounds                  Number of request rounds.
+  @param[in]      TimeoutInMicroseconds   Time to wait for each reply.
+  @param[out]     Offset                  The estimate.
+
+  @retval TRUE    Offset is valid.
+  @retval FALSE   The measured CPU did not answer in time.
+**/
+BOOLEAN
+EFIAPI
+MpBenchTscExchangeMeasure (
+  IN OUT MP_BENCH_TSC_EXCHANGE  *Exchange,
+  IN     UINTN                  Rounds,
+  IN     UINTN                  TimeoutInMicroseconds,
+  OUT    MP_BENCH_TSC_OFFSET    *Offset
+  )
+{
+  UINTN   Round;
+  UINTN   Spin;
+  UINT64  Before;
+  UINT64  After;
+  UINT64  Stamp;
+  UINT64  WaitStart;
+  INT64   Low;
+  INT64   High;
+  INT64   RoundLow;
+  INT64   RoundHigh;
+
+  Offset->Offset     = 0;
+  Offset->Error      = 0;
+  Offset->RoundTrip  = MAX_UINT64;
+  Offset->Valid      = FALSE;
+  Offset->Consistent = FALSE;
+
+  Low  = MIN_INT64;
+  High = MAX_INT64;
+
+  for (Round = 1; Round <= Rounds; Round++) {
+    WaitStart = GetPerformanceCounter ();
+    Spin      = 0;
+
+    Before            = AsmReadTsc ();
+    Exchange->Request = Round;
+    while (Exchange->Reply != Round) {
+      if (++Spin % MP_BENCH_TSC_TIMEOUT_CHECK == 0 &&
+          MpBenchElapsedNs (WaitStart, GetPerformanceCounter ()) > MultU64x32 (TimeoutInMicroseconds, 1000)) {
+        Exchange->Request = MP_BENCH_TSC_EXCHANGE_STOP;
+        return FALSE;
+      }
+    }
+    After = AsmReadTsc ();
+    Stamp = Exchange->Stamp;
+
+    //
+    // The stamp was taken between Before and After on the reference TSC.
+    //
+    RoundLow  = (INT64) (Stamp - After);
+    RoundHigh = (INT64) (Stamp - Before);
+    Low       = MAX (Low, RoundLow);
+    High      = MIN (High, RoundHigh);
+
+    if (After - Before < Offset->RoundTrip) {
+      Offset->RoundTrip = After - Before;
+      Offset->Offset    = RoundLow + (RoundHigh - RoundLow) / 2;
+      Offset->Error     = (UINT64) (RoundHigh - RoundLow) / 2;
+    }
+  }
+
+  Exchange->Request = MP_BENCH_TSC_EXCHANGE_STOP;
+
+  if (Rounds == 0) {
+    return FALSE;
+  }
+
+  Offset->Valid      = TRUE;
+  Offset->Consistent = (BOOLEAN) (Low <= High);
+  if (Offset->Consistent) {
+    Offset->Offset = Low + (High - Low) / 2;
+    Offset->Error  = (UINT64) (High - Low) / 2;
+  }
+
+  return TRUE;
+}
+
+/**
+  Translate a TSC value read on a measured CPU to the reference CPU TSC.
+
+  @param[in] Offset   Offset of the measured CPU, may be NULL.
+  @param[in] Tsc      TSC value read on the measured CPU.
+
+  @return The reference TSC value, or Tsc unchanged if there is no valid
+          offset.
+**/
+UINT64
+EFIAPI
+MpBenchTscToReference (
+  IN CONST MP_BENCH_TSC_OFFSET  *Offset,
+  IN UINT64                     Tsc
+  )
+{
+  if (Offset == NULL || !Offset->Valid) {
+    return Tsc;
+  }
+
+  return Tsc - (UINT64) Offset->Offset;
+}
@@ -0,0 +1,325 @@
+/** @file
+  Helpers shared by the MP benchmarks of UnitTestPkg.
+
+  All functions are meant to be called by the BSP. Accumulators are plain
+  memory, an AP may fill its own one and the BSP merges them afterwards.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/MpBenchmarkLib.h>
+
+/**
+  Return the histogram bucket of a sample.
+
+  @param[in] Value   The sample.
+
+  @return The bucket index.
+**/
+STATIC
+UINTN
+MpBenchBucket (
+  IN UINT64  Value
+  )
+{
+  UINTN  Bucket;
+
+  if (Value == 0) {
+    return 0;
+  }
+
+  Bucket = (UINTN) HighBitSet64 (Value) + 1;
+  if (Bucket >= MP_BENCH_HISTOGRAM_BUCKETS) {
+    Bucket = MP_BENCH_HISTOGRAM_BUCKETS - 1;
+  }
+  return Bucket;
+}
+
+/**
+  Return the exclusive upper edge of a histogram bucket.
+
+  @param[in] Bucket   The bucket index.
+
+  @return The upper edge, MAX_UINT64 for the last bucket.
+**/
+STATIC
+UINT64
+MpBenchBucketLimit (
+  IN UINTN  Bucket
+  )
+{
+  if (Bucket >= MP_BENCH_HISTOGRAM_BUCKETS - 1) {
+    return MAX_UINT64;
+  }
+  return LShiftU64 (1, Bucket);
+}
+
+/**
+  Clear a statistics accumulator.
+
+  @param[out] Stats   The accumulator to clear.
+**/
+VOID
+EFIAPI
+MpBenchStatsReset (
+  OUT MP_BENCH_STATS  *Stats
+  )
+{
+  ZeroMem (Stats, sizeof (*Stats));
+  Stats->Min = MAX_UINT64;
+}
+
+/**
+  Add one sample to a statistics accumulator.
+
+  @param[in, out] Stats   The accumulator.
+  @param[in]      Value   The sample, in whatever unit the caller uses.
+**/
+VOID
+EFIAPI
+MpBenchStatsAdd (
+  IN OUT MP_BENCH_STATS  *Stats,
+  IN     UINT64          Value
+  )
+{
+  Stats->Count++;
+  Stats->Sum += Value;
+  if (Value < Stats->Min) {
+    Stats->Min = Value;
+  }
+  if (Value > Stats->Max) {
+    Stats->Max = Value;
+  }
+  Stats->Histogram[MpBenchBucket (Value)]++;
+}
+
+/**
+  Merge all samples of one accumulator into another.
+
+  @param[in, out] Stats   The accumulator receiving the samples.
+  @param[in]      Other   The accumulator to merge.
+**/
+VOID
+EFIAPI
+MpBenchStatsMerge (
+  IN OUT MP_BENCH_STATS        *Stats,
+  IN     CONST MP_BENCH_STATS  *Other
+  )
+{
+  UINTN  Bucket;
+
+  if (Other->Count == 0) {
+    return;
+  }
+
+  Stats->Count += Other->Count;
+  Stats->Sum   += Other->Sum;
+  if (Other->Min < Stats->Min) {
+    Stats->Min = Other->Min;
+  }
+  if (Other->Max > Stats->Max) {
+    Stats->Max = Other->Max;
+  }
+  for (Bucket = 0; Bucket < MP_BENCH_HISTOGRAM_BUCKETS; Bucket++) {
+    Stats->Histogram[Bucket] += Other->Histogram[Bucket];
+  }
+}
+
+/**
+  Return the mean of the samples, or 0 if there is none.
+
+  @param[in] Stats   The accumulator.
+
+  @return The mean, rounded down.
+**/
+UINT64
+EFIAPI
+MpBenchStatsMean (
+  IN CONST MP_BENCH_STATS  *Stats
+  )
+{
+  if (Stats->Count == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder (Stats->Sum, Stats->Count, NULL);
+}
+
+/**
+  Return an upper bound of the given percentile.
+
+  @param[in] Stats     The accumulator.
+  @param[in] Percent   The percentile, 0 to 100.
+
+  @return The percentile bound, or 0 if there is no sample.
+**/
+UINT64
+EFIAPI
+MpBenchStatsPercentile (
+  IN CONST MP_BENCH_STATS  *Stats,
+  IN UINTN                 Percent
+  )
+{
+  UINT64  Target;
+  UINT64  Seen;
+  UINTN   Bucket;
+
+  if (Stats->Count == 0) {
+    return 0;
+  }
+
+  //
+  // Smallest number of samples that covers Percent of them, at least one.
+  //
+  Target = DivU64x32 (MultU64x32 (Stats->Count, (UINT32) Percent) + 99, 100);
+  if (Target == 0) {
+    Target = 1;
+  }
+
+  Seen = 0;
+  for (Bucket = 0; Bucket < MP_BENCH_HISTOGRAM_BUCKETS; Bucket++) {
+    Seen += Stats->Histogram[Bucket];
+    if (Seen >= Target) {
+      return MIN (MpBenchBucketLimit (Bucket), Stats->Max);
+    }
+  }
+  return Stats->Max;
+}
+
+/**
+  Print a one line summary: count, min, mean, p50, p99 and max.
+
+  @param[in] ErrorLevel   The DEBUG error level to print at.
+  @param[in] Label        Prefix of the line.
+  @param[in] Unit         Unit of the samples, e.g. "ns".
+  @param[in] Stats        The accumulator.
+**/
+VOID
+EFIAPI
+MpBenchStatsPrint (
+  IN UINTN                 ErrorLevel,
+  IN CONST CHAR8           *Label,
+  IN CONST CHAR8           *Unit,
+  IN CONST MP_BENCH_STATS  *Stats
+  )
+{
+  if (Stats->Count == 0) {
+    DEBUG ((ErrorLevel, "%a: no sample\n", Label));
+    return;
+  }
+
+  DEBUG ((
+    ErrorLevel,
+    "%a: n=%ld min=%ld mean=%ld p50<=%ld p99<=%ld max=%ld %a\n",
+    Label,
+    Stats->Count,
+    Stats->Min,
+    MpBenchStatsMean (Stats),
+    MpBenchStatsPercentile (Stats, 50),
+    MpBenchStatsPercentile (Stats, 99),
+    Stats->Max,
+    Unit
+    ));
+}
+
+/**
+  Print one line per non-empty histogram bucket.
+
+  @param[in] ErrorLevel   The DEBUG error level to print at.
+  @param[in] Label        Prefix of every line.
+  @param[in] Unit         Unit of the samples, e.g. "ns".
+  @param[in] Stats        The accumulator.
+**/
+VOID
+EFIAPI
+MpBenchStatsPrintHistogram (
+  IN UINTN                 ErrorLevel,
+  IN CONST CHAR8           *Label,
+  IN CONST CHAR8           *Unit,
+  IN CONST MP_BENCH_STATS  *Stats
+  )
+{
+  UINTN   Bucket;
+  UINT64  Low;
+
+  for (Bucket = 0; Bucket < MP_BENCH_HISTOGRAM_BUCKETS; Bucket++) {
+    if (Stats->Histogram[Bucket] == 0) {
+      continue;
+    }
+    Low = (Bucket == 0) ? 0 : LShiftU64 (1, Bucket - 1);
+    if (Bucket == MP_BENCH_HISTOGRAM_BUCKETS - 1) {
+      DEBUG ((ErrorLevel, "%a:   >= %ld %a: %d\n", Label, Low, Unit, Stats->Histogram[Bucket]));
+    } else {
+      DEBUG ((ErrorLevel, "%a:   [%ld, %ld) %a: %d\n", Label, Low, MpBenchBucketLimit (Bucket), Unit, Stats->Histogram[Bucket]));
+    }
+  }
+}
+
+/**
+  Return the number of performance counter ticks between two counter values,
+  taking the counting direction and wrap around into account.
+
+  @param[in] Start   Counter value at the start of the interval.
+  @param[in] End     Counter value at the end of the interval.
+
+  @return Elapsed ticks.
+**/
+UINT64
+EFIAPI
+MpBenchElapsedTicks (
+  IN UINT64  Start,
+  IN UINT64  End
+  )
+{
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+  UINT64  Delta;
+
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+
+  if (CounterStart < CounterEnd) {
+    //
+    // Counting up, wrap from CounterEnd back to CounterStart.
+    //
+    if (End >= Start) {
+      Delta = End - Start;
+    } else {
+      Delta = (CounterEnd - Start) + (End - CounterStart) + 1;
+    }
+  } else {
+    //
+    // Counting down, wrap from CounterEnd back to CounterStart.
+    //
+    if (Start >= End) {
+      Delta = Start - End;
+    } else {
+      Delta = (Start - CounterEnd) + (CounterStart - End) + 1;
+    }
+  }
+
+  return Delta;
+}
+
+/**
+  Return the nanoseconds between two performance counter values.
+
+  @param[in] Start   Counter value at the start of the interval.
+  @param[in] End     Counter value at the end of the interval.
+
+  @return Elapsed nanoseconds.
+**/
+UINT64
+EFIAPI
+MpBenchElapsedNs (
+  IN UINT64  Start,
+  IN UINT64  End
+  )
+{
+  return GetTimeInNanoSecond (MpBenchElapsedTicks (Start, End));
+}
@@ -0,0 +1,237 @@
+/** @file
+  Constant time processor index and per CPU data areas for MP procedures.
+
+  Buffer layout: the MP_PER_CPU_TABLE, the APIC ID to index map, then the
+  data areas from the next MP_PER_CPU_DATA_ALIGNMENT boundary.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/IoLib.h>
+#include <Library/MpPerCpuLib.h>
+
+#define MP_PER_CPU_MSR_APIC_BASE      0x1B
+#define MP_PER_CPU_APIC_BASE_EXTD     BIT10
+#define MP_PER_CPU_APIC_BASE_MASK     0xFFFFFFFFFFFFF000ULL
+#define MP_PER_CPU_MSR_X2APIC_ID      0x802
+#define MP_PER_CPU_XAPIC_ID_OFFSET    0x20
+#define MP_PER_CPU_XAPIC_ID_SHIFT     24
+
+/**
+  Return the stride of the data areas.
+
+  @param[in] DataSize   Size of one data area.
+
+  @return DataSize rounded up to MP_PER_CPU_DATA_ALIGNMENT.
+**/
+STATIC
+UINTN
+MpPerCpuStride (
+  IN UINTN  DataSize
+  )
+{
+  return ALIGN_VALUE (DataSize, MP_PER_CPU_DATA_ALIGNMENT);
+}
+
+/**
+  Return the buffer size MpPerCpuTableInitialize needs.
+
+  @param[in] MaxApicId   Largest APIC ID of any processor.
+  @param[in] CpuCount    Number of processors.
+  @param[in] DataSize    Size of the data area of each processor, may be 0.
+
+  @return Bytes, alignment slack included, or 0 if that overflows.
+**/
+UINTN
+EFIAPI
+MpPerCpuTableSize (
+  IN UINT32  MaxApicId,
+  IN UINTN   CpuCount,
+  IN UINTN   DataSize
+  )
+{
+  UINT64  Size;
+
+  if (DataSize > SIZE_1GB || CpuCount > MAX_UINT32) {
+    return 0;
+  }
+
+  Size = sizeof (MP_PER_CPU_TABLE) +
+         MultU64x32 ((UINT64) MaxApicId + 1, sizeof (UINT32)) +
+         MP_PER_CPU_DATA_ALIGNMENT - 1 +
+         MultU64x64 (CpuCount, MpPerCpuStride (DataSize));
+  if (Size > MAX_UINTN) {
+    return 0;
+  }
+
+  return (UINTN) Size;
+}
+
+/**
+  Build an empty table in Buffer, with zeroed data areas. Called by the BSP,
+  with the local APIC enabled in the mode every processor is in.
+
+  @param[out] Buffer       At least MpPerCpuTableSize bytes.
+  @param[in]  BufferSize   Size of Buffer.
+  @param[in]  MaxApicId    Largest APIC ID of any processor.
+  @param[in]  CpuCount     Number of processors.
+  @param[in]  DataSize     Size of the data area of each processor, may be 0.
+
+  @return The table at the start of Buffer, or NULL if Buffer is too small.
+**/
+MP_PER_CPU_TABLE *
+EFIAPI
+MpPerCpuTableInitialize (
+  OUT VOID    *Buffer,
+  IN  UINTN   BufferSize,
+  IN  UINT32  MaxApicId,
+  IN  UINTN   CpuCount,
+  IN  UINTN   DataSize
+  )
+{
+  MP_PER_CPU_TABLE  *Table;
+  UINTN             Size;
+  UINT64            ApicBase;
+
+  Size = MpPerCpuTableSize (MaxApicId, CpuCount, DataSize);
+  if (Buffer == NULL || Size == 0 || BufferSize < Size) {
+    return NULL;
+  }
+
+  Table                = (MP_PER_CPU_TABLE *)Buffer;
+  Table->MaxApicId     = MaxApicId;
+  Table->CpuCount      = (UINT32) CpuCount;
+  Table->DataSize      = MpPerCpuStride (DataSize);
+  Table->IndexByApicId = (UINT32 *)(Table + 1);
+  Table->Data          = (UINT8 *) ALIGN_POINTER (Table->IndexByApicId + MaxApicId + 1, MP_PER_CPU_DATA_ALIGNMENT);
+
+  SetMem32 (Table->IndexByApicId, ((UINTN) MaxApicId + 1) * sizeof (UINT32), MAX_UINT32);
+  ZeroMem (Table->Data, CpuCount * Table->DataSize);
+
+  //
+  // Reading IA32_APIC_BASE on every lookup would cost as much as the
+  // lookup itself, the mode is the same on all processors.
+  //
+  ApicBase              = AsmReadMsr64 (MP_PER_CPU_MSR_APIC_BASE);
+  Table->X2Apic         = (BOOLEAN) ((ApicBase & MP_PER_CPU_APIC_BASE_EXTD) != 0);
+  Table->XApicIdAddress = (UINTN) (ApicBase & MP_PER_CPU_APIC_BASE_MASK) + MP_PER_CPU_XAPIC_ID_OFFSET;
+
+  return Table;
+}
+
+/**
+  Enter the APIC ID of one processor.
+
+  @param[in, out] Table      The table.
+  @param[in]      CpuIndex   Processor index of the MP services.
+  @param[in]      ApicId     Its APIC ID, from GetProcessorInfo.
+
+  @retval RETURN_SUCCESS             The processor is in the table.
+  @retval RETURN_INVALID_PARAMETER   CpuIndex or ApicId is out of range.
+**/
+RETURN_STATUS
+EFIAPI
+MpPerCpuTableAdd (
+  IN OUT MP_PER_CPU_TABLE  *Table,
+  IN     UINTN             CpuIndex,
+  IN     UINT32            ApicId
+  )
+{
+  if (CpuIndex >= Table->CpuCount || ApicId > Table->MaxApicId) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Table->IndexByApicId[ApicId] = (UINT32) CpuIndex;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Return the APIC ID of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The APIC ID.
+**/
+UINT32
+EFIAPI
+MpPerCpuApicId (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  )
+{
+  if (Table->X2Apic) {
+    return (UINT32) AsmReadMsr64 (MP_PER_CPU_MSR_X2APIC_ID);
+  }
+
+  return MmioRead32 (Table->XApicIdAddress) >> MP_PER_CPU_XAPIC_ID_SHIFT;
+}
+
+/**
+  Return the processor index of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The index, or MP_PER_CPU_INVALID_INDEX if the CPU is not in the
+          table.
+**/
+UINTN
+EFIAPI
+MpPerCpuIndex (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  )
+{
+  UINT32  ApicId;
+  UINT32  Index;
+
+  ApicId = MpPerCpuApicId (Table);
+  if (ApicId > Table->MaxApicId) {
+    return MP_PER_CPU_INVALID_INDEX;
+  }
+
+  Index = Table->IndexByApicId[ApicId];
+  return Index == MAX_UINT32 ? MP_PER_CPU_INVALID_INDEX : Index;
+}
+
+/**
+  Return the data area of a processor.
+
+  @param[in] Table      The table.
+  @param[in] CpuIndex   The processor.
+
+  @return The data area, or NULL if CpuIndex is out of range or the table
+          has no data areas.
+**/
+VOID *
+EFIAPI
+MpPerCpuDataOf (
+  IN CONST MP_PER_CPU_TABLE  *Table,
+  IN UINTN                   CpuIndex
+  )
+{
+  if (CpuIndex >= Table->CpuCount || Table->DataSize == 0) {
+    return NULL;
+  }
+
+  return Table->Data + CpuIndex * Table->DataSize;
+}
+
+/**
+  Return the data area of the calling CPU.
+
+  @param[in] Table   The table.
+
+  @return The data area, or NULL if the CPU is not in the table or the table
+          has no data areas.
+**/
+VOID *
+EFIAPI
+MpPerCpuData (
+  IN CONST MP_PER_CPU_TABLE  *Table
+  )
+{
+  return MpPerCpuDataOf (Table, MpPerCpuIndex (Table));
+}
@@ -0,0 +1,200 @@
+/** @file
+  Sharded event counters for MP procedures.
+
+  Buffer layout: the MP_SHARDED_COUNTER, then the shards from the next
+  MP_SHARDED_COUNTER_ALIGNMENT boundary.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MpShardedCounterLib.h>
+
+/**
+  Return the buffer size MpShardedCounterInitialize needs.
+
+  @param[in] ShardCount   Number of shards, usually the number of processors.
+
+  @return Bytes, alignment slack included, or 0 if that overflows.
+**/
+UINTN
+EFIAPI
+MpShardedCounterSize (
+  IN UINTN  ShardCount
+  )
+{
+  UINT64  Size;
+
+  if (ShardCount == 0 || ShardCount > MAX_UINT32) {
+    return 0;
+  }
+
+  Size = sizeof (MP_SHARDED_COUNTER) +
+         MP_SHARDED_COUNTER_ALIGNMENT - 1 +
+         MultU64x32 (ShardCount, sizeof (MP_SHARDED_COUNTER_SHARD));
+  if (Size > MAX_UINTN) {
+    return 0;
+  }
+
+  return (UINTN) Size;
+}
+
+/**
+  Build zeroed counters in Buffer.
+
+  @param[out] Buffer         At least MpShardedCounterSize bytes.
+  @param[in]  BufferSize     Size of Buffer.
+  @param[in]  ShardCount     Number of shards, usually the number of
+                             processors.
+  @param[in]  CounterCount   Number of counters, 1 to MP_SHARDED_COUNTER_MAX.
+
+  @return The counters at the start of Buffer, or NULL if Buffer is too small
+          or CounterCount is out of range.
+**/
+MP_SHARDED_COUNTER *
+EFIAPI
+MpShardedCounterInitialize (
+  OUT VOID   *Buffer,
+  IN  UINTN  BufferSize,
+  IN  UINTN  ShardCount,
+  IN  UINTN  CounterCount
+  )
+{
+  MP_SHARDED_COUNTER  *Counter;
+  UINTN               Size;
+
+  Size = MpShardedCounterSize (ShardCount);
+  if (Buffer == NULL || Size == 0 || BufferSize < Size ||
+      CounterCount == 0 || CounterCount > MP_SHARDED_COUNTER_MAX) {
+    return NULL;
+  }
+
+  Counter               = (MP_SHARDED_COUNTER *)Buffer;
+  Counter->ShardCount   = (UINT32) ShardCount;
+  Counter->CounterCount = (UINT32) CounterCount;
+  Counter->Shard        = (MP_SHARDED_COUNTER_SHARD *) ALIGN_POINTER (Counter + 1, MP_SHARDED_COUNTER_ALIGNMENT);
+
+  MpShardedCounterReset (Counter);
+  return Counter;
+}
+
+/**
+  Add to a counter in one shard. Only the CPU owning the shard may call it,
+  usually with its own processor index as Shard.
+
+  @param[in, out] Counter   The counters.
+  @param[in]      Shard     The shard of the calling CPU.
+  @param[in]      Id        The counter.
+  @param[in]      Value     Amount to add.
+**/
+VOID
+EFIAPI
+MpShardedCounterAdd (
+  IN OUT MP_SHARDED_COUNTER  *Counter,
+  IN     UINTN               Shard,
+  IN     UINTN               Id,
+  IN     UINT64              Value
+  )
+{
+  if (Shard >= Counter->ShardCount || Id >= Counter->CounterCount) {
+    return;
+  }
+
+  //
+  // No other CPU writes the shard, a plain add is enough. On IA32 a reader
+  // racing with it may see a torn 64-bit value, hence the estimate while
+  // procedures run.
+  //
+  Counter->Shard[Shard].Value[Id] += Value;
+}
+
+/**
+  Add 1 to a counter in one shard. Only the CPU owning the shard may call it.
+
+  @param[in, out] Counter   The counters.
+  @param[in]      Shard     The shard of the calling CPU.
+  @param[in]      Id        The counter.
+**/
+VOID
+EFIAPI
+MpShardedCounterIncrement (
+  IN OUT MP_SHARDED_COUNTER  *Counter,
+  IN     UINTN               Shard,
+  IN     UINTN               Id
+  )
+{
+  MpShardedCounterAdd (Counter, Shard, Id, 1);
+}
+
+/**
+  Return the sum of a counter over all shards. Exact once the procedures
+  adding to it have completed, an estimate while they run.
+
+  @param[in]  Counter   The counters.
+  @param[in]  Id        The counter.
+
+  @return The sum, 0 for an Id out of range.
+**/
+UINT64
+EFIAPI
+MpShardedCounterRead (
+  IN CONST MP_SHARDED_COUNTER  *Counter,
+  IN UINTN                     Id
+  )
+{
+  UINT64  Sum;
+  UINTN   Shard;
+
+  if (Id >= Counter->CounterCount) {
+    return 0;
+  }
+
+  Sum = 0;
+  for (Shard = 0; Shard < Counter->ShardCount; Shard++) {
+    Sum += Counter->Shard[Shard].Value[Id];
+  }
+
+  return Sum;
+}
+
+/**
+  Return a counter of one shard.
+
+  @param[in]  Counter   The counters.
+  @param[in]  Shard     The shard.
+  @param[in]  Id        The counter.
+
+  @return The value, 0 for a Shard or Id out of range.
+**/
+UINT64
+EFIAPI
+MpShardedCounterReadShard (
+  IN CONST MP_SHARDED_COUNTER  *Counter,
+  IN UINTN                     Shard,
+  IN UINTN                     Id
+  )
+{
+  if (Shard >= Counter->ShardCount || Id >= Counter->CounterCount) {
+    return 0;
+  }
+
+  return Counter->Shard[Shard].Value[Id];
+}
+
+/**
+  Zero all counters of all shards. Called while no procedure adds to them.
+
+  @param[in, out] Counter   The counters.
+**/
+VOID
+EFIAPI
+MpShardedCounterReset (
+  IN OUT MP_SHARDED_COUNTER  *Counter
+  )
+{
+  ZeroMem ((VOID *) Counter->Shard, Counter->ShardCount * sizeof (MP_SHARDED_COUNTER_SHARD));
+}
@@ -0,0 +1,488 @@
+/** @file
+  Synthetic procedure bodies for the MP tests of UnitTestPkg.
+
+  Every profile works in batches and checks the performance counter between
+  batches only, so the timer read does not dominate short runs.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Uefi/UefiBaseType.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Library/MpWorkloadLib.h>
+
+#define MP_WORKLOAD_CACHE_LINE_SIZE   64
+
+//
+// Operations between two checks of the performance counter, and bytes the
+// stream profile touches between them.
+//
+#define MP_WORKLOAD_BATCH             256
+#define MP_WORKLOAD_STREAM_CHUNK      SIZE_4KB
+
+//
+// Doubles of the floating point chains, floating point operations per step
+// of all of them, and bytes FXSAVE stores.
+//
+#define MP_WORKLOAD_FLOAT_LANES       8
+#define MP_WORKLOAD_FLOAT_FLOPS       (MP_WORKLOAD_FLOAT_LANES * 2)
+#define MP_WORKLOAD_FXSAVE_SIZE       512
+
+STATIC CONST CHAR8  *mProfileName[MpWorkloadProfileMax] = {
+  "spin",
+  "integer",
+  "floating point",
+  "stream",
+  "pointer chase",
+  "shared counter"
+};
+
+STATIC CONST CHAR8  *mProfileUnit[MpWorkloadProfileMax] = {
+  "pauses",
+  "iterations",
+  "flops",
+  "bytes",
+  "hops",
+  "increments"
+};
+
+#if defined (MDE_CPU_X64)
+
+//
+// X64/MpWorkloadFloat.nasm
+//
+VOID
+EFIAPI
+MpWorkloadFloatBatch (
+  IN OUT UINT64  *State,
+  IN     UINTN   Iterations
+  );
+
+VOID
+EFIAPI
+MpWorkloadFxSave (
+  OUT VOID  *Area
+  );
+
+VOID
+EFIAPI
+MpWorkloadFxRestore (
+  IN VOID  *Area
+  );
+
+#endif
+
+/**
+  Return whether the calling CPU can run the floating point kernel: SSE2,
+  enabled by CR4.OSFXSR.
+
+  @retval TRUE    It can.
+  @retval FALSE   It cannot, or this is not an X64 build.
+**/
+STATIC
+BOOLEAN
+MpWorkloadFloatSupported (
+  VOID
+  )
+{
+#if defined (MDE_CPU_X64)
+  UINT32  Edx;
+
+  AsmCpuid (1, NULL, NULL, NULL, &Edx);
+  return (BOOLEAN) ((Edx & BIT26) != 0 && (AsmReadCr4 () & BIT9) != 0);
+#else
+  return FALSE;
+#endif
+}
+
+/**
+  Run one batch of the floating point kernel between a save and a restore
+  of the SSE state of the interrupted context.
+
+  @param[in, out] State   The MP_WORKLOAD_FLOAT_LANES chains.
+**/
+STATIC
+VOID
+MpWorkloadFloatStep (
+  IN OUT UINT64  *State
+  )
+{
+#if defined (MDE_CPU_X64)
+  UINT8   Area[MP_WORKLOAD_FXSAVE_SIZE + 16];
+  VOID    *SaveArea;
+
+  SaveArea = ALIGN_POINTER (Area, 16);
+  MpWorkloadFxSave (SaveArea);
+  MpWorkloadFloatBatch (State, MP_WORKLOAD_BATCH);
+  MpWorkloadFxRestore (SaveArea);
+#endif
+}
+
+/**
+  Advance a xorshift32 generator.
+
+  @param[in, out] State   Generator state, must not be 0.
+
+  @return The next value.
+**/
+STATIC
+UINT32
+MpWorkloadRandom (
+  IN OUT UINT32  *State
+  )
+{
+  UINT32  Value;
+
+  Value  = *State;
+  Value ^= Value << 13;
+  Value ^= Value >> 17;
+  Value ^= Value << 5;
+  *State = Value;
+  return Value;
+}
+
+/**
+  Link the cache lines of one slot into a single random cycle, using
+  Sattolo's shuffle. Every line starts with the address of the next one.
+
+  @param[in] Slot       The slot.
+  @param[in] SlotSize   Bytes in the slot.
+  @param[in] Seed       Seed of the shuffle, must not be 0.
+**/
+STATIC
+VOID
+MpWorkloadBuildChain (
+  IN UINT8   *Slot,
+  IN UINTN   SlotSize,
+  IN UINT32  Seed
+  )
+{
+  UINTN   Lines;
+  UINTN   Index;
+  UINTN   Other;
+  UINTN   Swap;
+  UINTN   *Line;
+
+  Lines = SlotSize / MP_WORKLOAD_CACHE_LINE_SIZE;
+  for (Index = 0; Index < Lines; Index++) {
+    *(UINTN *)(Slot + Index * MP_WORKLOAD_CACHE_LINE_SIZE) = Index;
+  }
+
+  for (Index = Lines - 1; Index > 0; Index--) {
+    Other = MpWorkloadRandom (&Seed) % (UINT32) Index;
+    Line  = (UINTN *)(Slot + Index * MP_WORKLOAD_CACHE_LINE_SIZE);
+    Swap  = *Line;
+    *Line = *(UINTN *)(Slot + Other * MP_WORKLOAD_CACHE_LINE_SIZE);
+    *(UINTN *)(Slot + Other * MP_WORKLOAD_CACHE_LINE_SIZE) = Swap;
+  }
+
+  for (Index = 0; Index < Lines; Index++) {
+    Line  = (UINTN *)(Slot + Index * MP_WORKLOAD_CACHE_LINE_SIZE);
+    *Line = (UINTN) (Slot + *Line * MP_WORKLOAD_CACHE_LINE_SIZE);
+  }
+}
+
+/**
+  Set up a workload.
+
+  The memory profiles need Buffer, SlotCount slots of SlotSize bytes each.
+  For MpWorkloadPointerChase the random cycle of every slot is built here.
+  MpWorkloadFloatingPoint is checked on the calling CPU, the CPUs running
+  the workload are expected to match it.
+
+  @param[out] Workload        The workload to set up.
+  @param[in]  Profile         The profile to run.
+  @param[in]  Buffer          Buffer of the memory profiles, may be NULL for
+                              the others.
+  @param[in]  SlotSize        Bytes per slot, a multiple of the cache line size.
+  @param[in]  SlotCount       Number of slots.
+  @param[in]  BandwidthMBps   Target bandwidth of MpWorkloadStream per CPU in
+                              MB/s, 0 for as fast as possible.
+
+  @retval RETURN_SUCCESS            The workload is ready.
+  @retval RETURN_INVALID_PARAMETER  Profile is unknown, or a memory profile
+                                    has no usable buffer.
+  @retval RETURN_UNSUPPORTED        MpWorkloadFloatingPoint on a CPU that
+                                    cannot run it.
+**/
+RETURN_STATUS
+EFIAPI
+MpWorkloadInitialize (
+  OUT MP_WORKLOAD          *Workload,
+  IN  MP_WORKLOAD_PROFILE  Profile,
+  IN  VOID                 *Buffer     OPTIONAL,
+  IN  UINTN                SlotSize,
+  IN  UINTN                SlotCount,
+  IN  UINT32               BandwidthMBps
+  )
+{
+  UINTN  Slot;
+
+  if (Profile >= MpWorkloadProfileMax) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  if (Profile == MpWorkloadFloatingPoint && !MpWorkloadFloatSupported ()) {
+    return RETURN_UNSUPPORTED;
+  }
+
+  if (Profile == MpWorkloadStream || Profile == MpWorkloadPointerChase) {
+    if (Buffer == NULL || SlotCount == 0 ||
+        SlotSize < 2 * MP_WORKLOAD_CACHE_LINE_SIZE ||
+        (SlotSize % MP_WORKLOAD_CACHE_LINE_SIZE) != 0) {
+      return RETURN_INVALID_PARAMETER;
+    }
+  }
+
+  Workload->Profile       = Profile;
+  Workload->Buffer        = Buffer;
+  Workload->SlotSize      = SlotSize;
+  Workload->SlotCount     = SlotCount;
+  Workload->BandwidthMBps = BandwidthMBps;
+  Workload->NextSlot      = 0;
+  Workload->SharedCounter = 0;
+
+  if (Profile == MpWorkloadPointerChase) {
+    for (Slot = 0; Slot < SlotCount; Slot++) {
+      MpWorkloadBuildChain (Workload->Buffer + Slot * SlotSize, SlotSize, 0x9E3779B9 + (UINT32) Slot);
+    }
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Set up the workload a test runs as its procedure body, for a profile
+  chosen at run time.
+
+  The buffer of the memory profiles is allocated here on first use, SlotCount
+  slots of SlotSize bytes, and returned in Buffer for the caller to keep for
+  later selections. A buffer allocated by a failing selection is freed again.
+
+  @param[out]     Workload        The workload to set up.
+  @param[in]      Profile         The MP_WORKLOAD_PROFILE.
+  @param[in, out] Buffer          Buffer of the memory profiles, NULL until
+                                  one is allocated.
+  @param[in]      SlotSize        Bytes per slot, a multiple of the cache line
+                                  size.
+  @param[in]      SlotCount       Number of slots.
+  @param[in]      BandwidthMBps   Target bandwidth of MpWorkloadStream per CPU
+                                  in MB/s, 0 for as fast as possible.
+
+  @return Workload, or NULL to keep the CpuPause spin: for MpWorkloadSpin, an
+          unknown profile or no memory for the buffer.
+**/
+MP_WORKLOAD *
+EFIAPI
+MpWorkloadSelect (
+  OUT    MP_WORKLOAD  *Workload,
+  IN     UINTN        Profile,
+  IN OUT VOID         **Buffer,
+  IN     UINTN        SlotSize,
+  IN     UINTN        SlotCount,
+  IN     UINT32       BandwidthMBps
+  )
+{
+  RETURN_STATUS  Status;
+  VOID           *Allocated;
+
+  if (Profile == MpWorkloadSpin) {
+    return NULL;
+  }
+
+  Allocated = NULL;
+  if ((Profile == MpWorkloadStream || Profile == MpWorkloadPointerChase) && *Buffer == NULL) {
+    Allocated = AllocatePages (EFI_SIZE_TO_PAGES (SlotSize * SlotCount));
+    if (Allocated == NULL) {
+      DEBUG ((DEBUG_ERROR, "Workload: no memory for 0x%x slots of 0x%x bytes!\n", SlotCount, SlotSize));
+    }
+    *Buffer = Allocated;
+  }
+
+  Status = MpWorkloadInitialize (Workload, (MP_WORKLOAD_PROFILE) Profile, *Buffer, SlotSize, SlotCount, BandwidthMBps);
+  if (RETURN_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "Workload profile %d unavailable, %r, procedures spin.\n", Profile, Status));
+    if (Allocated != NULL) {
+      FreePages (Allocated, EFI_SIZE_TO_PAGES (SlotSize * SlotCount));
+      *Buffer = NULL;
+    }
+    return NULL;
+  }
+
+  return Workload;
+}
+
+/**
+  Run a workload on the calling CPU.
+
+  May be called by several CPUs at the same time.
+
+  @param[in, out] Workload        The workload.
+  @param[in]      DurationTicks   Performance counter ticks to run, 0 returns
+                                  at once.
+
+  @return Work done, in the unit returned by MpWorkloadProfileUnit.
+**/
+UINT64
+EFIAPI
+MpWorkloadRun (
+  IN OUT MP_WORKLOAD  *Workload,
+  IN     UINT64       DurationTicks
+  )
+{
+  UINT64             Start;
+  UINT64             Elapsed;
+  UINT64             Work;
+  UINT64             TicksPerChunk;
+  UINT64             Chunks;
+  UINT8              *Slot;
+  UINTN              Offset;
+  UINTN              Index;
+  UINT32             State;
+  UINT64             FloatState[MP_WORKLOAD_FLOAT_LANES];
+  volatile UINT64    *Word;
+  volatile UINTN     *Line;
+  volatile UINT64    Sink;
+
+  if (DurationTicks == 0) {
+    return 0;
+  }
+
+  Slot = NULL;
+  if (Workload->Buffer != NULL && Workload->SlotCount != 0) {
+    Slot = Workload->Buffer +
+           ((InterlockedIncrement (&Workload->NextSlot) - 1) % Workload->SlotCount) * Workload->SlotSize;
+  }
+
+  TicksPerChunk = 0;
+  if (Workload->Profile == MpWorkloadStream && Workload->BandwidthMBps != 0) {
+    TicksPerChunk = DivU64x64Remainder (
+                      MultU64x32 (GetPerformanceCounterProperties (NULL, NULL), MP_WORKLOAD_STREAM_CHUNK),
+                      MultU64x32 (Workload->BandwidthMBps, 1000000),
+                      NULL
+                      );
+  }
+
+  Work        = 0;
+  Chunks      = 0;
+  Offset      = 0;
+  State       = 0x2545F491;
+  ZeroMem (FloatState, sizeof (FloatState));
+  Line        = (volatile UINTN *) Slot;
+  Start       = GetPerformanceCounter ();
+
+  do {
+    switch (Workload->Profile) {
+    case MpWorkloadInteger:
+      for (Index = 0; Index < MP_WORKLOAD_BATCH; Index++) {
+        State = MpWorkloadRandom (&State) * 0x01000193 + (UINT32) Index;
+      }
+      Sink  = State;
+      Work += MP_WORKLOAD_BATCH;
+      break;
+
+    case MpWorkloadFloatingPoint:
+      MpWorkloadFloatStep (FloatState);
+      Sink  = FloatState[0];
+      Work += MP_WORKLOAD_BATCH * MP_WORKLOAD_FLOAT_FLOPS;
+      break;
+
+    case MpWorkloadStream:
+      if (Offset + MP_WORKLOAD_STREAM_CHUNK > Workload->SlotSize) {
+        Offset = 0;
+      }
+      Word = (volatile UINT64 *) (Slot + Offset);
+      for (Index = 0; Index < MIN (MP_WORKLOAD_STREAM_CHUNK, Workload->SlotSize) / sizeof (UINT64); Index++) {
+        Word[Index] = Word[Index] + 1;
+      }
+      Offset += MP_WORKLOAD_STREAM_CHUNK;
+      Work   += MIN (MP_WORKLOAD_STREAM_CHUNK, Workload->SlotSize);
+      Chunks++;
+
+      //
+      // Hold back until the target bandwidth allows the next chunk.
+      //
+      if (TicksPerChunk != 0) {
+        do {
+          Elapsed = MpBenchElapsedTicks (Start, GetPerformanceCounter ());
+        } while (Elapsed < MultU64x64 (Chunks, TicksPerChunk) && Elapsed < DurationTicks);
+      }
+      break;
+
+    case MpWorkloadPointerChase:
+      for (Index = 0; Index < MP_WORKLOAD_BATCH; Index++) {
+        Line = (volatile UINTN *) *Line;
+      }
+      Work += MP_WORKLOAD_BATCH;
+      break;
+
+    case MpWorkloadSharedCounter:
+      for (Index = 0; Index < MP_WORKLOAD_BATCH; Index++) {
+        InterlockedIncrement (&Workload->SharedCounter);
+      }
+      Work += MP_WORKLOAD_BATCH;
+      break;
+
+    default:
+      for (Index = 0; Index < MP_WORKLOAD_BATCH; Index++) {
+        CpuPause ();
+      }
+      Work += MP_WORKLOAD_BATCH;
+      break;
+    }
+  } while (MpBenchElapsedTicks (Start, GetPerformanceCounter ()) < DurationTicks);
+
+  //
+  // Keep the end of the chase live, the loads must not be dropped.
+  //
+  Sink = (UINTN) Line;
+
+  return Work;
+}
+
+/**
+  Return the name of a profile.
+
+  @param[in] Profile   The profile.
+
+  @return The name, "unknown" for an invalid profile.
+**/
+CONST CHAR8 *
+EFIAPI
+MpWorkloadProfileName (
+  IN MP_WORKLOAD_PROFILE  Profile
+  )
+{
+  if (Profile >= MpWorkloadProfileMax) {
+    return "unknown";
+  }
+  return mProfileName[Profile];
+}
+
+/**
+  Return the unit of the work MpWorkloadRun reports for a profile.
+
+  @param[in] Profile   The profile.
+
+  @return The unit, e.g. "bytes".
+**/
+CONST CHAR8 *
+EFIAPI
+MpWorkloadProfileUnit (
+  IN MP_WORKLOAD_PROFILE  Profile
+  )
+{
+  if (Profile >= MpWorkloadProfileMax) {
+    return "units";
+  }
+  return mProfileUnit[Profile];
+}
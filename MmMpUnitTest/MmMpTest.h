@@ -22,10 +22,45 @@
 
 #define    MM_MP_TEST_SW_SMI_VALUE      0xDE
 
+//
+// The value written to the SW SMI data port before the trigger selects
+// which test the SMI handler runs.
+//
+#define    MM_MP_TEST_SW_SMI_DATA_PORT  0xB3
+
+#define    MM_MP_TEST_ID_VERIFICATION   0x00
+#define    MM_MP_TEST_ID_TIMEOUT        0x01
+#define    MM_MP_TEST_ID_ARENA          0x02
+#define    MM_MP_TEST_ID_STACK          0x03
+#define    MM_MP_TEST_ID_TOPOLOGY       0x04
+#define    MM_MP_TEST_ID_PINGPONG       0x05
+#define    MM_MP_TEST_ID_SIMD           0x06
+#define    MM_MP_TEST_ID_TSC            0x07
+#define    MM_MP_TEST_ID_IMBALANCE      0x08
+#define    MM_MP_TEST_ID_PER_CPU        0x09
+#define    MM_MP_TEST_ID_COUNTER        0x0A
+#define    MM_MP_TEST_ID_COLD_CACHE     0x0B
+#define    MM_MP_TEST_ID_PAYLOAD        0x0C
+
+//
+// Highest test id, sizes the results of the blackout mode of MmMpTestApp.
+//
+#define    MM_MP_TEST_ID_LAST           MM_MP_TEST_ID_PAYLOAD
+
+//
+// The upper bits of the data port select the body of the test procedures,
+// a MP_WORKLOAD_PROFILE of MpWorkloadLib. 0 keeps the CpuPause spin.
+//
+#define    MM_MP_TEST_ID_MASK           0x1F
+#define    MM_MP_TEST_WORKLOAD_SHIFT    5
+
 typedef struct _PROCEDURE_ARGUMENTS {
   UINT32   ProcessorIndex;
   UINT32   MagicNumber;
   UINT32   SleepTime;
+  UINT64   SpinTicks;
+  VOID     *Workload;     // MP_WORKLOAD run as procedure body, NULL to spin
+  VOID     *Result;       // MM_MP_TEST_RESULT marking the CPUs run on, may be NULL
 } PROCEDURE_ARGUMENTS;
 
 #endif
@@ -12,6 +12,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
 #include <PiDxe.h>
+#include <Protocol/ShellParameters.h>
+#include <Protocol/MpService.h>
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -20,10 +22,392 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/IoLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <MmMpTest.h>
 
+#define MM_MP_TEST_BLACKOUT_CALIBRATE_US    10000
 
+//
+// A stall of the sampling loop longer than this is a blackout. Interrupts
+// are off on the APs, so only SMIs stall them that long.
+//
+#define MM_MP_TEST_BLACKOUT_THRESHOLD_US    2
+
+//
+// Time without SMIs the baseline is taken over, and time after the last
+// SMI of a test before the next test starts, so every AP has come back.
+//
+#define MM_MP_TEST_BLACKOUT_BASELINE_US     100000
+#define MM_MP_TEST_BLACKOUT_SETTLE_US       1000
+
+//
+// Time the samplers get to start, and to return once stopped.
+//
+#define MM_MP_TEST_BLACKOUT_WAIT_US         1000000
+#define MM_MP_TEST_BLACKOUT_POLL_US         100
+
+//
+// Epoch 0 is the baseline, epoch 1 + TestId the test.
+//
+#define MM_MP_TEST_BLACKOUT_EPOCHS          (MM_MP_TEST_ID_LAST + 2)
+
+//
+// Test ids run by default, one bit per id. The timeout test may leave an AP
+// running a procedure, cold cache and payload allocate megabytes of SMRAM
+// in every SMI.
+//
+#define MM_MP_TEST_BLACKOUT_DEFAULT_IDS     (((1 << (MM_MP_TEST_ID_LAST + 1)) - 1) & \
+                                             ~((1 << MM_MP_TEST_ID_TIMEOUT) |       \
+                                               (1 << MM_MP_TEST_ID_COLD_CACHE) |    \
+                                               (1 << MM_MP_TEST_ID_PAYLOAD)))
+
+typedef struct {
+  UINT64                    Gaps;
+  UINT64                    TotalTicks;
+  UINT64                    MaxTicks;
+} MM_MP_TEST_BLACKOUT_STATS;
+
+//
+// Per processor results, each written by its own processor only.
+//
+typedef struct {
+  volatile BOOLEAN          Running;
+  MM_MP_TEST_BLACKOUT_STATS Epoch[MM_MP_TEST_BLACKOUT_EPOCHS];
+} MM_MP_TEST_BLACKOUT_SLOT;
+
+//
+// The run and its slots share one allocation.
+//
+typedef struct {
+  EFI_MP_SERVICES_PROTOCOL  *Mp;
+  UINT8                     *Slot;
+  UINTN                     Stride;
+  UINTN                     CpuCount;
+  UINT64                    ThresholdTicks;
+  volatile UINT32           Epoch;
+  volatile BOOLEAN          Stop;
+} MM_MP_TEST_BLACKOUT;
+
+/**
+  Trigger the MM MP test SMI once.
+
+  @param[in] TestId   Value written to the SW SMI data port.
+
+  @return TSC cycles the BSP spent in the SMI.
+**/
+UINT64
+MmMpTestTriggerSmi (
+  IN UINT8                TestId
+  )
+{
+  EFI_TPL                         OldTpl;
+  UINT64                          Start;
+  UINT64                          End;
+
+  PERF_INMODULE_BEGIN ("MmMpTestSmi");
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  IoWrite8 (MM_MP_TEST_SW_SMI_DATA_PORT, TestId);
+  Start = AsmReadTsc ();
+  IoWrite8 (0xB2, MM_MP_TEST_SW_SMI_VALUE);
+  End = AsmReadTsc ();
+  gBS->RestoreTPL (OldTpl);
+  PERF_INMODULE_END ("MmMpTestSmi");
+
+  return End - Start;
+}
+
+/**
+  Return the results of a processor.
+
+  @param[in]  Blackout         The blackout run.
+  @param[in]  ProcessorIndex   The processor.
+
+  @return The slot.
+**/
+MM_MP_TEST_BLACKOUT_SLOT *
+MmMpTestBlackoutSlot (
+  IN MM_MP_TEST_BLACKOUT  *Blackout,
+  IN UINTN                ProcessorIndex
+  )
+{
+  return (MM_MP_TEST_BLACKOUT_SLOT *)(Blackout->Slot + ProcessorIndex * Blackout->Stride);
+}
+
+/**
+  Add a blackout to the statistics of an epoch.
+
+  @param[in, out] Stats   The statistics.
+  @param[in]      Ticks   Length of the blackout in TSC cycles.
+**/
+VOID
+MmMpTestBlackoutAdd (
+  IN OUT MM_MP_TEST_BLACKOUT_STATS  *Stats,
+  IN     UINT64                     Ticks
+  )
+{
+  Stats->Gaps++;
+  Stats->TotalTicks += Ticks;
+  Stats->MaxTicks    = MAX (Stats->MaxTicks, Ticks);
+}
+
+/**
+  AP procedure: read the TSC in a tight loop until stopped, and count every
+  gap longer than the threshold in the epoch current when it ends.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_BLACKOUT.
+**/
+VOID
+EFIAPI
+MmMpTestBlackoutSampler (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_BLACKOUT       *Blackout;
+  MM_MP_TEST_BLACKOUT_SLOT  *Slot;
+  UINTN                     ProcessorIndex;
+  UINT64                    Last;
+  UINT64                    Now;
+  UINT32                    Epoch;
+
+  Blackout = (MM_MP_TEST_BLACKOUT *)ProcedureArgument;
+  if (EFI_ERROR (Blackout->Mp->WhoAmI (Blackout->Mp, &ProcessorIndex)) || ProcessorIndex >= Blackout->CpuCount) {
+    return;
+  }
+
+  Slot          = MmMpTestBlackoutSlot (Blackout, ProcessorIndex);
+  Slot->Running = TRUE;
+
+  Last = AsmReadTsc ();
+  while (!Blackout->Stop) {
+    Now = AsmReadTsc ();
+    Epoch = Blackout->Epoch;
+    if (Now - Last > Blackout->ThresholdTicks && Epoch < MM_MP_TEST_BLACKOUT_EPOCHS) {
+      MmMpTestBlackoutAdd (&Slot->Epoch[Epoch], Now - Last);
+    }
+    Last = Now;
+  }
+}
+
+/**
+  Print the blackouts of one epoch, one line per processor.
+
+  @param[in]  Blackout    The blackout run.
+  @param[in]  Epoch       The epoch.
+  @param[in]  SmiCount    SMIs triggered in the epoch.
+  @param[in]  TscMhz      TSC frequency.
+**/
+VOID
+MmMpTestBlackoutPrint (
+  IN MM_MP_TEST_BLACKOUT  *Blackout,
+  IN UINTN                Epoch,
+  IN UINTN                SmiCount,
+  IN UINT64               TscMhz
+  )
+{
+  MM_MP_TEST_BLACKOUT_SLOT  *Slot;
+  MM_MP_TEST_BLACKOUT_STATS *Stats;
+  UINTN                     Index;
+
+  for (Index = 0; Index < Blackout->CpuCount; Index++) {
+    Slot  = MmMpTestBlackoutSlot (Blackout, Index);
+    Stats = &Slot->Epoch[Epoch];
+    if (!Slot->Running) {
+      continue;
+    }
+    if (Stats->Gaps == 0) {
+      Print (L"  Cpu 0x%x: no blackout\n", Index);
+      continue;
+    }
+    Print (
+      L"  Cpu 0x%x: %ld gaps for %d SMIs, mean %ld us, max %ld us, total %ld us\n",
+      Index,
+      Stats->Gaps,
+      SmiCount,
+      DivU64x64Remainder (Stats->TotalTicks, MultU64x64 (Stats->Gaps, TscMhz), NULL),
+      DivU64x64Remainder (Stats->MaxTicks, TscMhz, NULL),
+      DivU64x64Remainder (Stats->TotalTicks, TscMhz, NULL)
+      );
+  }
+}
+
+/**
+  Measure how long every processor is stalled by the SMIs of each MM MP test.
+
+  All enabled APs run a TSC sampling loop through EFI_MP_SERVICES_PROTOCOL
+  while the BSP triggers every selected test Count times. The gaps in the
+  timestamps of an AP are its blackouts, the BSP times the SMI trigger
+  itself. A run without SMIs first shows the blackouts the platform causes
+  on its own.
+
+  @param[in]  Count         SMIs per test.
+  @param[in]  WorkloadBits  MP_WORKLOAD_PROFILE of the test procedures,
+                            shifted to MM_MP_TEST_WORKLOAD_SHIFT.
+  @param[in]  TestIds       Tests to trigger, bit n selects test id n.
+
+  @retval EFI_SUCCESS             The blackouts were measured.
+  @retval EFI_UNSUPPORTED         No MP services or no enabled AP.
+  @retval EFI_OUT_OF_RESOURCES    No memory for the results.
+  @retval Others                  The samplers did not start.
+**/
+EFI_STATUS
+MmMpTestBlackout (
+  IN UINTN                Count,
+  IN UINT8                WorkloadBits,
+  IN UINT32               TestIds
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_MP_SERVICES_PROTOCOL        *Mp;
+  MM_MP_TEST_BLACKOUT             *Blackout;
+  MM_MP_TEST_BLACKOUT_SLOT        *BspSlot;
+  EFI_EVENT                       Done;
+  UINTN                           NumberOfProcessors;
+  UINTN                           NumberOfEnabledProcessors;
+  UINTN                           BspIndex;
+  UINTN                           Running;
+  UINTN                           Index;
+  UINTN                           Waited;
+  UINTN                           Smi;
+  UINTN                           TestId;
+  UINTN                           Header;
+  UINTN                           Pages;
+  UINT64                          TscMhz;
+  UINT64                          Start;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &Mp);
+  if (!EFI_ERROR (Status)) {
+    Status = Mp->GetNumberOfProcessors (Mp, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = Mp->WhoAmI (Mp, &BspIndex);
+  }
+  if (EFI_ERROR (Status) || NumberOfEnabledProcessors < 2) {
+    Print (L"Blackout: needs MP services and an enabled Ap\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Header   = ALIGN_VALUE (sizeof (MM_MP_TEST_BLACKOUT), 64);
+  Pages    = EFI_SIZE_TO_PAGES (Header + ALIGN_VALUE (sizeof (MM_MP_TEST_BLACKOUT_SLOT), 64) * NumberOfProcessors);
+  Blackout = AllocatePages (Pages);
+  if (Blackout == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ZeroMem (Blackout, EFI_PAGES_TO_SIZE (Pages));
+  Blackout->Mp       = Mp;
+  Blackout->CpuCount = NumberOfProcessors;
+  Blackout->Stride   = ALIGN_VALUE (sizeof (MM_MP_TEST_BLACKOUT_SLOT), 64);
+  Blackout->Slot     = (UINT8 *) Blackout + Header;
+
+  Start = AsmReadTsc ();
+  gBS->Stall (MM_MP_TEST_BLACKOUT_CALIBRATE_US);
+  TscMhz = MAX (DivU64x32 (AsmReadTsc () - Start, MM_MP_TEST_BLACKOUT_CALIBRATE_US), 1);
+  Blackout->ThresholdTicks = MultU64x32 (TscMhz, MM_MP_TEST_BLACKOUT_THRESHOLD_US);
+
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Done);
+  if (EFI_ERROR (Status)) {
+    FreePages (Blackout, Pages);
+    return Status;
+  }
+
+  Status = Mp->StartupAllAPs (Mp, MmMpTestBlackoutSampler, FALSE, Done, 0, Blackout, NULL);
+  if (EFI_ERROR (Status)) {
+    Print (L"Blackout: StartupAllAPs %r\n", Status);
+    gBS->CloseEvent (Done);
+    FreePages (Blackout, Pages);
+    return Status;
+  }
+
+  for (Waited = 0; Waited < MM_MP_TEST_BLACKOUT_WAIT_US; Waited += MM_MP_TEST_BLACKOUT_POLL_US) {
+    Running = 0;
+    for (Index = 0; Index < NumberOfProcessors; Index++) {
+      if (MmMpTestBlackoutSlot (Blackout, Index)->Running) {
+        Running++;
+      }
+    }
+    if (Running == NumberOfEnabledProcessors - 1) {
+      break;
+    }
+    gBS->Stall (MM_MP_TEST_BLACKOUT_POLL_US);
+  }
+
+  //
+  // The BSP does not sample, it times each SMI it triggers. Its slot is
+  // marked running so it is printed with the APs.
+  //
+  BspSlot          = MmMpTestBlackoutSlot (Blackout, BspIndex);
+  BspSlot->Running = TRUE;
+
+  Blackout->Epoch = 0;
+  gBS->Stall (MM_MP_TEST_BLACKOUT_BASELINE_US);
+
+  for (TestId = 0; TestId <= MM_MP_TEST_ID_LAST; TestId++) {
+    if ((TestIds & (1 << TestId)) == 0) {
+      continue;
+    }
+    Blackout->Epoch = (UINT32) (TestId + 1);
+    for (Smi = 0; Smi < Count; Smi++) {
+      MmMpTestBlackoutAdd (&BspSlot->Epoch[TestId + 1], MmMpTestTriggerSmi ((UINT8) (TestId | WorkloadBits)));
+    }
+    gBS->Stall (MM_MP_TEST_BLACKOUT_SETTLE_US);
+  }
+
+  //
+  // The samplers run MmMpTestBlackoutSampler of this image on the run, so
+  // the image must not return before every one of them did, however long
+  // that takes.
+  //
+  Blackout->Stop = TRUE;
+  for (Waited = 0; gBS->CheckEvent (Done) == EFI_NOT_READY; Waited += MM_MP_TEST_BLACKOUT_POLL_US) {
+    if (Waited == MM_MP_TEST_BLACKOUT_WAIT_US) {
+      Print (L"Blackout: samplers did not return in %d ms, still waiting\n", MM_MP_TEST_BLACKOUT_WAIT_US / 1000);
+    }
+    gBS->Stall (MM_MP_TEST_BLACKOUT_POLL_US);
+  }
+
+  Print (
+    L"SMM blackout, 0x%x of 0x%x Aps sampling, TSC %ld MHz, gaps over %d us, %d SMIs per test\n",
+    Running,
+    NumberOfEnabledProcessors - 1,
+    TscMhz,
+    MM_MP_TEST_BLACKOUT_THRESHOLD_US,
+    Count
+    );
+  Print (L"baseline, %d ms without test SMIs:\n", MM_MP_TEST_BLACKOUT_BASELINE_US / 1000);
+  MmMpTestBlackoutPrint (Blackout, 0, 0, TscMhz);
+  for (TestId = 0; TestId <= MM_MP_TEST_ID_LAST; TestId++) {
+    if ((TestIds & (1 << TestId)) == 0) {
+      continue;
+    }
+    Print (L"test id 0x%x:\n", TestId);
+    MmMpTestBlackoutPrint (Blackout, TestId + 1, Count, TscMhz);
+  }
+
+  gBS->CloseEvent (Done);
+  FreePages (Blackout, Pages);
+  return EFI_SUCCESS;
+}
+
+/**
+  Trigger the MM MP test SMI.
+
+  An optional hexadecimal argument selects the test run by the SMI handler,
+  see the MM_MP_TEST_ID_* values. Without it the MM MP verification runs.
+  An optional second, decimal argument triggers the SMI that many times, which
+  shows how the SMM state of a test evolves across SMIs. An optional third,
+  decimal argument selects the MP_WORKLOAD_PROFILE the test procedures run.
+
+  With "blackout" as first argument the tests are triggered while the APs
+  sample the TSC, and the time each processor is stalled is reported. The
+  optional second and third arguments are then the count and the profile,
+  an optional fourth, hexadecimal argument the mask of test ids to trigger.
+  By default the timeout, cold cache and payload tests are left out.
+
+  @param[in] ImageHandle    The image handle.
+  @param[in] SystemTable    The system table.
+
+  @retval EFI_SUCCESS       The SMI has been triggered.
+**/
 EFI_STATUS
 EFIAPI
 InitializeSmiPerf (
@@ -31,13 +415,44 @@ InitializeSmiPerf (
   IN EFI_SYSTEM_TABLE     *SystemTable
   )
 {
-  EFI_TPL                   OldTpl;
+  EFI_STATUS                      Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL   *ShellParameters;
+  UINT8                           TestId;
+  UINTN                           Count;
+  UINTN                           Index;
+  UINT32                          TestIds;
 
-  Print (L"Trig SMI to test Mm Mp Protocol Begin!\n");
+  TestId = MM_MP_TEST_ID_VERIFICATION;
+  Count  = 1;
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **) &ShellParameters);
+  if (!EFI_ERROR (Status) && ShellParameters->Argc > 1 && StrCmp (ShellParameters->Argv[1], L"blackout") == 0) {
+    if (ShellParameters->Argc > 2) {
+      Count = StrDecimalToUintn (ShellParameters->Argv[2]);
+    }
+    if (ShellParameters->Argc > 3) {
+      TestId = (UINT8) (StrDecimalToUintn (ShellParameters->Argv[3]) << MM_MP_TEST_WORKLOAD_SHIFT);
+    }
+    TestIds = MM_MP_TEST_BLACKOUT_DEFAULT_IDS;
+    if (ShellParameters->Argc > 4) {
+      TestIds = (UINT32) StrHexToUintn (ShellParameters->Argv[4]);
+    }
+    return MmMpTestBlackout (Count, TestId, TestIds);
+  }
+  if (!EFI_ERROR (Status) && ShellParameters->Argc > 1) {
+    TestId = (UINT8) StrHexToUintn (ShellParameters->Argv[1]);
+    if (ShellParameters->Argc > 2) {
+      Count = StrDecimalToUintn (ShellParameters->Argv[2]);
+    }
+    if (ShellParameters->Argc > 3) {
+      TestId = (UINT8) ((TestId & MM_MP_TEST_ID_MASK) | (StrDecimalToUintn (ShellParameters->Argv[3]) << MM_MP_TEST_WORKLOAD_SHIFT));
+    }
+  }
 
-  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
-  IoWrite8 (0xB2, MM_MP_TEST_SW_SMI_VALUE);
-  gBS->RestoreTPL (OldTpl);
+  Print (L"Trig SMI to test Mm Mp Protocol Begin, test id = 0x%x, count = %d!\n", TestId, Count);
+
+  for (Index = 0; Index < Count; Index++) {
+    MmMpTestTriggerSmi (TestId);
+  }
 
   Print (L"Trig SMI to test Mm Mp Protocol Done!\n");
 
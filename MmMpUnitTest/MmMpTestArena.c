@@ -0,0 +1,373 @@
+/** @file
+  Per-SMI scratch arena of MmMpTestSmm.
+
+  A single SMRAM buffer is allocated at entry. Tests carve cache line aligned
+  blocks out of it with a bump pointer, and the SW SMI handler resets it at
+  the end of every SMI, so SMRAM use does not grow with the number of SMIs.
+
+  The file also holds a benchmark comparing the arena with the SMM pool.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Allocations per round of the arena benchmark.
+//
+#define MM_MP_TEST_ARENA_BENCH_ALLOCATIONS   64
+
+typedef struct {
+  UINT8     *Base;
+  UINTN     Size;
+  UINTN     Used;
+  UINTN     HighWater;
+} MM_MP_TEST_ARENA;
+
+MM_MP_TEST_ARENA    mArena;
+
+//
+// Address range the SMM pool has returned to the arena benchmark, over all
+// SMIs since boot.
+//
+UINTN               mPoolBenchSmiCount;
+UINTN               mPoolBenchLowest = MAX_UINTN;
+UINTN               mPoolBenchHighest;
+
+/**
+  Allocate the scratch arena in SMRAM.
+
+  @param[in]  Size    Size of the arena in bytes.
+
+  @retval EFI_SUCCESS             The arena is ready.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM.
+**/
+EFI_STATUS
+MmMpTestArenaInitialize (
+  IN UINTN                          Size
+  )
+{
+  mArena.Base = AllocatePages (EFI_SIZE_TO_PAGES (Size));
+  if (mArena.Base == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mArena.Size      = EFI_PAGES_TO_SIZE (EFI_SIZE_TO_PAGES (Size));
+  mArena.Used      = 0;
+  mArena.HighWater = 0;
+  return EFI_SUCCESS;
+}
+
+/**
+  Carve a cache line aligned block out of the scratch arena.
+
+  The block is valid until the end of the current SMI.
+
+  @param[in]  Size    Size of the block in bytes.
+
+  @return The block, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocate (
+  IN UINTN                          Size
+  )
+{
+  UINTN                          Offset;
+
+  Offset = ALIGN_VALUE (mArena.Used, MM_MP_TEST_CACHE_LINE_SIZE);
+  if (Offset > mArena.Size || Size > mArena.Size - Offset) {
+    DEBUG ((DEBUG_ERROR, "Scratch arena exhausted, 0x%x of 0x%x used, 0x%x requested!\n", mArena.Used, mArena.Size, Size));
+    return NULL;
+  }
+
+  mArena.Used = Offset + Size;
+  if (mArena.Used > mArena.HighWater) {
+    mArena.HighWater = mArena.Used;
+  }
+  return mArena.Base + Offset;
+}
+
+/**
+  Carve a zeroed, cache line aligned block out of the scratch arena.
+
+  @param[in]  Size    Size of the block in bytes.
+
+  @return The block, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocateZero (
+  IN UINTN                          Size
+  )
+{
+  VOID                           *Buffer;
+
+  Buffer = MmMpTestArenaAllocate (Size);
+  if (Buffer != NULL) {
+    ZeroMem (Buffer, Size);
+  }
+  return Buffer;
+}
+
+/**
+  Carve one zeroed slot per CPU out of the scratch arena.
+
+  Each slot starts on its own cache line and no two slots share a line, so
+  CPUs writing their own slot do not contend.
+
+  @param[in]  SizePerCpu    Size of one slot in bytes.
+  @param[in]  CpuCount      Number of slots.
+  @param[out] Stride        Distance between two slots in bytes.
+
+  @return The first slot, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocatePerCpu (
+  IN  UINTN                         SizePerCpu,
+  IN  UINTN                         CpuCount,
+  OUT UINTN                         *Stride
+  )
+{
+  *Stride = ALIGN_VALUE (SizePerCpu, MM_MP_TEST_CACHE_LINE_SIZE);
+  if (CpuCount != 0 && *Stride > MAX_UINTN / CpuCount) {
+    return NULL;
+  }
+  return MmMpTestArenaAllocateZero (*Stride * CpuCount);
+}
+
+/**
+  Build a zeroed argument table of one entry per CPU in the scratch arena.
+
+  @param[out] Table       The argument table.
+  @param[in]  SmmCpu      The SMM CPU service protocol.
+  @param[in]  CpuCount    Number of entries.
+  @param[in]  EntrySize   Size of one entry in bytes.
+
+  @retval EFI_SUCCESS             The table is ready.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is exhausted.
+**/
+EFI_STATUS
+MmMpTestArgumentTableCreate (
+  OUT MM_MP_TEST_ARGUMENT_TABLE     *Table,
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  IN  UINTN                         CpuCount,
+  IN  UINTN                         EntrySize
+  )
+{
+  Table->SmmCpu = SmmCpu;
+  Table->Count  = CpuCount;
+  Table->Entry  = MmMpTestArenaAllocatePerCpu (EntrySize, CpuCount, &Table->Stride);
+  if (Table->Entry == NULL) {
+    Table->Count = 0;
+    return EFI_OUT_OF_RESOURCES;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the argument table entry of a CPU.
+
+  @param[in]  Table       The argument table.
+  @param[in]  CpuIndex    The CPU.
+
+  @return The entry, or NULL if CpuIndex is out of range.
+**/
+VOID *
+MmMpTestArgumentOf (
+  IN CONST MM_MP_TEST_ARGUMENT_TABLE  *Table,
+  IN UINTN                            CpuIndex
+  )
+{
+  if (CpuIndex >= Table->Count) {
+    return NULL;
+  }
+  return Table->Entry + CpuIndex * Table->Stride;
+}
+
+/**
+  Return the argument table entry of the calling CPU, from a procedure.
+
+  @param[in]  Table       The argument table.
+
+  @return The entry, or NULL if WhoAmI failed.
+**/
+VOID *
+MmMpTestArgumentSelf (
+  IN CONST MM_MP_TEST_ARGUMENT_TABLE  *Table
+  )
+{
+  UINTN                          CpuIndex;
+
+  if (EFI_ERROR (MmMpTestWhoAmI (Table->SmmCpu, &CpuIndex))) {
+    return NULL;
+  }
+  return MmMpTestArgumentOf (Table, CpuIndex);
+}
+
+/**
+  Release everything carved out of the scratch arena.
+**/
+VOID
+MmMpTestArenaReset (
+  VOID
+  )
+{
+  mArena.Used = 0;
+}
+
+/**
+  Sizes of one benchmark round, modelled on what the tests allocate per SMI:
+  CPU status arrays, procedure arguments and per-CPU slots.
+
+  @param[in]  Index           Allocation index in the round.
+  @param[in]  ProcessorNum    Number of processors.
+
+  @return The allocation size in bytes.
+**/
+STATIC
+UINTN
+MmMpTestArenaBenchSize (
+  IN UINTN                          Index,
+  IN UINTN                          ProcessorNum
+  )
+{
+  switch (Index % 4) {
+  case 0:
+    return sizeof (EFI_STATUS) * ProcessorNum;
+  case 1:
+    return sizeof (PROCEDURE_ARGUMENTS);
+  case 2:
+    return MM_MP_TEST_CACHE_LINE_SIZE * ProcessorNum;
+  default:
+    return 24 + (Index % 7) * 40;
+  }
+}
+
+/**
+  Compare the scratch arena with the SMM pool for the allocations one SMI of
+  the tests does. Trigger the benchmark repeatedly to see the pool drift
+  across SMIs.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The pool or the arena ran out of memory.
+**/
+EFI_STATUS
+SmmMpArenaBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  VOID                           *Blocks[MM_MP_TEST_ARENA_BENCH_ALLOCATIONS];
+  UINTN                          Index;
+  UINTN                          Requested;
+  UINTN                          Size;
+  UINTN                          Lowest;
+  UINTN                          Highest;
+  UINTN                          ArenaStart;
+  BOOLEAN                        PoolFailed;
+  UINT64                         Start;
+  UINT64                         PoolAllocNs;
+  UINT64                         PoolFreeNs;
+  UINT64                         ArenaAllocNs;
+  UINT64                         ArenaResetNs;
+
+  mPoolBenchSmiCount++;
+
+  //
+  // SMM pool: allocate the whole round, then free it.
+  //
+  Start = GetPerformanceCounter ();
+  for (Index = 0; Index < MM_MP_TEST_ARENA_BENCH_ALLOCATIONS; Index++) {
+    Blocks[Index] = AllocatePool (MmMpTestArenaBenchSize (Index, Context->ProcessorNum));
+  }
+  PoolAllocNs = MpBenchElapsedNs (Start, GetPerformanceCounter ());
+
+  Requested  = 0;
+  Lowest     = MAX_UINTN;
+  Highest    = 0;
+  PoolFailed = FALSE;
+  for (Index = 0; Index < MM_MP_TEST_ARENA_BENCH_ALLOCATIONS; Index++) {
+    if (Blocks[Index] == NULL) {
+      DEBUG ((DEBUG_ERROR, "Arena benchmark: AllocatePool failed!\n"));
+      PoolFailed = TRUE;
+      break;
+    }
+    Size       = MmMpTestArenaBenchSize (Index, Context->ProcessorNum);
+    Requested += Size;
+    Lowest     = MIN (Lowest, (UINTN) Blocks[Index]);
+    Highest    = MAX (Highest, (UINTN) Blocks[Index] + Size);
+  }
+
+  Start = GetPerformanceCounter ();
+  for (Index = 0; Index < MM_MP_TEST_ARENA_BENCH_ALLOCATIONS; Index++) {
+    if (Blocks[Index] != NULL) {
+      FreePool (Blocks[Index]);
+    }
+  }
+  PoolFreeNs = MpBenchElapsedNs (Start, GetPerformanceCounter ());
+
+  //
+  // A partial round would report and keep a span that is not comparable.
+  //
+  if (PoolFailed) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  mPoolBenchLowest  = MIN (mPoolBenchLowest, Lowest);
+  mPoolBenchHighest = MAX (mPoolBenchHighest, Highest);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Arena benchmark SMI #%d, %d allocations, 0x%x bytes requested\n",
+    mPoolBenchSmiCount,
+    MM_MP_TEST_ARENA_BENCH_ALLOCATIONS,
+    Requested
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "  pool : alloc %ld ns, free %ld ns per call; span 0x%x bytes this SMI, 0x%x bytes over %d SMIs\n",
+    DivU64x32 (PoolAllocNs, MM_MP_TEST_ARENA_BENCH_ALLOCATIONS),
+    DivU64x32 (PoolFreeNs, MM_MP_TEST_ARENA_BENCH_ALLOCATIONS),
+    Highest - Lowest,
+    mPoolBenchHighest - mPoolBenchLowest,
+    mPoolBenchSmiCount
+    ));
+
+  //
+  // Scratch arena: same round, released by a single reset. Only the part
+  // carved by this round is reset, earlier blocks of this SMI stay valid.
+  //
+  ArenaStart = mArena.Used;
+  Start = GetPerformanceCounter ();
+  for (Index = 0; Index < MM_MP_TEST_ARENA_BENCH_ALLOCATIONS; Index++) {
+    Blocks[Index] = MmMpTestArenaAllocate (MmMpTestArenaBenchSize (Index, Context->ProcessorNum));
+  }
+  ArenaAllocNs = MpBenchElapsedNs (Start, GetPerformanceCounter ());
+
+  for (Index = 0; Index < MM_MP_TEST_ARENA_BENCH_ALLOCATIONS; Index++) {
+    if (Blocks[Index] == NULL) {
+      mArena.Used = ArenaStart;
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  Size = mArena.Used - ArenaStart;
+
+  Start = GetPerformanceCounter ();
+  mArena.Used = ArenaStart;
+  ArenaResetNs = MpBenchElapsedNs (Start, GetPerformanceCounter ());
+
+  DEBUG ((
+    DEBUG_INFO,
+    "  arena: alloc %ld ns per call, reset %ld ns; span 0x%x bytes (%d%% alignment padding), high water 0x%x of 0x%x\n",
+    DivU64x32 (ArenaAllocNs, MM_MP_TEST_ARENA_BENCH_ALLOCATIONS),
+    ArenaResetNs,
+    Size,
+    (UINTN) DivU64x64Remainder (MultU64x32 (Size - Requested, 100), Size, NULL),
+    mArena.HighWater,
+    mArena.Size
+    ));
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
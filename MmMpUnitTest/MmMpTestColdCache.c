@@ -0,0 +1,331 @@
+/** @file
+  DispatchProcedure and BroadcastProcedure latency with warm and cold caches.
+
+  The other tests call the MM MP protocol back to back, so its code, its
+  mailboxes and the AP wait loops are in cache. An SMI from a busy OS finds
+  them evicted. Each call here is timed in three cache states:
+
+  - warm: right after the previous call, as the other tests see it.
+  - WBINVD: every AP, then the BSP, has written back and invalidated its
+    caches.
+  - evicted: every AP, then the BSP, has read an eviction buffer of twice
+    the last level cache, which pushes out the MM MP lines the way other
+    code would, dirty lines included. The buffer is capped by
+    PcdMmMpTestEvictSize; without SMRAM for it the state is skipped.
+
+  The APs flush or evict from within a broadcast procedure. Returning from
+  it brings a few lines of the AP wait loop back, so the cold numbers are a
+  lower bound of what a really cold SMI costs.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_COLD_SAMPLES         MM_MP_TEST_SAMPLES (4)
+
+#define MM_MP_TEST_CPUID_CACHE_PARAMS   0x04
+
+typedef enum {
+  CacheWarm,
+  CacheWbinvd,
+  CacheEvicted,
+  CacheStateMax
+} MM_MP_TEST_CACHE_STATE;
+
+STATIC CONST CHAR8  *mCacheStateName[CacheStateMax] = {
+  "warm",
+  "WBINVD",
+  "evicted"
+};
+
+//
+// Eviction buffer, allocated for the SMI running the test and freed before
+// it returns.
+//
+STATIC UINT8    *mEvictBuffer;
+STATIC UINTN    mEvictSize;
+
+//
+// Sum of the eviction reads, so the compiler keeps them.
+//
+STATIC volatile UINTN  mEvictSink;
+
+/**
+  Return the size of the largest cache from CPUID leaf 4.
+
+  @return Bytes, or 0 if the leaf is not supported.
+**/
+STATIC
+UINTN
+ColdCacheLastLevelSize (
+  VOID
+  )
+{
+  UINT32                         MaxLeaf;
+  UINT32                         Eax;
+  UINT32                         Ebx;
+  UINT32                         Ecx;
+  UINT32                         SubLeaf;
+  UINTN                          Size;
+  UINTN                          Largest;
+
+  AsmCpuid (0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < MM_MP_TEST_CPUID_CACHE_PARAMS) {
+    return 0;
+  }
+
+  Largest = 0;
+  for (SubLeaf = 0; ; SubLeaf++) {
+    AsmCpuidEx (MM_MP_TEST_CPUID_CACHE_PARAMS, SubLeaf, &Eax, &Ebx, &Ecx, NULL);
+    if ((Eax & 0x1F) == 0) {
+      break;
+    }
+    //
+    // Ways * partitions * line size * sets.
+    //
+    Size = (UINTN) (BitFieldRead32 (Ebx, 22, 31) + 1) *
+           (BitFieldRead32 (Ebx, 12, 21) + 1) *
+           (BitFieldRead32 (Ebx, 0, 11) + 1) *
+           ((UINTN) Ecx + 1);
+    Largest = MAX (Largest, Size);
+  }
+
+  return Largest;
+}
+
+/**
+  Read one byte of every cache line of the eviction buffer.
+**/
+STATIC
+VOID
+ColdCacheEvict (
+  VOID
+  )
+{
+  UINTN                          Offset;
+  UINTN                          Sum;
+
+  Sum = 0;
+  for (Offset = 0; Offset < mEvictSize; Offset += MM_MP_TEST_CACHE_LINE_SIZE) {
+    Sum += ((volatile UINT8 *) mEvictBuffer)[Offset];
+  }
+  mEvictSink = Sum;
+}
+
+/**
+  Broadcast procedure leaving the caches of the calling AP cold.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_CACHE_STATE.
+
+  @retval EFI_SUCCESS   Always.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ColdCacheProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  if (*(MM_MP_TEST_CACHE_STATE *) ProcedureArgument == CacheWbinvd) {
+    AsmWbinvd ();
+  } else {
+    ColdCacheEvict ();
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  The procedure timed in every cache state.
+
+  @param[in]  ProcedureArgument   Unused.
+
+  @retval EFI_SUCCESS   Always.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ColdCacheEmptyProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Bring the caches of all CPUs into a state before a timed call.
+
+  @param[in]  Context   The MM MP test context.
+  @param[in]  State     The cache state.
+
+  @retval EFI_SUCCESS   The caches are in the state.
+  @retval Others        The broadcast failed.
+**/
+STATIC
+EFI_STATUS
+ColdCachePrepare (
+  IN MM_MP_TEST_CONTEXT             *Context,
+  IN MM_MP_TEST_CACHE_STATE         State
+  )
+{
+  EFI_STATUS                     Status;
+
+  if (State == CacheWarm) {
+    return EFI_SUCCESS;
+  }
+
+  Status = Context->SmmMp->BroadcastProcedure (Context->SmmMp, ColdCacheProcedure, 0, &State, NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (State == CacheWbinvd) {
+    AsmWbinvd ();
+  } else {
+    ColdCacheEvict ();
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Time DispatchProcedure to the selected AP and BroadcastProcedure to all
+  APs with warm caches, after WBINVD and after an eviction buffer walk, and
+  print the latencies side by side.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran, without the evicted
+                                  state if there was no SMRAM for it.
+  @retval Others                  A dispatch or broadcast failed.
+**/
+EFI_STATUS
+SmmMpColdCacheBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_CACHE_STATE         State;
+  MP_BENCH_STATS                 Dispatch[CacheStateMax];
+  MP_BENCH_STATS                 Broadcast[CacheStateMax];
+  UINTN                          Sample;
+  UINTN                          LastLevel;
+  UINT64                         Start;
+
+  LastLevel  = ColdCacheLastLevelSize ();
+  mEvictSize = (LastLevel == 0) ? FixedPcdGet32 (PcdMmMpTestEvictSize) : MIN (2 * LastLevel, FixedPcdGet32 (PcdMmMpTestEvictSize));
+  mEvictSize = ALIGN_VALUE (mEvictSize, EFI_PAGE_SIZE);
+  if (mEvictSize < 2 * LastLevel) {
+    DEBUG ((DEBUG_WARN, "Cold cache: eviction buffer capped at 0x%x bytes, last level cache 0x%x bytes, the eviction is incomplete.\n", mEvictSize, LastLevel));
+  }
+  mEvictBuffer = AllocatePages (EFI_SIZE_TO_PAGES (mEvictSize));
+  if (mEvictBuffer == NULL) {
+    DEBUG ((DEBUG_ERROR, "Cold cache: no SMRAM for a 0x%x byte eviction buffer, the %a state is skipped!\n", mEvictSize, mCacheStateName[CacheEvicted]));
+  } else {
+    //
+    // Dirty the buffer once, so its pages are backed and its lines real.
+    //
+    SetMem (mEvictBuffer, mEvictSize, 0x5A);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Cold against warm cache latency, Ap 0x%x, 0x%x Aps, eviction buffer 0x%x bytes, %d samples\n",
+    Context->SelectedApIndex,
+    Context->ProcessorNum - 1,
+    mEvictSize,
+    MM_MP_TEST_COLD_SAMPLES
+    ));
+
+  //
+  // The states are interleaved per sample, so a drift of the platform over
+  // the run hits all of them alike.
+  //
+  for (State = 0; State < CacheStateMax; State++) {
+    MpBenchStatsReset (&Dispatch[State]);
+    MpBenchStatsReset (&Broadcast[State]);
+  }
+  Status = EFI_SUCCESS;
+  for (Sample = 0; Sample < MM_MP_TEST_COLD_SAMPLES; Sample++) {
+    for (State = 0; State < CacheStateMax; State++) {
+      if (State == CacheEvicted && mEvictBuffer == NULL) {
+        continue;
+      }
+      //
+      // Warm: one untimed call first, as back to back tests run.
+      //
+      Status = ColdCachePrepare (Context, State);
+      if (!EFI_ERROR (Status) && State == CacheWarm) {
+        Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, ColdCacheEmptyProcedure, Context->SelectedApIndex, 0, NULL, NULL, NULL);
+      }
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Cold cache %a: preparation failed, %r!\n", mCacheStateName[State], Status));
+        goto Exit;
+      }
+      Start  = GetPerformanceCounter ();
+      Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, ColdCacheEmptyProcedure, Context->SelectedApIndex, 0, NULL, NULL, NULL);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Cold cache %a: DispatchProcedure failed, %r!\n", mCacheStateName[State], Status));
+        goto Exit;
+      }
+      MpBenchStatsAdd (&Dispatch[State], MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+
+      Status = ColdCachePrepare (Context, State);
+      if (!EFI_ERROR (Status) && State == CacheWarm) {
+        Status = Context->SmmMp->BroadcastProcedure (Context->SmmMp, ColdCacheEmptyProcedure, 0, NULL, NULL, NULL);
+      }
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Cold cache %a: preparation failed, %r!\n", mCacheStateName[State], Status));
+        goto Exit;
+      }
+      Start  = GetPerformanceCounter ();
+      Status = Context->SmmMp->BroadcastProcedure (Context->SmmMp, ColdCacheEmptyProcedure, 0, NULL, NULL, NULL);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Cold cache %a: BroadcastProcedure failed, %r!\n", mCacheStateName[State], Status));
+        goto Exit;
+      }
+      MpBenchStatsAdd (&Broadcast[State], MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+    }
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "  %-18a %16a %16a %16a\n",
+    "mean / p99 ns",
+    mCacheStateName[CacheWarm],
+    mCacheStateName[CacheWbinvd],
+    mCacheStateName[CacheEvicted]
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "  %-18a %7ld / %6ld %7ld / %6ld %7ld / %6ld\n",
+    "DispatchProcedure",
+    MpBenchStatsMean (&Dispatch[CacheWarm]),
+    MpBenchStatsPercentile (&Dispatch[CacheWarm], 99),
+    MpBenchStatsMean (&Dispatch[CacheWbinvd]),
+    MpBenchStatsPercentile (&Dispatch[CacheWbinvd], 99),
+    MpBenchStatsMean (&Dispatch[CacheEvicted]),
+    MpBenchStatsPercentile (&Dispatch[CacheEvicted], 99)
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "  %-18a %7ld / %6ld %7ld / %6ld %7ld / %6ld\n",
+    "BroadcastProcedure",
+    MpBenchStatsMean (&Broadcast[CacheWarm]),
+    MpBenchStatsPercentile (&Broadcast[CacheWarm], 99),
+    MpBenchStatsMean (&Broadcast[CacheWbinvd]),
+    MpBenchStatsPercentile (&Broadcast[CacheWbinvd], 99),
+    MpBenchStatsMean (&Broadcast[CacheEvicted]),
+    MpBenchStatsPercentile (&Broadcast[CacheEvicted], 99)
+    ));
+  DEBUG ((DEBUG_INFO, "\n"));
+
+Exit:
+  if (mEvictBuffer != NULL) {
+    FreePages (mEvictBuffer, EFI_SIZE_TO_PAGES (mEvictSize));
+    mEvictBuffer = NULL;
+  }
+  return Status;
+}
@@ -0,0 +1,279 @@
+/** @file
+  Cost of counting events on the APs: InterlockedIncrement of one shared
+  counter against MpShardedCounterLib, as the number of counting APs grows.
+
+  For each AP count the first APs in processor order count, the others
+  return at once. The counting APs meet at a barrier first, so their loops
+  overlap, then each times its own loop with the TSC. The slowest loop over
+  the increments of one AP is the wall cost of one increment, reported in
+  picoseconds as the PEI counter phase does.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_COUNTER_SAMPLES          MM_MP_TEST_SAMPLES (4)
+#define MM_MP_TEST_COUNTER_INCREMENTS       4096
+#define MM_MP_TEST_COUNTER_CALIBRATE_US     1000
+
+typedef struct {
+  EFI_SMM_CPU_SERVICE_PROTOCOL   *SmmCpu;
+  UINTN                          BspIndex;
+  UINTN                          ActiveAps;
+  BOOLEAN                        Sharded;
+  //
+  // Each on its own cache line.
+  //
+  volatile UINT32                *Shared;
+  volatile UINT32                *Arrived;
+  MP_SHARDED_COUNTER             *Counter;
+  //
+  // Per CPU loop time in TSC cycles, 0 if the CPU did not count.
+  //
+  UINT8                          *Cycles;
+  UINTN                          Stride;
+} MM_MP_TEST_COUNTER_ARGUMENT;
+
+/**
+  Broadcast procedure: count MM_MP_TEST_COUNTER_INCREMENTS events into the
+  shared or the sharded counter, if the AP is one of the first ActiveAps.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_COUNTER_ARGUMENT.
+
+  @retval EFI_SUCCESS     The AP counted, or was not asked to.
+  @retval EFI_TIMEOUT     The other counting APs did not arrive.
+  @retval Others          WhoAmI failed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+CounterProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_COUNTER_ARGUMENT    *Argument;
+  UINTN                          CpuIndex;
+  UINTN                          Rank;
+  UINTN                          Count;
+  UINT64                         Start;
+
+  Argument = (MM_MP_TEST_COUNTER_ARGUMENT *)ProcedureArgument;
+  Status   = MmMpTestWhoAmI (Argument->SmmCpu, &CpuIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Rank = (CpuIndex < Argument->BspIndex) ? CpuIndex : CpuIndex - 1;
+  if (Rank >= Argument->ActiveAps) {
+    return EFI_SUCCESS;
+  }
+
+  if (!MpBenchBarrierWait (Argument->Arrived, Argument->ActiveAps)) {
+    return EFI_TIMEOUT;
+  }
+
+  Start = AsmReadTsc ();
+  if (Argument->Sharded) {
+    for (Count = 0; Count < MM_MP_TEST_COUNTER_INCREMENTS; Count++) {
+      MpShardedCounterIncrement (Argument->Counter, CpuIndex, 0);
+    }
+  } else {
+    for (Count = 0; Count < MM_MP_TEST_COUNTER_INCREMENTS; Count++) {
+      InterlockedIncrement (Argument->Shared);
+    }
+  }
+  *(UINT64 *)(Argument->Cycles + CpuIndex * Argument->Stride) = AsmReadTsc () - Start;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Run the counting procedure on the first ActiveAps APs Samples times, and
+  return the wall cost of one increment in picoseconds.
+
+  @param[in]      Context    The MM MP test context.
+  @param[in]      TscMhz     TSC rate.
+  @param[in, out] Argument   The procedure argument, ActiveAps and Sharded
+                             set.
+  @param[out]     CpuStatus  Per CPU status of the procedure.
+  @param[in, out] Result     Failures of the APs.
+  @param[out]     Stats      Picoseconds per increment of the slowest AP.
+
+  @retval EFI_SUCCESS   Every sample counted every event.
+  @retval EFI_ABORTED   A sample lost events.
+  @retval Others        BroadcastProcedure failed.
+**/
+STATIC
+EFI_STATUS
+CounterMeasure (
+  IN     MM_MP_TEST_CONTEXT             *Context,
+  IN     UINT64                         TscMhz,
+  IN OUT MM_MP_TEST_COUNTER_ARGUMENT    *Argument,
+  OUT    EFI_STATUS                     *CpuStatus,
+  IN OUT MM_MP_TEST_RESULT              *Result,
+  OUT    MP_BENCH_STATS                 *Stats
+  )
+{
+  EFI_STATUS                     Status;
+  UINT64                         Slowest;
+  UINT64                         Total;
+  UINTN                          Sample;
+  UINTN                          Index;
+
+  MpBenchStatsReset (Stats);
+  for (Sample = 0; Sample < MM_MP_TEST_COUNTER_SAMPLES; Sample++) {
+    *Argument->Shared  = 0;
+    *Argument->Arrived = 0;
+    MpShardedCounterReset (Argument->Counter);
+    ZeroMem (Argument->Cycles, Context->ProcessorNum * Argument->Stride);
+    SetMem (CpuStatus, Context->ProcessorNum * sizeof (EFI_STATUS), 0xFF);
+
+    Status = Context->SmmMp->BroadcastProcedure (Context->SmmMp, CounterProcedure, 0, Argument, NULL, CpuStatus);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    MmMpTestResultCheck (Result, CpuStatus, EFI_SUCCESS, FALSE);
+
+    Total = Argument->Sharded ? MpShardedCounterRead (Argument->Counter, 0) : *Argument->Shared;
+    if (Total != MultU64x32 (Argument->ActiveAps, MM_MP_TEST_COUNTER_INCREMENTS)) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "%a counter: 0x%lx events counted by 0x%x Aps, 0x%lx expected!\n",
+        Argument->Sharded ? "Sharded" : "Shared",
+        Total,
+        Argument->ActiveAps,
+        MultU64x32 (Argument->ActiveAps, MM_MP_TEST_COUNTER_INCREMENTS)
+        ));
+      return EFI_ABORTED;
+    }
+
+    Slowest = 0;
+    for (Index = 0; Index < Context->ProcessorNum; Index++) {
+      Slowest = MAX (Slowest, *(UINT64 *)(Argument->Cycles + Index * Argument->Stride));
+    }
+    //
+    // Picoseconds: an uncontended increment takes about a nanosecond.
+    //
+    MpBenchStatsAdd (Stats, DivU64x64Remainder (MultU64x32 (Slowest, 1000000), TscMhz * MM_MP_TEST_COUNTER_INCREMENTS, NULL));
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Compare InterlockedIncrement of one shared counter with a sharded
+  counter, for 1, 2, 4 ... and all APs counting at once.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A broadcast failed, or events were lost.
+**/
+EFI_STATUS
+SmmMpCounterBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_COUNTER_ARGUMENT    Argument;
+  MM_MP_TEST_RESULT              Result;
+  EFI_STATUS                     *CpuStatus;
+  MP_BENCH_STATS                 Shared;
+  MP_BENCH_STATS                 Sharded;
+  UINTN                          ApCount;
+  UINTN                          Size;
+  UINT64                         SharedPs;
+  UINT64                         ShardedPs;
+  UINT64                         TscStart;
+  UINT64                         Start;
+  UINT64                         TscMhz;
+
+  if (Context->ProcessorNum < 2) {
+    return EFI_SUCCESS;
+  }
+  ApCount = Context->ProcessorNum - 1;
+
+  Status = MmMpTestResultInitialize (&Result, Context->SmmCpu, Context->ProcessorNum, Context->BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Size               = MpShardedCounterSize (Context->ProcessorNum);
+  Argument.SmmCpu    = Context->SmmCpu;
+  Argument.BspIndex  = Context->BspIndex;
+  Argument.Shared    = MmMpTestArenaAllocateZero (sizeof (UINT32));
+  Argument.Arrived   = MmMpTestArenaAllocateZero (sizeof (UINT32));
+  Argument.Cycles    = MmMpTestArenaAllocatePerCpu (sizeof (UINT64), Context->ProcessorNum, &Argument.Stride);
+  Argument.Counter   = (Size == 0) ? NULL : MmMpTestArenaAllocate (Size);
+  CpuStatus          = MmMpTestArenaAllocate (Context->ProcessorNum * sizeof (EFI_STATUS));
+  if (Argument.Shared == NULL || Argument.Arrived == NULL || Argument.Cycles == NULL || Argument.Counter == NULL || CpuStatus == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Argument.Counter = MpShardedCounterInitialize (Argument.Counter, Size, Context->ProcessorNum, 1);
+  ASSERT (Argument.Counter != NULL);
+
+  TscStart = AsmReadTsc ();
+  Start    = GetPerformanceCounter ();
+  Sleep (MM_MP_TEST_COUNTER_CALIBRATE_US);
+  TscMhz = DivU64x64Remainder (
+             MultU64x32 (AsmReadTsc () - TscStart, 1000),
+             MAX (MpBenchElapsedNs (Start, GetPerformanceCounter ()), 1),
+             NULL
+             );
+  TscMhz = MAX (TscMhz, 1);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Shared against sharded counter, 0x%x Aps, %d increments per Ap, %d samples, ps per increment of the slowest Ap\n",
+    ApCount,
+    MM_MP_TEST_COUNTER_INCREMENTS,
+    MM_MP_TEST_COUNTER_SAMPLES
+    ));
+
+  Argument.ActiveAps = 1;
+  while (TRUE) {
+    Argument.Sharded = FALSE;
+    Status = CounterMeasure (Context, TscMhz, &Argument, CpuStatus, &Result, &Shared);
+    if (!EFI_ERROR (Status)) {
+      Argument.Sharded = TRUE;
+      Status = CounterMeasure (Context, TscMhz, &Argument, CpuStatus, &Result, &Sharded);
+    }
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Counter with 0x%x Aps: %r!\n", Argument.ActiveAps, Status));
+      break;
+    }
+
+    //
+    // Events per microsecond of all counting APs together, from the mean in
+    // picoseconds.
+    //
+    SharedPs  = MAX (MpBenchStatsMean (&Shared), 1);
+    ShardedPs = MAX (MpBenchStatsMean (&Sharded), 1);
+    DEBUG ((
+      DEBUG_INFO,
+      "  0x%x Aps: shared %ld p99 %ld (%ld per us), sharded %ld p99 %ld (%ld per us)\n",
+      Argument.ActiveAps,
+      MpBenchStatsMean (&Shared),
+      MpBenchStatsPercentile (&Shared, 99),
+      DivU64x64Remainder (MultU64x32 (Argument.ActiveAps, 1000000), SharedPs, NULL),
+      MpBenchStatsMean (&Sharded),
+      MpBenchStatsPercentile (&Sharded, 99),
+      DivU64x64Remainder (MultU64x32 (Argument.ActiveAps, 1000000), ShardedPs, NULL)
+      ));
+
+    if (Argument.ActiveAps == ApCount) {
+      break;
+    }
+    Argument.ActiveAps = MIN (Argument.ActiveAps * 2, ApCount);
+  }
+
+  MmMpTestResultPrint (&Result, "Counter");
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return Status;
+}
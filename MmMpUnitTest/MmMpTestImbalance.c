@@ -0,0 +1,344 @@
+/** @file
+  Load imbalance and tail latency of BroadcastProcedure.
+
+  Every AP gets its own amount of work from an argument table indexed by
+  processor number, drawn from one of several distributions with the same
+  nominal mean, the straggler adding its one long AP on top. The broadcast
+  completes when the slowest AP does, so its completion time is compared
+  with the ideal, the mean work actually drawn per AP, which a perfectly
+  balanced split of the same total work would take.
+
+  The finish time of every AP is stamped with the TSC and translated to the
+  BSP TSC with the offsets of the TSC test, when it has run.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_IMBALANCE_SAMPLES        MM_MP_TEST_SAMPLES (2)
+#define MM_MP_TEST_IMBALANCE_CALIBRATE_US   1000
+
+//
+// Bimodal: one AP in MM_MP_TEST_IMBALANCE_BIMODAL_ONE_IN runs
+// MM_MP_TEST_IMBALANCE_BIMODAL_LONG times the mean, the others half of it.
+//
+#define MM_MP_TEST_IMBALANCE_BIMODAL_ONE_IN 5
+#define MM_MP_TEST_IMBALANCE_BIMODAL_LONG   3
+
+//
+// Straggler: one random AP runs this many times the mean.
+//
+#define MM_MP_TEST_IMBALANCE_STRAGGLER      8
+
+//
+// Heavy tail: a base doubled once per draw that falls below 2 in 5, at most
+// MM_MP_TEST_IMBALANCE_TAIL_MAX times. P (X > 2^k) = 0.4^k is a power law
+// with exponent 1.32: finite mean, unbounded variance. With the cap the mean
+// of the doublings is 3 - 2 * 0.8^MAX, the base is the mean divided by it.
+//
+#define MM_MP_TEST_IMBALANCE_TAIL_MAX       6
+
+typedef enum {
+  ImbalanceEqual,
+  ImbalanceUniform,
+  ImbalanceBimodal,
+  ImbalanceStraggler,
+  ImbalanceHeavyTail,
+  ImbalanceMax
+} MM_MP_TEST_IMBALANCE_DISTRIBUTION;
+
+STATIC CONST CHAR8  *mImbalanceName[ImbalanceMax] = {
+  "equal",
+  "uniform",
+  "bimodal",
+  "straggler",
+  "heavy tail"
+};
+
+//
+// Per processor entry of the argument table.
+//
+typedef struct {
+  UINT64                         WorkTicks;
+  UINT64                         DoneTsc;
+} MM_MP_TEST_IMBALANCE_SLICE;
+
+typedef struct {
+  MM_MP_TEST_ARGUMENT_TABLE      Arguments;
+  MP_WORKLOAD                    *Workload;
+} MM_MP_TEST_IMBALANCE_TABLE;
+
+/**
+  Advance a xorshift32 generator.
+
+  @param[in, out] State   Generator state, must not be 0.
+
+  @return The next value.
+**/
+STATIC
+UINT32
+ImbalanceRandom (
+  IN OUT UINT32  *State
+  )
+{
+  UINT32  Value;
+
+  Value  = *State;
+  Value ^= Value << 13;
+  Value ^= Value >> 17;
+  Value ^= Value << 5;
+  *State = Value;
+  return Value;
+}
+
+/**
+  Broadcast procedure running the work of its own table entry.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_IMBALANCE_TABLE.
+
+  @retval EFI_SUCCESS     The work ran.
+  @retval EFI_NOT_FOUND   WhoAmI failed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+ImbalanceProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_IMBALANCE_TABLE     *Table;
+  MM_MP_TEST_IMBALANCE_SLICE     *Slice;
+
+  Table = (MM_MP_TEST_IMBALANCE_TABLE *)ProcedureArgument;
+  Slice = MmMpTestArgumentSelf (&Table->Arguments);
+  if (Slice == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Table->Workload != NULL) {
+    MpWorkloadRun (Table->Workload, Slice->WorkTicks);
+  } else {
+    SpinForTicks (Slice->WorkTicks);
+  }
+  Slice->DoneTsc = AsmReadTsc ();
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Draw the work of one AP.
+
+  @param[in]      Distribution   The distribution.
+  @param[in]      MeanTicks      Nominal mean work.
+  @param[in]      IsStraggler    The AP is the straggler of this sample.
+  @param[in, out] Seed           Generator state.
+
+  @return Work in performance counter ticks.
+**/
+STATIC
+UINT64
+ImbalanceDraw (
+  IN     MM_MP_TEST_IMBALANCE_DISTRIBUTION  Distribution,
+  IN     UINT64                             MeanTicks,
+  IN     BOOLEAN                            IsStraggler,
+  IN OUT UINT32                             *Seed
+  )
+{
+  UINT64  Ticks;
+  UINTN   Doubling;
+  UINT32  Fives;
+  UINT32  Fours;
+
+  switch (Distribution) {
+  case ImbalanceUniform:
+    //
+    // Uniform in [mean / 2, 3 * mean / 2).
+    //
+    return MeanTicks / 2 + DivU64x32 (MultU64x32 (MeanTicks, ImbalanceRandom (Seed) % 1024), 1024);
+
+  case ImbalanceBimodal:
+    if (ImbalanceRandom (Seed) % MM_MP_TEST_IMBALANCE_BIMODAL_ONE_IN == 0) {
+      return MultU64x32 (MeanTicks, MM_MP_TEST_IMBALANCE_BIMODAL_LONG);
+    }
+    return MeanTicks / 2;
+
+  case ImbalanceStraggler:
+    return IsStraggler ? MultU64x32 (MeanTicks, MM_MP_TEST_IMBALANCE_STRAGGLER) : MeanTicks;
+
+  case ImbalanceHeavyTail:
+    //
+    // 3 - 2 * 0.8^MAX is (3 * 5^MAX - 2 * 4^MAX) / 5^MAX.
+    //
+    Fives = 1;
+    Fours = 1;
+    for (Doubling = 0; Doubling < MM_MP_TEST_IMBALANCE_TAIL_MAX; Doubling++) {
+      Fives *= 5;
+      Fours *= 4;
+    }
+    Ticks = DivU64x32 (MultU64x32 (MeanTicks, Fives), 3 * Fives - 2 * Fours);
+    for (Doubling = 0; Doubling < MM_MP_TEST_IMBALANCE_TAIL_MAX && ImbalanceRandom (Seed) % 5 < 2; Doubling++) {
+      Ticks *= 2;
+    }
+    return Ticks;
+
+  default:
+    return MeanTicks;
+  }
+}
+
+/**
+  Broadcast work drawn from each distribution and report the completion
+  time against the ideal of a balanced split.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A broadcast failed.
+**/
+EFI_STATUS
+SmmMpImbalanceBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_IMBALANCE_TABLE     Table;
+  MM_MP_TEST_IMBALANCE_SLICE     *Slice;
+  MM_MP_TEST_IMBALANCE_DISTRIBUTION  Distribution;
+  MP_BENCH_STATS                 Completion;
+  MP_BENCH_STATS                 Ideal;
+  MP_BENCH_STATS                 Slowest;
+  MP_BENCH_STATS                 Spread;
+  UINT64                         MeanTicks;
+  UINT64                         Now;
+  UINT64                         Start;
+  UINT64                         TscStart;
+  UINT64                         TscMhz;
+  UINT64                         TotalTicks;
+  UINT64                         MaxTicks;
+  UINT64                         FirstDone;
+  UINT64                         LastDone;
+  UINT64                         Done;
+  UINT64                         IdealNs;
+  UINTN                          ApCount;
+  UINTN                          Straggler;
+  UINTN                          Sample;
+  UINTN                          Index;
+  UINT32                         Seed;
+
+  if (Context->ProcessorNum < 2) {
+    return EFI_SUCCESS;
+  }
+  ApCount = Context->ProcessorNum - 1;
+
+  Table.Workload = mWorkload;
+  Status = MmMpTestArgumentTableCreate (&Table.Arguments, Context->SmmCpu, Context->ProcessorNum, sizeof (MM_MP_TEST_IMBALANCE_SLICE));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  TscStart = AsmReadTsc ();
+  Start    = GetPerformanceCounter ();
+  Sleep (MM_MP_TEST_IMBALANCE_CALIBRATE_US);
+  TscMhz = DivU64x64Remainder (
+             MultU64x32 (AsmReadTsc () - TscStart, 1000),
+             MAX (MpBenchElapsedNs (Start, GetPerformanceCounter ()), 1),
+             NULL
+             );
+  TscMhz = MAX (TscMhz, 1);
+
+  MeanTicks = CalculateTimeout (PcdGet32 (PcdMmMpTestImbalanceMeanUs), &Now);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "BroadcastProcedure imbalance, 0x%x Aps, nominal mean work %d us, %d samples, %a body\n",
+    ApCount,
+    PcdGet32 (PcdMmMpTestImbalanceMeanUs),
+    MM_MP_TEST_IMBALANCE_SAMPLES,
+    mWorkload != NULL ? MpWorkloadProfileName (mWorkload->Profile) : "spin"
+    ));
+
+  for (Distribution = 0; Distribution < ImbalanceMax; Distribution++) {
+    MpBenchStatsReset (&Completion);
+    MpBenchStatsReset (&Ideal);
+    MpBenchStatsReset (&Slowest);
+    MpBenchStatsReset (&Spread);
+
+    //
+    // A fixed seed per distribution keeps the tables the same from run to run.
+    //
+    Seed = 0x2545F491 + (UINT32) Distribution;
+
+    for (Sample = 0; Sample < MM_MP_TEST_IMBALANCE_SAMPLES; Sample++) {
+      Straggler  = ImbalanceRandom (&Seed) % Context->ProcessorNum;
+      if (Straggler == Context->BspIndex) {
+        Straggler = Context->SelectedApIndex;
+      }
+
+      TotalTicks = 0;
+      MaxTicks   = 0;
+      for (Index = 0; Index < Context->ProcessorNum; Index++) {
+        Slice = MmMpTestArgumentOf (&Table.Arguments, Index);
+        Slice->DoneTsc   = 0;
+        Slice->WorkTicks = 0;
+        if (Index == Context->BspIndex) {
+          continue;
+        }
+        Slice->WorkTicks = ImbalanceDraw (Distribution, MeanTicks, (BOOLEAN) (Index == Straggler), &Seed);
+        TotalTicks += Slice->WorkTicks;
+        MaxTicks    = MAX (MaxTicks, Slice->WorkTicks);
+      }
+
+      TscStart = AsmReadTsc ();
+      Start    = GetPerformanceCounter ();
+      Status   = Context->SmmMp->BroadcastProcedure (Context->SmmMp, ImbalanceProcedure, 0, &Table, NULL, NULL);
+      Now      = GetPerformanceCounter ();
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Imbalance %a: BroadcastProcedure failed, %r!\n", mImbalanceName[Distribution], Status));
+        return Status;
+      }
+
+      MpBenchStatsAdd (&Completion, MpBenchElapsedNs (Start, Now));
+      MpBenchStatsAdd (&Ideal, GetTimeInNanoSecond (DivU64x64Remainder (TotalTicks, ApCount, NULL)));
+      MpBenchStatsAdd (&Slowest, GetTimeInNanoSecond (MaxTicks));
+
+      //
+      // First to last AP finish, on the BSP TSC.
+      //
+      FirstDone = MAX_UINT64;
+      LastDone  = 0;
+      for (Index = 0; Index < Context->ProcessorNum; Index++) {
+        Done = ((MM_MP_TEST_IMBALANCE_SLICE *) MmMpTestArgumentOf (&Table.Arguments, Index))->DoneTsc;
+        if (Index == Context->BspIndex || Done == 0) {
+          continue;
+        }
+        Done      = MmMpTestTscToBsp (Index, Done);
+        FirstDone = MIN (FirstDone, Done);
+        LastDone  = MAX (LastDone, Done);
+      }
+      if (LastDone >= FirstDone) {
+        MpBenchStatsAdd (&Spread, DivU64x64Remainder (MultU64x32 (LastDone - FirstDone, 1000), TscMhz, NULL));
+      }
+    }
+
+    IdealNs = MAX (MpBenchStatsMean (&Ideal), 1);
+    DEBUG ((
+      DEBUG_INFO,
+      "  %-10a ideal %ld ns, slowest Ap %ld ns, completion mean %ld ns p99 %ld ns, %ld%% of ideal, finish spread %ld ns\n",
+      mImbalanceName[Distribution],
+      IdealNs,
+      MpBenchStatsMean (&Slowest),
+      MpBenchStatsMean (&Completion),
+      MpBenchStatsPercentile (&Completion, 99),
+      DivU64x64Remainder (MultU64x32 (MpBenchStatsMean (&Completion), 100), IdealNs, NULL),
+      MpBenchStatsMean (&Spread)
+      ));
+  }
+
+  DEBUG ((DEBUG_INFO, "Completion above the slowest Ap is broadcast overhead, the rest above ideal is imbalance.\n\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,286 @@
+/** @file
+  Per AP payload size scaling of BroadcastProcedure.
+
+  BroadcastProcedure passes one argument to every AP. Here the argument is
+  a MM_MP_TEST_ARGUMENT_TABLE and every AP copies the input of its own entry
+  to its own output, for payloads from 64 bytes to megabytes. The input is
+  laid out three ways:
+
+  - shared: every AP reads the same read-only buffer.
+  - copies: the BSP copies the payload to a buffer per AP before the
+    broadcast, inside the timed region, as a caller handing out private
+    arguments would.
+  - slices: every AP reads its own slice of one buffer filled beforehand.
+
+  Outputs are always per AP slices, cleared before and checked after every
+  sample outside the timed region. The bandwidth is the payload delivered
+  to the APs, active APs times the size, over the completion time.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_PAYLOAD_SAMPLES      MM_MP_TEST_SAMPLES (4)
+
+typedef enum {
+  PayloadShared,
+  PayloadCopies,
+  PayloadSlices,
+  PayloadModeMax
+} MM_MP_TEST_PAYLOAD_MODE;
+
+STATIC CONST CHAR8  *mPayloadModeName[PayloadModeMax] = {
+  "shared",
+  "copies",
+  "slices"
+};
+
+STATIC CONST UINTN  mPayloadSize[] = {
+  64,
+  512,
+  SIZE_4KB,
+  SIZE_32KB,
+  SIZE_256KB,
+  SIZE_2MB
+};
+
+//
+// Entry of the argument table. Size 0 leaves the AP idle.
+//
+typedef struct {
+  CONST UINT8                    *Input;
+  UINT8                          *Output;
+  UINTN                          Size;
+} MM_MP_TEST_PAYLOAD_ENTRY;
+
+/**
+  Broadcast procedure copying the input of its own table entry to its
+  output.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_ARGUMENT_TABLE.
+
+  @retval EFI_SUCCESS     The payload was copied.
+  @retval EFI_NOT_FOUND   WhoAmI failed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+PayloadProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_PAYLOAD_ENTRY       *Entry;
+
+  Entry = MmMpTestArgumentSelf ((MM_MP_TEST_ARGUMENT_TABLE *) ProcedureArgument);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Entry->Size != 0) {
+    CopyMem (Entry->Output, Entry->Input, Entry->Size);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Point the table entries of the active APs at their input and output, and
+  leave the other entries idle.
+
+  @param[in]  Context   The MM MP test context.
+  @param[in]  Table     The argument table.
+  @param[in]  Buffer    The payload buffer: the source payload, then the
+                        input slices, then the output slices.
+  @param[in]  Mode      The input layout.
+  @param[in]  Size      Payload size per AP.
+  @param[in]  Active    Number of active APs.
+**/
+STATIC
+VOID
+PayloadSetup (
+  IN MM_MP_TEST_CONTEXT             *Context,
+  IN MM_MP_TEST_ARGUMENT_TABLE      *Table,
+  IN UINT8                          *Buffer,
+  IN MM_MP_TEST_PAYLOAD_MODE        Mode,
+  IN UINTN                          Size,
+  IN UINTN                          Active
+  )
+{
+  MM_MP_TEST_PAYLOAD_ENTRY       *Entry;
+  UINT8                          *Inputs;
+  UINT8                          *Outputs;
+  UINTN                          Index;
+  UINTN                          Slot;
+
+  Inputs  = Buffer + Size;
+  Outputs = Inputs + Active * Size;
+
+  Slot = 0;
+  for (Index = 0; Index < Context->ProcessorNum; Index++) {
+    Entry       = MmMpTestArgumentOf (Table, Index);
+    Entry->Size = 0;
+    if (Index == Context->BspIndex || Slot == Active) {
+      continue;
+    }
+    Entry->Input  = (Mode == PayloadShared) ? Buffer : Inputs + Slot * Size;
+    Entry->Output = Outputs + Slot * Size;
+    Entry->Size   = Size;
+    Slot++;
+  }
+}
+
+/**
+  Broadcast a copy of a per AP payload from 64 bytes to megabytes, read from
+  one shared buffer, from per AP copies and from per AP slices of one buffer,
+  and report completion time and bandwidth.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    No SMRAM for the payload buffer or the
+                                  results.
+  @retval Others                  A broadcast failed.
+**/
+EFI_STATUS
+SmmMpPayloadBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_ARGUMENT_TABLE      Table;
+  MM_MP_TEST_PAYLOAD_MODE        Mode;
+  MM_MP_TEST_RESULT              Result;
+  MP_BENCH_STATS                 Completion;
+  EFI_STATUS                     *CpuStatus;
+  UINT8                          *Buffer;
+  UINTN                          BufferSize;
+  UINT8                          *Inputs;
+  UINT8                          *Outputs;
+  UINT64                         Start;
+  UINT64                         MeanNs;
+  UINTN                          ApCount;
+  UINTN                          Active;
+  UINTN                          Size;
+  UINTN                          SizeIndex;
+  UINTN                          Sample;
+  UINTN                          Slot;
+  UINTN                          Index;
+  UINTN                          Mismatch;
+
+  if (Context->ProcessorNum < 2) {
+    return EFI_SUCCESS;
+  }
+  ApCount = Context->ProcessorNum - 1;
+
+  Status = MmMpTestArgumentTableCreate (&Table, Context->SmmCpu, Context->ProcessorNum, sizeof (MM_MP_TEST_PAYLOAD_ENTRY));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = MmMpTestResultInitialize (&Result, Context->SmmCpu, Context->ProcessorNum, Context->BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  CpuStatus = MmMpTestArenaAllocate (Context->ProcessorNum * sizeof (EFI_STATUS));
+  if (CpuStatus == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // The buffer holds the source payload, then the input slices, then the
+  // output slices. It is allocated for this SMI only.
+  //
+  BufferSize = ALIGN_VALUE (FixedPcdGet32 (PcdMmMpTestPayloadBufferSize), EFI_PAGE_SIZE);
+  Buffer     = AllocatePages (EFI_SIZE_TO_PAGES (BufferSize));
+  if (Buffer == NULL) {
+    DEBUG ((DEBUG_ERROR, "Payload: no SMRAM for a 0x%x byte payload buffer!\n", BufferSize));
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = 0; Index < BufferSize; Index++) {
+    Buffer[Index] = (UINT8) (Index * 7 + 1);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "BroadcastProcedure payload scaling, 0x%x Aps, payload buffer 0x%x bytes, %d samples\n",
+    ApCount,
+    BufferSize,
+    MM_MP_TEST_PAYLOAD_SAMPLES
+    ));
+
+  for (SizeIndex = 0; SizeIndex < ARRAY_SIZE (mPayloadSize); SizeIndex++) {
+    Size = mPayloadSize[SizeIndex];
+
+    //
+    // The source, then one input and one output slice per active AP. Large
+    // payloads run on fewer APs so the buffer holds them.
+    //
+    Active = BufferSize / Size;
+    Active = (Active < 3) ? 0 : MIN (ApCount, (Active - 1) / 2);
+    if (Active == 0) {
+      DEBUG ((DEBUG_INFO, "  0x%x bytes per Ap: skipped, the payload buffer is too small\n", Size));
+      continue;
+    }
+    Inputs  = Buffer + Size;
+    Outputs = Inputs + Active * Size;
+    for (Slot = 0; Slot < Active; Slot++) {
+      CopyMem (Inputs + Slot * Size, Buffer, Size);
+    }
+
+    DEBUG ((DEBUG_INFO, "  0x%x bytes per Ap, %d Aps\n", Size, Active));
+
+    for (Mode = 0; Mode < PayloadModeMax; Mode++) {
+      PayloadSetup (Context, &Table, Buffer, Mode, Size, Active);
+      MpBenchStatsReset (&Completion);
+      Mismatch = 0;
+
+      for (Sample = 0; Sample < MM_MP_TEST_PAYLOAD_SAMPLES; Sample++) {
+        ZeroMem (Outputs, Active * Size);
+        SetMem (CpuStatus, Context->ProcessorNum * sizeof (EFI_STATUS), 0xFF);
+
+        Start = GetPerformanceCounter ();
+        if (Mode == PayloadCopies) {
+          for (Slot = 0; Slot < Active; Slot++) {
+            CopyMem (Inputs + Slot * Size, Buffer, Size);
+          }
+        }
+        Status = Context->SmmMp->BroadcastProcedure (Context->SmmMp, PayloadProcedure, 0, &Table, NULL, CpuStatus);
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_ERROR, "Payload %a 0x%x: BroadcastProcedure failed, %r!\n", mPayloadModeName[Mode], Size, Status));
+          goto Exit;
+        }
+        MpBenchStatsAdd (&Completion, MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+
+        MmMpTestResultCheck (&Result, CpuStatus, EFI_SUCCESS, FALSE);
+        for (Slot = 0; Slot < Active; Slot++) {
+          if (CompareMem (Outputs + Slot * Size, Buffer, Size) != 0) {
+            Mismatch++;
+          }
+        }
+      }
+
+      MeanNs = MAX (MpBenchStatsMean (&Completion), 1);
+      DEBUG ((
+        DEBUG_INFO,
+        "    %-7a completion mean %ld ns p99 %ld ns, %ld MB/s%a\n",
+        mPayloadModeName[Mode],
+        MeanNs,
+        MpBenchStatsPercentile (&Completion, 99),
+        DivU64x64Remainder (MultU64x32 ((UINT64) Active * Size, 1000), MeanNs, NULL),
+        (Mismatch != 0) ? ", OUTPUT MISMATCH" : ""
+        ));
+      if (Mismatch != 0) {
+        DEBUG ((DEBUG_ERROR, "Payload %a 0x%x: 0x%x Ap outputs were wrong over all samples!\n", mPayloadModeName[Mode], Size, Mismatch));
+      }
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "Copies include the Bsp copying the payload out, shared and slices only the broadcast.\n"));
+  MmMpTestResultPrint (&Result, "Payload procedure return status");
+  DEBUG ((DEBUG_INFO, "\n"));
+
+Exit:
+  FreePages (Buffer, EFI_SIZE_TO_PAGES (BufferSize));
+  return Status;
+}
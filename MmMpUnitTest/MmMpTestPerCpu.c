@@ -0,0 +1,269 @@
+/** @file
+  Constant time processor index of the MM MP tests, and its cost against
+  WhoAmI of the SMM CPU service.
+
+  The MpPerCpuLib table is built in SMRAM the first time a test context is
+  set up and kept across SMIs. Procedures find their own index with
+  MmMpTestWhoAmI, which falls back to WhoAmI before that.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Calls per CPU timed for each lookup.
+//
+#define MM_MP_TEST_PER_CPU_CALLS        256
+
+//
+// What each CPU measures in its own data area.
+//
+typedef struct {
+  UINT64                         WhoAmICycles;
+  UINT64                         IndexCycles;
+  UINTN                          WhoAmIIndex;
+  UINTN                          TableIndex;
+} MM_MP_TEST_PER_CPU_COST;
+
+STATIC MP_PER_CPU_TABLE  *mPerCpu;
+
+/**
+  Build the per CPU table from the APIC IDs of GetProcessorInfo, unless it
+  exists for the same number of processors.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The table is ready.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM.
+  @retval Others                  GetProcessorInfo failed.
+**/
+EFI_STATUS
+MmMpTestPerCpuInitialize (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_PROCESSOR_INFORMATION      Info;
+  MP_PER_CPU_TABLE               *Table;
+  UINTN                          Index;
+  UINTN                          Size;
+  UINT32                         MaxApicId;
+
+  if (mPerCpu != NULL && mPerCpu->CpuCount == Context->ProcessorNum) {
+    return EFI_SUCCESS;
+  }
+
+  MaxApicId = 0;
+  for (Index = 0; Index < Context->ProcessorNum; Index++) {
+    Status = Context->SmmCpu->GetProcessorInfo (Context->SmmCpu, Index, &Info);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    MaxApicId = MAX (MaxApicId, (UINT32) Info.ProcessorId);
+  }
+
+  Size  = MpPerCpuTableSize (MaxApicId, Context->ProcessorNum, sizeof (MM_MP_TEST_PER_CPU_COST));
+  Table = (Size == 0) ? NULL : AllocatePool (Size);
+  if (Table == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Table = MpPerCpuTableInitialize (Table, Size, MaxApicId, Context->ProcessorNum, sizeof (MM_MP_TEST_PER_CPU_COST));
+  ASSERT (Table != NULL);
+
+  for (Index = 0; Index < Context->ProcessorNum; Index++) {
+    Status = Context->SmmCpu->GetProcessorInfo (Context->SmmCpu, Index, &Info);
+    if (!EFI_ERROR (Status)) {
+      MpPerCpuTableAdd (Table, Index, (UINT32) Info.ProcessorId);
+    }
+  }
+
+  if (mPerCpu != NULL) {
+    FreePool (mPerCpu);
+  }
+  mPerCpu = Table;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the index of the calling CPU, from the per CPU table once built,
+  from WhoAmI before. Callable on any CPU.
+
+  @param[in]  SmmCpu     The SMM CPU service protocol.
+  @param[out] CpuIndex   The index.
+
+  @retval EFI_SUCCESS   CpuIndex is valid.
+  @retval Others        WhoAmI failed.
+**/
+EFI_STATUS
+MmMpTestWhoAmI (
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  OUT UINTN                         *CpuIndex
+  )
+{
+  if (mPerCpu != NULL) {
+    *CpuIndex = MpPerCpuIndex (mPerCpu);
+    if (*CpuIndex != MP_PER_CPU_INVALID_INDEX) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  return SmmCpu->WhoAmI (SmmCpu, CpuIndex);
+}
+
+/**
+  Time WhoAmI and the per CPU table on the calling CPU, into its own data
+  area.
+
+  @param[in]  ProcedureArgument   The SMM CPU service protocol.
+
+  @retval EFI_SUCCESS     Both lookups agree.
+  @retval EFI_NOT_FOUND   The CPU is not in the table, or the lookups
+                          disagree.
+  @retval Others          WhoAmI failed.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+PerCpuCostProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SMM_CPU_SERVICE_PROTOCOL   *SmmCpu;
+  MM_MP_TEST_PER_CPU_COST        *Cost;
+  UINTN                          Call;
+  UINTN                          WhoAmIIndex;
+  UINTN                          TableIndex;
+  UINT64                         Start;
+
+  SmmCpu = (EFI_SMM_CPU_SERVICE_PROTOCOL *)ProcedureArgument;
+  Cost   = MpPerCpuData (mPerCpu);
+  if (Cost == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = EFI_SUCCESS;
+  Start  = AsmReadTsc ();
+  for (Call = 0; Call < MM_MP_TEST_PER_CPU_CALLS && !EFI_ERROR (Status); Call++) {
+    Status = SmmCpu->WhoAmI (SmmCpu, &WhoAmIIndex);
+  }
+  Cost->WhoAmICycles = AsmReadTsc () - Start;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Start = AsmReadTsc ();
+  for (Call = 0; Call < MM_MP_TEST_PER_CPU_CALLS; Call++) {
+    TableIndex = MpPerCpuIndex (mPerCpu);
+  }
+  Cost->IndexCycles = AsmReadTsc () - Start;
+
+  Cost->WhoAmIIndex = WhoAmIIndex;
+  Cost->TableIndex  = TableIndex;
+  return (WhoAmIIndex == TableIndex) ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+/**
+  Measure the cost of WhoAmI and of the per CPU table on every CPU, and
+  check that both give the same index.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM or scratch arena.
+  @retval Others                  The table could not be built.
+**/
+EFI_STATUS
+SmmMpPerCpuBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_STATUS                     ProcedureStatus;
+  MM_MP_TEST_PER_CPU_COST        *Cost;
+  MM_MP_TEST_RESULT              Result;
+  MP_BENCH_STATS                 WhoAmI;
+  MP_BENCH_STATS                 Index;
+  UINTN                          Cpu;
+
+  Status = MmMpTestPerCpuInitialize (Context);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Per Cpu table: not built, %r!\n", Status));
+    return Status;
+  }
+
+  Status = MmMpTestResultInitialize (&Result, Context->SmmCpu, Context->ProcessorNum, Context->BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  ZeroMem (mPerCpu->Data, mPerCpu->CpuCount * mPerCpu->DataSize);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Per Cpu index against WhoAmI, %d calls per Cpu, %a, APIC IDs up to 0x%x\n",
+    MM_MP_TEST_PER_CPU_CALLS,
+    mPerCpu->X2Apic ? "x2APIC" : "xAPIC",
+    mPerCpu->MaxApicId
+    ));
+
+  //
+  // The BSP measures itself, the APs one at a time so they do not contend.
+  //
+  Status = PerCpuCostProcedure (Context->SmmCpu);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Per Cpu table: Bsp 0x%x lookup %r!\n", Context->BspIndex, Status));
+  }
+  for (Cpu = 0; Cpu < Context->ProcessorNum; Cpu++) {
+    if (Cpu == Context->BspIndex) {
+      continue;
+    }
+    ProcedureStatus = EFI_NOT_STARTED;
+    Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, PerCpuCostProcedure, Cpu, 0, Context->SmmCpu, NULL, &ProcedureStatus);
+    if (EFI_ERROR (Status) || EFI_ERROR (ProcedureStatus)) {
+      MmMpTestResultFail (&Result, Cpu, EFI_ERROR (Status) ? Status : ProcedureStatus);
+    }
+  }
+
+  MpBenchStatsReset (&WhoAmI);
+  MpBenchStatsReset (&Index);
+  for (Cpu = 0; Cpu < Context->ProcessorNum; Cpu++) {
+    Cost = MpPerCpuDataOf (mPerCpu, Cpu);
+    if (Cost->IndexCycles == 0 || Cost->WhoAmIIndex != Cost->TableIndex) {
+      continue;
+    }
+    MpBenchStatsAdd (&WhoAmI, DivU64x32 (Cost->WhoAmICycles, MM_MP_TEST_PER_CPU_CALLS));
+    MpBenchStatsAdd (&Index, DivU64x32 (Cost->IndexCycles, MM_MP_TEST_PER_CPU_CALLS));
+    DEBUG ((
+      MM_MP_TEST_DETAIL_LEVEL (Context->ProcessorNum),
+      "  Cpu 0x%x: WhoAmI %ld cycles, per Cpu index %ld cycles\n",
+      Cpu,
+      DivU64x32 (Cost->WhoAmICycles, MM_MP_TEST_PER_CPU_CALLS),
+      DivU64x32 (Cost->IndexCycles, MM_MP_TEST_PER_CPU_CALLS)
+      ));
+  }
+
+  MpBenchStatsPrint (DEBUG_INFO, "WhoAmI", "cycles", &WhoAmI);
+  MpBenchStatsPrint (DEBUG_INFO, "per Cpu index", "cycles", &Index);
+
+  //
+  // WhoAmI searches the processor list, its cost on the last processor is
+  // the one that grows with the processor count.
+  //
+  Cost = MpPerCpuDataOf (mPerCpu, Context->ProcessorNum - 1);
+  if (Cost->IndexCycles != 0) {
+    DEBUG ((
+      DEBUG_INFO,
+      "Cpu 0x%x: WhoAmI %ld cycles against %ld cycles on Cpu 0x0\n",
+      Context->ProcessorNum - 1,
+      DivU64x32 (Cost->WhoAmICycles, MM_MP_TEST_PER_CPU_CALLS),
+      DivU64x32 (((MM_MP_TEST_PER_CPU_COST *) MpPerCpuDataOf (mPerCpu, 0))->WhoAmICycles, MM_MP_TEST_PER_CPU_CALLS)
+      ));
+  }
+  MmMpTestResultPrint (&Result, "Per Cpu index");
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,305 @@
+/** @file
+  Core to core cache line ping-pong latency in SMM.
+
+  For every pair of CPUs, one CPU (ping) and the other (pong) bounce a counter
+  in a shared cache line back and forth. Ping reads the TSC around the timed
+  rounds, so each matrix entry is the TSC cycles of one round trip of the
+  line between the two cores, i.e. two coherency transfers.
+
+  The pair is started with DispatchProcedure in non-blocking mode. When the
+  BSP is part of the pair it plays ping itself.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// The matrix covers the first MM_MP_TEST_PINGPONG_MAX_CPUS processors only,
+// it grows quadratically in run time and in output.
+//
+#define MM_MP_TEST_PINGPONG_MAX_CPUS    32
+#define MM_MP_TEST_PINGPONG_WARMUP      64
+#define MM_MP_TEST_PINGPONG_ROUNDS      FixedPcdGet32 (PcdMmMpTestPingPongRounds)
+
+//
+// Polls of the other side, at the start barrier and per hop, before a side
+// gives up on it. Far beyond any coherency transfer, it only catches a side
+// that stopped running.
+//
+#define MM_MP_TEST_PINGPONG_SPINS       0x4000000
+
+//
+// Time used to relate the TSC to the performance counter.
+//
+#define MM_MP_TEST_PINGPONG_CALIBRATE_US  1000
+
+//
+// State shared by both sides of a pair. Ball sits alone in its own cache
+// line, everything else is on other lines and only touched outside the
+// timed loop.
+//
+typedef struct {
+  volatile UINT32                Ball;
+} MM_MP_TEST_PINGPONG_LINE;
+
+typedef struct {
+  volatile UINT32                Ready;
+  volatile BOOLEAN               Abort;
+} MM_MP_TEST_PINGPONG_START;
+
+typedef struct {
+  MM_MP_TEST_PINGPONG_LINE       *Line;
+  MM_MP_TEST_PINGPONG_START      *Start;
+  BOOLEAN                        Ping;
+  UINT64                         Ticks;
+} MM_MP_TEST_PINGPONG_SIDE;
+
+/**
+  One side of the ping-pong loop.
+
+  Both sides meet at a barrier first, so the timed rounds only start when
+  both CPUs are in the loop. The barrier is left early if the BSP could not
+  start the other side.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_PINGPONG_SIDE of this CPU.
+
+  @retval EFI_SUCCESS   The rounds ran.
+  @retval EFI_ABORTED   The other side never started.
+  @retval EFI_TIMEOUT   The other side did not arrive at the barrier, or
+                        did not return the ball.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+PingPongProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_PINGPONG_SIDE       *Side;
+  volatile UINT32                *Ball;
+  UINT32                         Round;
+  UINTN                          Spin;
+  UINT64                         Start;
+
+  Side = (MM_MP_TEST_PINGPONG_SIDE *)ProcedureArgument;
+  Ball = &Side->Line->Ball;
+
+  InterlockedIncrement (&Side->Start->Ready);
+  for (Spin = 0; Side->Start->Ready < 2; Spin++) {
+    if (Side->Start->Abort) {
+      return EFI_ABORTED;
+    }
+    if (Spin == MM_MP_TEST_PINGPONG_SPINS) {
+      return EFI_TIMEOUT;
+    }
+    CpuPause ();
+  }
+
+  //
+  // No CpuPause in the rounds, it would add its own latency to every hop.
+  // The spin count is only a register increment next to the load.
+  //
+  Start = 0;
+  for (Round = 0; Round < MM_MP_TEST_PINGPONG_WARMUP + MM_MP_TEST_PINGPONG_ROUNDS; Round++) {
+    if (Side->Ping) {
+      if (Round == MM_MP_TEST_PINGPONG_WARMUP) {
+        Start = AsmReadTsc ();
+      }
+      *Ball = 2 * Round + 1;
+      for (Spin = 0; *Ball != 2 * Round + 2; Spin++) {
+        if (Spin == MM_MP_TEST_PINGPONG_SPINS) {
+          return EFI_TIMEOUT;
+        }
+      }
+    } else {
+      for (Spin = 0; *Ball != 2 * Round + 1; Spin++) {
+        if (Spin == MM_MP_TEST_PINGPONG_SPINS) {
+          return EFI_TIMEOUT;
+        }
+      }
+      *Ball = 2 * Round + 2;
+    }
+  }
+
+  if (Side->Ping) {
+    Side->Ticks = AsmReadTsc () - Start;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Run the ping-pong loop between two CPUs.
+
+  @param[in]  Context   The MM MP test context.
+  @param[in]  PingCpu   CPU timing the rounds, may be the BSP.
+  @param[in]  PongCpu   The other CPU, must be an AP.
+  @param[out] Ticks     TSC cycles per round trip.
+
+  @retval EFI_SUCCESS   The pair was measured.
+  @retval EFI_TIMEOUT   A side gave up waiting for the other.
+  @retval Others        A dispatch failed.
+**/
+STATIC
+EFI_STATUS
+SmmMpPingPongPair (
+  IN  MM_MP_TEST_CONTEXT            *Context,
+  IN  UINTN                         PingCpu,
+  IN  UINTN                         PongCpu,
+  OUT UINT64                        *Ticks
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_PINGPONG_LINE       *Line;
+  MM_MP_TEST_PINGPONG_START      *Start;
+  MM_MP_TEST_PINGPONG_SIDE       *Ping;
+  MM_MP_TEST_PINGPONG_SIDE       *Pong;
+  MM_COMPLETION                  PingToken;
+  MM_COMPLETION                  PongToken;
+  EFI_STATUS                     PingStatus;
+  EFI_STATUS                     PongStatus;
+
+  //
+  // Every arena block starts on its own cache line.
+  //
+  Line  = MmMpTestArenaAllocateZero (sizeof (MM_MP_TEST_PINGPONG_LINE));
+  Start = MmMpTestArenaAllocateZero (sizeof (MM_MP_TEST_PINGPONG_START));
+  Ping  = MmMpTestArenaAllocateZero (sizeof (MM_MP_TEST_PINGPONG_SIDE));
+  Pong  = MmMpTestArenaAllocateZero (sizeof (MM_MP_TEST_PINGPONG_SIDE));
+  if (Line == NULL || Start == NULL || Ping == NULL || Pong == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Ping->Line  = Line;
+  Ping->Start = Start;
+  Ping->Ping  = TRUE;
+  Pong->Line  = Line;
+  Pong->Start = Start;
+  Pong->Ping  = FALSE;
+
+  Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, PingPongProcedure, PongCpu, 0, Pong, &PongToken, &PongStatus);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (PingCpu == Context->BspIndex) {
+    Status = PingPongProcedure (Ping);
+  } else {
+    Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, PingPongProcedure, PingCpu, 0, Ping, &PingToken, &PingStatus);
+    if (!EFI_ERROR (Status)) {
+      Context->SmmMp->WaitForProcedure (Context->SmmMp, PingToken);
+      Status = PingStatus;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    Start->Abort = TRUE;
+  }
+  Context->SmmMp->WaitForProcedure (Context->SmmMp, PongToken);
+  if (!EFI_ERROR (Status)) {
+    Status = PongStatus;
+  }
+
+  *Ticks = DivU64x32 (Ping->Ticks, MM_MP_TEST_PINGPONG_ROUNDS);
+  return Status;
+}
+
+/**
+  Measure the cache line round trip between every pair of the first
+  MM_MP_TEST_PINGPONG_MAX_CPUS processors and print the matrix.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The matrix was printed.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A dispatch failed.
+**/
+EFI_STATUS
+SmmMpPingPongBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  UINT64                         *Matrix;
+  UINTN                          CpuCount;
+  UINTN                          Row;
+  UINTN                          Column;
+  UINTN                          Length;
+  UINT64                         TscStart;
+  UINT64                         CounterStart;
+  UINT64                         TscMhz;
+  CHAR8                          Line[16 + 6 * MM_MP_TEST_PINGPONG_MAX_CPUS];
+
+  CpuCount = MIN (Context->ProcessorNum, MM_MP_TEST_PINGPONG_MAX_CPUS);
+  if (CpuCount < 2) {
+    return EFI_SUCCESS;
+  }
+
+  Matrix = MmMpTestArenaAllocateZero (sizeof (UINT64) * CpuCount * CpuCount);
+  if (Matrix == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // The matrix is in TSC cycles, give the TSC rate so it can be converted.
+  //
+  TscStart     = AsmReadTsc ();
+  CounterStart = GetPerformanceCounter ();
+  Sleep (MM_MP_TEST_PINGPONG_CALIBRATE_US);
+  TscMhz = DivU64x64Remainder (
+             MultU64x32 (AsmReadTsc () - TscStart, 1000),
+             MAX (MpBenchElapsedNs (CounterStart, GetPerformanceCounter ()), 1),
+             NULL
+             );
+
+  //
+  // The loop is symmetric, each pair is measured once and mirrored.
+  //
+  for (Row = 0; Row < CpuCount; Row++) {
+    for (Column = Row + 1; Column < CpuCount; Column++) {
+      if (Column == Context->BspIndex) {
+        Status = SmmMpPingPongPair (Context, Column, Row, &Matrix[Row * CpuCount + Column]);
+      } else {
+        Status = SmmMpPingPongPair (Context, Row, Column, &Matrix[Row * CpuCount + Column]);
+      }
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Ping-pong Cpu 0x%x <-> Cpu 0x%x failed, %r!\n", Row, Column, Status));
+        return Status;
+      }
+      Matrix[Column * CpuCount + Row] = Matrix[Row * CpuCount + Column];
+    }
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Cache line ping-pong round trip in TSC cycles, %d of %d Cpus, %d rounds, TSC %ld MHz, Bsp 0x%x\n",
+    CpuCount,
+    Context->ProcessorNum,
+    MM_MP_TEST_PINGPONG_ROUNDS,
+    TscMhz,
+    Context->BspIndex
+    ));
+
+  Length = AsciiSPrint (Line, sizeof (Line), "    ");
+  for (Column = 0; Column < CpuCount; Column++) {
+    Length += AsciiSPrint (Line + Length, sizeof (Line) - Length, " %5d", Column);
+  }
+  DEBUG ((DEBUG_INFO, "%a\n", Line));
+
+  for (Row = 0; Row < CpuCount; Row++) {
+    Length = AsciiSPrint (Line, sizeof (Line), "%4d", Row);
+    for (Column = 0; Column < CpuCount; Column++) {
+      if (Column == Row) {
+        Length += AsciiSPrint (Line + Length, sizeof (Line) - Length, "     -");
+      } else {
+        Length += AsciiSPrint (Line + Length, sizeof (Line) - Length, " %5ld", Matrix[Row * CpuCount + Column]);
+      }
+    }
+    DEBUG ((DEBUG_INFO, "%a\n", Line));
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,268 @@
+/** @file
+  Per CPU result bitmaps of the MM MP tests and their summary.
+
+  On a large system one DEBUG line per AP keeps the BSP printing for minutes
+  inside a single SMI. Tests record which CPU failed how in bitmaps instead,
+  and the report prints one line per distinct failure with the CPUs as
+  ranges: "EFI_TIMEOUT on 0x42 Aps: 0x80-0xbf, 0x101".
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_RESULT_WORD_BITS     32
+
+//
+// One range is at most " 0x12345-0x12345,", the rest is the prefix.
+//
+#define MM_MP_TEST_RESULT_LINE_SIZE     (96 + 18 * MM_MP_TEST_RESULT_RANGES)
+
+/**
+  Return whether a CPU is set in a bitmap.
+
+  @param[in]  Bitmap     The bitmap.
+  @param[in]  CpuIndex   The CPU.
+
+  @return TRUE if set.
+**/
+STATIC
+BOOLEAN
+ResultTest (
+  IN CONST volatile UINT32  *Bitmap,
+  IN UINTN                  CpuIndex
+  )
+{
+  return (BOOLEAN) ((Bitmap[CpuIndex / MM_MP_TEST_RESULT_WORD_BITS] & (1u << (CpuIndex % MM_MP_TEST_RESULT_WORD_BITS))) != 0);
+}
+
+/**
+  Set up an empty result in the scratch arena.
+
+  @param[out] Result     The result.
+  @param[in]  SmmCpu     The SMM CPU service protocol, for WhoAmI.
+  @param[in]  CpuCount   Number of processors.
+  @param[in]  BspIndex   The BSP, which is not counted.
+
+  @retval EFI_SUCCESS             The result is empty.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+**/
+EFI_STATUS
+MmMpTestResultInitialize (
+  OUT MM_MP_TEST_RESULT             *Result,
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  IN  UINTN                         CpuCount,
+  IN  UINTN                         BspIndex
+  )
+{
+  ZeroMem (Result, sizeof (MM_MP_TEST_RESULT));
+  Result->SmmCpu   = SmmCpu;
+  Result->CpuCount = CpuCount;
+  Result->BspIndex = BspIndex;
+
+  //
+  // Ran is written by every AP at once, it gets cache lines of its own.
+  //
+  Result->Ran    = MmMpTestArenaAllocateZero ((CpuCount + MM_MP_TEST_RESULT_WORD_BITS - 1) / MM_MP_TEST_RESULT_WORD_BITS * sizeof (UINT32));
+  Result->Failed = MmMpTestArenaAllocateZero ((CpuCount + MM_MP_TEST_RESULT_WORD_BITS - 1) / MM_MP_TEST_RESULT_WORD_BITS * sizeof (UINT32));
+  if (Result->Ran == NULL || Result->Failed == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Mark the calling CPU in the Ran bitmap. Called by procedures, on any CPU.
+
+  @param[in]  Result   The result, may be NULL.
+**/
+VOID
+MmMpTestResultMarkRan (
+  IN MM_MP_TEST_RESULT              *Result
+  )
+{
+  UINTN                          CpuIndex;
+  volatile UINT32                *Word;
+  UINT32                         Bit;
+  UINT32                         Old;
+
+  if (Result == NULL || Result->Ran == NULL || EFI_ERROR (MmMpTestWhoAmI (Result->SmmCpu, &CpuIndex))) {
+    return;
+  }
+  if (CpuIndex >= Result->CpuCount) {
+    return;
+  }
+
+  Word = &Result->Ran[CpuIndex / MM_MP_TEST_RESULT_WORD_BITS];
+  Bit  = 1u << (CpuIndex % MM_MP_TEST_RESULT_WORD_BITS);
+  do {
+    Old = *Word;
+  } while (InterlockedCompareExchange32 ((UINT32 *) Word, Old, Old | Bit) != Old);
+}
+
+/**
+  Record a failure of one CPU.
+
+  @param[in, out] Result     The result.
+  @param[in]      CpuIndex   The CPU.
+  @param[in]      Status     What the CPU returned, used as the failure kind.
+**/
+VOID
+MmMpTestResultFail (
+  IN OUT MM_MP_TEST_RESULT          *Result,
+  IN     UINTN                      CpuIndex,
+  IN     EFI_STATUS                 Status
+  )
+{
+  UINTN                          Kind;
+  UINTN                          Word;
+  UINT32                         Bit;
+
+  if (CpuIndex >= Result->CpuCount || ResultTest (Result->Failed, CpuIndex)) {
+    return;
+  }
+
+  Word = CpuIndex / MM_MP_TEST_RESULT_WORD_BITS;
+  Bit  = 1u << (CpuIndex % MM_MP_TEST_RESULT_WORD_BITS);
+  Result->Failed[Word] |= Bit;
+  Result->FailedCount++;
+
+  for (Kind = 0; Kind < Result->KindCount; Kind++) {
+    if (Result->KindStatus[Kind] == Status) {
+      break;
+    }
+  }
+
+  if (Kind == Result->KindCount) {
+    if (Kind == MM_MP_TEST_RESULT_KINDS) {
+      Result->Untracked++;
+      return;
+    }
+    Result->KindCpus[Kind] = MmMpTestArenaAllocateZero ((Result->CpuCount + MM_MP_TEST_RESULT_WORD_BITS - 1) / MM_MP_TEST_RESULT_WORD_BITS * sizeof (UINT32));
+    if (Result->KindCpus[Kind] == NULL) {
+      Result->Untracked++;
+      return;
+    }
+    Result->KindStatus[Kind] = Status;
+    Result->KindCount++;
+  }
+
+  Result->KindCpus[Kind][Word] |= Bit;
+  Result->KindTotal[Kind]++;
+}
+
+/**
+  Record every AP whose status differs from Expected, and with CheckRan
+  every AP missing from the Ran bitmap.
+
+  @param[in, out] Result        The result.
+  @param[in]      StatusArray   Per CPU status, may be NULL.
+  @param[in]      Expected      The expected status.
+  @param[in]      CheckRan      Whether the procedure marked Ran.
+**/
+VOID
+MmMpTestResultCheck (
+  IN OUT MM_MP_TEST_RESULT          *Result,
+  IN     CONST EFI_STATUS           *StatusArray,
+  IN     EFI_STATUS                 Expected,
+  IN     BOOLEAN                    CheckRan
+  )
+{
+  UINTN                          Index;
+
+  for (Index = 0; Index < Result->CpuCount; Index++) {
+    if (Index == Result->BspIndex) {
+      continue;
+    }
+    if (CheckRan && !ResultTest (Result->Ran, Index)) {
+      MmMpTestResultFail (Result, Index, MM_MP_TEST_RESULT_NOT_RUN);
+    } else if (StatusArray != NULL && StatusArray[Index] != Expected) {
+      MmMpTestResultFail (Result, Index, StatusArray[Index]);
+    }
+  }
+}
+
+/**
+  Print the CPUs of a bitmap as ranges, at most MM_MP_TEST_RESULT_RANGES.
+
+  @param[in]  Prefix     Start of the line.
+  @param[in]  Bitmap     The bitmap.
+  @param[in]  CpuCount   Number of processors.
+**/
+STATIC
+VOID
+ResultPrintRanges (
+  IN CONST CHAR8                    *Prefix,
+  IN CONST UINT32                   *Bitmap,
+  IN UINTN                          CpuCount
+  )
+{
+  CHAR8                          Line[MM_MP_TEST_RESULT_LINE_SIZE];
+  UINTN                          Length;
+  UINTN                          Ranges;
+  UINTN                          First;
+  UINTN                          Last;
+
+  Length = AsciiSPrint (Line, sizeof (Line), "%a:", Prefix);
+  Ranges = 0;
+  for (First = 0; First < CpuCount; First = Last + 1) {
+    if (!ResultTest (Bitmap, First)) {
+      Last = First;
+      continue;
+    }
+    for (Last = First; Last + 1 < CpuCount && ResultTest (Bitmap, Last + 1); Last++) {
+    }
+
+    Ranges++;
+    if (Ranges > MM_MP_TEST_RESULT_RANGES) {
+      continue;
+    }
+    if (First == Last) {
+      Length += AsciiSPrint (Line + Length, sizeof (Line) - Length, " 0x%x,", First);
+    } else {
+      Length += AsciiSPrint (Line + Length, sizeof (Line) - Length, " 0x%x-0x%x,", First, Last);
+    }
+  }
+
+  Line[Length - 1] = '\0';
+  if (Ranges > MM_MP_TEST_RESULT_RANGES) {
+    DEBUG ((DEBUG_ERROR, "%a and %d more ranges\n", Line, Ranges - MM_MP_TEST_RESULT_RANGES));
+  } else {
+    DEBUG ((DEBUG_ERROR, "%a\n", Line));
+  }
+}
+
+/**
+  Print a pass count and one line per failure kind with its CPU ranges.
+
+  @param[in]  Result   The result.
+  @param[in]  Label    Prefix of the lines.
+**/
+VOID
+MmMpTestResultPrint (
+  IN CONST MM_MP_TEST_RESULT        *Result,
+  IN CONST CHAR8                    *Label
+  )
+{
+  UINTN                          ApCount;
+  UINTN                          Kind;
+  CHAR8                          Prefix[80];
+
+  ApCount = Result->CpuCount - 1;
+  if (Result->FailedCount == 0) {
+    DEBUG ((DEBUG_INFO, "%a pass on all 0x%x Aps\n", Label, ApCount));
+    return;
+  }
+
+  DEBUG ((DEBUG_ERROR, "%a failed on 0x%x of 0x%x Aps\n", Label, Result->FailedCount, ApCount));
+  for (Kind = 0; Kind < Result->KindCount; Kind++) {
+    AsciiSPrint (Prefix, sizeof (Prefix), "  %r on 0x%x Aps", Result->KindStatus[Kind], Result->KindTotal[Kind]);
+    ResultPrintRanges (Prefix, Result->KindCpus[Kind], Result->CpuCount);
+  }
+  if (Result->Untracked != 0) {
+    DEBUG ((DEBUG_ERROR, "  0x%x Aps failed with statuses beyond the first %d\n", Result->Untracked, MM_MP_TEST_RESULT_KINDS));
+  }
+}
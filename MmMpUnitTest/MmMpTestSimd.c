@@ -0,0 +1,379 @@
+/** @file
+  Cost of SIMD code in SMM procedures, extended state save included.
+
+  SMM entry saves only the general purpose and control state of the
+  interrupted context. A procedure that uses XMM or YMM registers has to save
+  and restore the extended state itself: FXSAVE/FXRSTOR for SSE2, XSAVE/XRSTOR
+  of x87, SSE and AVX for AVX2. The same 64-bit sum kernel is run on the
+  selected AP with general purpose, SSE2 and AVX2 registers over growing
+  payloads, the vector paths with their save and restore inside the timed
+  region, to find the payload from which vectorizing is a net win.
+
+  XSAVE skips components in their initial state, so the save cost also
+  depends on what the interrupted context left in the registers.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Payloads from MM_MP_TEST_SIMD_MIN_PAYLOAD to MM_MP_TEST_SIMD_MAX_PAYLOAD
+// bytes, doubling.
+//
+#define MM_MP_TEST_SIMD_MIN_PAYLOAD     64
+#define MM_MP_TEST_SIMD_MAX_PAYLOAD     SIZE_128KB
+#define MM_MP_TEST_SIMD_SAMPLES         MM_MP_TEST_SAMPLES (1)
+#define MM_MP_TEST_SIMD_BLOCK_SIZE      64
+
+#define MM_MP_TEST_SIMD_FXSAVE_SIZE     512
+
+//
+// XCR0 components saved around the AVX2 kernel: x87, SSE and AVX.
+//
+#define MM_MP_TEST_SIMD_AVX_MASK        (BIT0 | BIT1 | BIT2)
+
+#if defined (MDE_CPU_X64)
+
+typedef enum {
+  MmMpTestSimdScalar,
+  MmMpTestSimdSse2,
+  MmMpTestSimdAvx2,
+  MmMpTestSimdPathMax
+} MM_MP_TEST_SIMD_PATH;
+
+STATIC CONST CHAR8  *mSimdPathName[MmMpTestSimdPathMax] = {
+  "scalar",
+  "sse2+fxsave",
+  "avx2+xsave"
+};
+
+typedef struct {
+  MM_MP_TEST_SIMD_PATH           Path;
+  CONST UINT64                   *Buffer;
+  UINTN                          BlockCount;
+  VOID                           *SaveArea;
+  UINT64                         SaveMask;
+  MP_BENCH_STATS                 Cycles;
+  UINT64                         Sum;
+} MM_MP_TEST_SIMD_JOB;
+
+//
+// X64/MmMpTestSimd.nasm
+//
+UINT64
+EFIAPI
+MmMpTestSumScalar (
+  IN CONST UINT64  *Buffer,
+  IN UINTN         BlockCount
+  );
+
+UINT64
+EFIAPI
+MmMpTestSumSse2 (
+  IN CONST UINT64  *Buffer,
+  IN UINTN         BlockCount
+  );
+
+UINT64
+EFIAPI
+MmMpTestSumAvx2 (
+  IN CONST UINT64  *Buffer,
+  IN UINTN         BlockCount
+  );
+
+VOID
+EFIAPI
+MmMpTestFxSave (
+  OUT VOID  *Area
+  );
+
+VOID
+EFIAPI
+MmMpTestFxRestore (
+  IN VOID  *Area
+  );
+
+VOID
+EFIAPI
+MmMpTestXSave (
+  OUT VOID    *Area,
+  IN  UINT64  Mask
+  );
+
+VOID
+EFIAPI
+MmMpTestXRestore (
+  IN VOID    *Area,
+  IN UINT64  Mask
+  );
+
+UINT64
+EFIAPI
+MmMpTestXGetBv (
+  IN UINT32  Index
+  );
+
+/**
+  Run one path of the kernel MM_MP_TEST_SIMD_SAMPLES times on this CPU.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_SIMD_JOB to run.
+
+  @return EFI_SUCCESS.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+SimdProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_SIMD_JOB            *Job;
+  UINTN                          Sample;
+  UINT64                         Start;
+  UINT64                         Sum;
+
+  Job = (MM_MP_TEST_SIMD_JOB *)ProcedureArgument;
+  MpBenchStatsReset (&Job->Cycles);
+  Sum = 0;
+
+  for (Sample = 0; Sample < MM_MP_TEST_SIMD_SAMPLES; Sample++) {
+    Start = AsmReadTsc ();
+    switch (Job->Path) {
+    case MmMpTestSimdSse2:
+      MmMpTestFxSave (Job->SaveArea);
+      Sum = MmMpTestSumSse2 (Job->Buffer, Job->BlockCount);
+      MmMpTestFxRestore (Job->SaveArea);
+      break;
+
+    case MmMpTestSimdAvx2:
+      MmMpTestXSave (Job->SaveArea, Job->SaveMask);
+      Sum = MmMpTestSumAvx2 (Job->Buffer, Job->BlockCount);
+      MmMpTestXRestore (Job->SaveArea, Job->SaveMask);
+      break;
+
+    default:
+      Sum = MmMpTestSumScalar (Job->Buffer, Job->BlockCount);
+      break;
+    }
+    MpBenchStatsAdd (&Job->Cycles, AsmReadTsc () - Start);
+  }
+
+  Job->Sum = Sum;
+  return EFI_SUCCESS;
+}
+
+/**
+  Find out which vector paths this CPU can run in SMM.
+
+  @param[out] Supported   Per MM_MP_TEST_SIMD_PATH, whether it can run.
+  @param[out] XSaveSize   Bytes XSAVE needs for the components enabled in XCR0.
+**/
+STATIC
+VOID
+SimdDetect (
+  OUT BOOLEAN  *Supported,
+  OUT UINT32   *XSaveSize
+  )
+{
+  UINT32                         Ecx;
+  UINT32                         Edx;
+  UINT32                         Ebx;
+  UINTN                          Cr4;
+
+  AsmCpuid (1, NULL, NULL, &Ecx, &Edx);
+  Cr4 = AsmReadCr4 ();
+
+  Supported[MmMpTestSimdScalar] = TRUE;
+  Supported[MmMpTestSimdSse2]   = (BOOLEAN) ((Edx & BIT26) != 0 && (Cr4 & BIT9) != 0);
+  Supported[MmMpTestSimdAvx2]   = FALSE;
+  *XSaveSize = 0;
+
+  //
+  // AVX2 needs XSAVE enabled by CR4.OSXSAVE in the SMM CR4, and the SSE and
+  // AVX components enabled in XCR0.
+  //
+  if ((Ecx & (BIT26 | BIT28)) != (BIT26 | BIT28) || (Cr4 & BIT18) == 0) {
+    return;
+  }
+  if ((MmMpTestXGetBv (0) & MM_MP_TEST_SIMD_AVX_MASK) != MM_MP_TEST_SIMD_AVX_MASK) {
+    return;
+  }
+  AsmCpuidEx (7, 0, NULL, &Ebx, NULL, NULL);
+  Supported[MmMpTestSimdAvx2] = (BOOLEAN) ((Ebx & BIT5) != 0);
+
+  AsmCpuidEx (0xD, 0, NULL, &Ebx, NULL, NULL);
+  *XSaveSize = Ebx;
+}
+
+/**
+  Return the kernel throughput in bytes per 1000 cycles.
+
+  @param[in]  Bytes    Payload size.
+  @param[in]  Cycles   Mean cycles of the kernel over the payload.
+
+  @return The throughput.
+**/
+STATIC
+UINT64
+SimdThroughput (
+  IN UINTN   Bytes,
+  IN UINT64  Cycles
+  )
+{
+  return DivU64x64Remainder (MultU64x32 (Bytes, 1000), MAX (Cycles, 1), NULL);
+}
+
+/**
+  Measure the scalar, SSE2 and AVX2 kernels with their extended state save
+  on the selected AP, and report the payload from which each vector path is
+  a net win.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A dispatch failed.
+**/
+EFI_STATUS
+SmmMpSimdBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  BOOLEAN                        Supported[MmMpTestSimdPathMax];
+  UINT32                         XSaveSize;
+  UINT64                         *Buffer;
+  VOID                           *SaveArea;
+  UINTN                          Index;
+  UINTN                          Payload;
+  UINTN                          Path;
+  UINTN                          WinFrom[MmMpTestSimdPathMax];
+  UINT64                         Mean[MmMpTestSimdPathMax];
+  UINT64                         Sum;
+  MM_MP_TEST_SIMD_JOB            Job;
+
+  SimdDetect (Supported, &XSaveSize);
+
+  Buffer   = MmMpTestArenaAllocate (MM_MP_TEST_SIMD_MAX_PAYLOAD);
+  SaveArea = MmMpTestArenaAllocateZero (MAX (XSaveSize, MM_MP_TEST_SIMD_FXSAVE_SIZE));
+  if (Buffer == NULL || SaveArea == NULL) {
+    DEBUG ((DEBUG_ERROR, "SIMD benchmark: scratch arena too small!\n"));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < MM_MP_TEST_SIMD_MAX_PAYLOAD / sizeof (UINT64); Index++) {
+    Buffer[Index] = MultU64x64 (Index, 0x9E3779B97F4A7C15ULL);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "SIMD kernels in SMM on Ap 0x%x, mean TSC cycles of %d runs, save and restore included, xsave area 0x%x bytes\n",
+    Context->SelectedApIndex,
+    MM_MP_TEST_SIMD_SAMPLES,
+    XSaveSize
+    ));
+  for (Path = 0; Path < MmMpTestSimdPathMax; Path++) {
+    WinFrom[Path] = 0;
+    if (!Supported[Path]) {
+      DEBUG ((DEBUG_INFO, "  %a not available in SMM on this CPU\n", mSimdPathName[Path]));
+    }
+  }
+
+  Job.Buffer   = Buffer;
+  Job.SaveArea = SaveArea;
+  Job.SaveMask = MM_MP_TEST_SIMD_AVX_MASK;
+
+  //
+  // Payload 0 is the bare save and restore, then the kernel over every
+  // payload size. The payload is warm in the AP caches from the previous
+  // path, every path reads the same lines.
+  //
+  for (Payload = 0; Payload <= MM_MP_TEST_SIMD_MAX_PAYLOAD; Payload = MAX (Payload * 2, MM_MP_TEST_SIMD_MIN_PAYLOAD)) {
+    Job.BlockCount = Payload / MM_MP_TEST_SIMD_BLOCK_SIZE;
+    Sum = 0;
+
+    for (Path = 0; Path < MmMpTestSimdPathMax; Path++) {
+      Mean[Path] = 0;
+      if (!Supported[Path]) {
+        continue;
+      }
+
+      Job.Path = (MM_MP_TEST_SIMD_PATH) Path;
+      Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, SimdProcedure, Context->SelectedApIndex, 0, &Job, NULL, NULL);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "SIMD %a: DispatchProcedure failed, %r!\n", mSimdPathName[Path], Status));
+        return Status;
+      }
+
+      if (Path == MmMpTestSimdScalar) {
+        Sum = Job.Sum;
+      } else if (Job.Sum != Sum) {
+        DEBUG ((DEBUG_ERROR, "  %a sum 0x%lx differs from scalar 0x%lx!\n", mSimdPathName[Path], Job.Sum, Sum));
+      }
+      Mean[Path] = MpBenchStatsMean (&Job.Cycles);
+    }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "  %6d bytes: scalar %ld (%ld B/kcyc), sse2+fxsave %ld (%ld B/kcyc), avx2+xsave %ld (%ld B/kcyc)\n",
+      Payload,
+      Mean[MmMpTestSimdScalar],
+      SimdThroughput (Payload, Mean[MmMpTestSimdScalar]),
+      Mean[MmMpTestSimdSse2],
+      SimdThroughput (Payload, Mean[MmMpTestSimdSse2]),
+      Mean[MmMpTestSimdAvx2],
+      SimdThroughput (Payload, Mean[MmMpTestSimdAvx2])
+      ));
+
+    //
+    // A path wins from the smallest payload after which it never loses.
+    //
+    for (Path = MmMpTestSimdSse2; Path < MmMpTestSimdPathMax; Path++) {
+      if (!Supported[Path] || Payload == 0) {
+        continue;
+      }
+      if (Mean[Path] >= Mean[MmMpTestSimdScalar]) {
+        WinFrom[Path] = 0;
+      } else if (WinFrom[Path] == 0) {
+        WinFrom[Path] = Payload;
+      }
+    }
+  }
+
+  for (Path = MmMpTestSimdSse2; Path < MmMpTestSimdPathMax; Path++) {
+    if (!Supported[Path]) {
+      continue;
+    }
+    if (WinFrom[Path] != 0) {
+      DEBUG ((DEBUG_INFO, "%a is a net win from %d bytes\n", mSimdPathName[Path], WinFrom[Path]));
+    } else {
+      DEBUG ((DEBUG_INFO, "%a is not a net win up to %d bytes\n", mSimdPathName[Path], MM_MP_TEST_SIMD_MAX_PAYLOAD));
+    }
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
+
+#else
+
+/**
+  The SIMD kernels are X64 only.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_UNSUPPORTED   Always.
+**/
+EFI_STATUS
+SmmMpSimdBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  DEBUG ((DEBUG_ERROR, "SIMD benchmark is only built for X64!\n"));
+  return EFI_UNSUPPORTED;
+}
+
+#endif
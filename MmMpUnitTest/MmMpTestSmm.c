@@ -18,32 +18,38 @@
   license agreement
 **/
 
-///
-/// External include files do NOT need to be explicitly specified in real EDKII
-/// environment
-///
-
-#include <PiDxe.h>
-#include <Protocol/SmmControl2.h>
-#include <Protocol/SmmSwDispatch2.h>
-#include <Protocol/MmMp.h>
-#include <Protocol/SmmCpuService.h>
-
-#include <Library/BaseLib.h>
-#include <Library/BaseMemoryLib.h>
-#include <Library/MemoryAllocationLib.h>
-#include <Library/DebugLib.h>
-#include <Library/IoLib.h>
-#include <Library/PciLib.h>
-#include <Library/UefiBootServicesTableLib.h>
-#include <Library/SmmServicesTableLib.h>
-#include <Library/TimerLib.h>
-#include <Library/SynchronizationLib.h>
-
-#include "MmMpTest.h"
+#include "MmMpTestSmm.h"
+
+//
+// Number of dispatches used to decide each point of the CheckForProcedure
+// boundary search, and the longest procedure duration the search will try.
+//
+#define MM_MP_TEST_BOUNDARY_SAMPLES       MM_MP_TEST_SAMPLES (4)
+#define MM_MP_TEST_BOUNDARY_LIMIT_US      10000
+
+//
+// Procedure durations of the non-block checks when the boundary search
+// fails, the fixed sleeps used before the search existed.
+//
+#define MM_MP_TEST_BOUNDARY_SHORT_US      0x80
+#define MM_MP_TEST_BOUNDARY_LONG_US       0x800
 
 SPIN_LOCK    mConsoleLock;
 
+//
+// Argument of the startup procedure. SetStartupProcedure keeps the pointer,
+// so it must outlive the SMI that registers it.
+//
+PROCEDURE_ARGUMENTS    mStartupArgument;
+
+MP_WORKLOAD            mWorkloadStorage;
+MP_WORKLOAD            *mWorkload;
+VOID                   *mWorkloadBuffer;
+UINTN                  mWorkloadSlotSize;
+UINTN                  mWorkloadSlotCount;
+
+BOOLEAN                mMmMpTestApLost;
+
 /**
   Calculate timeout value and return the current performance counter value.
 
@@ -186,12 +192,60 @@ Sleep (
                        TimeoutInMicroseconds,
                        &CurrentTime
                        );
+  TotalTime     = 0;
 
   while (!CheckTimeout (&CurrentTime, &TotalTime, ExpectedTime)) {
     CpuPause ();
   }
 }
 
+/**
+  Busy wait for a number of performance counter ticks.
+
+  Unlike Sleep (), a zero tick count returns immediately, so the procedure
+  duration can be swept down to nothing at counter resolution.
+
+  @param[in]  Ticks   Number of performance counter ticks to wait.
+**/
+VOID
+SpinForTicks (
+  IN  UINT64  Ticks
+  )
+{
+  UINT64 CurrentTime;
+  UINT64 TotalTime;
+
+  if (Ticks == 0) {
+    return;
+  }
+
+  CurrentTime = GetPerformanceCounter ();
+  TotalTime   = 0;
+  while (!CheckTimeout (&CurrentTime, &TotalTime, Ticks)) {
+    CpuPause ();
+  }
+}
+
+/**
+  Run the body of a test procedure: the workload of the argument, or a
+  CpuPause spin without one.
+
+  @param[in]  Argument   The PROCEDURE_ARGUMENTS of the procedure.
+  @param[in]  Ticks      Performance counter ticks to run, 0 returns at once.
+**/
+VOID
+RunProcedureBody (
+  IN PROCEDURE_ARGUMENTS  *Argument,
+  IN UINT64               Ticks
+  )
+{
+  if (Argument->Workload != NULL) {
+    MpWorkloadRun (Argument->Workload, Ticks);
+  } else {
+    SpinForTicks (Ticks);
+  }
+}
+
 VOID
 EFIAPI
 DebugMsg (
@@ -221,6 +275,7 @@ DebugMsg (
 **/
 
 VOID
+EFIAPI
 StartupProcedure (
   IN OUT VOID  *Buffer
   )
@@ -234,6 +289,7 @@ StartupProcedure (
 
 
 EFI_STATUS
+EFIAPI
 SingleApSyncProcedure (
   IN VOID  *ProcedureArgument
   )
@@ -248,6 +304,7 @@ SingleApSyncProcedure (
 }
 
 EFI_STATUS
+EFIAPI
 MultipleApSyncProcedure (
   IN VOID  *ProcedureArgument
   )
@@ -256,12 +313,16 @@ MultipleApSyncProcedure (
   
   Argument = (PROCEDURE_ARGUMENTS *)ProcedureArgument;
 
-  DebugMsg (DEBUG_INFO, "    Ap Sync Procedure function done, MagicNum = 0x%x!\n", Argument->MagicNumber);
+  //
+  // One bit per AP rather than one line, see MmMpTestResult.c.
+  //
+  MmMpTestResultMarkRan (Argument->Result);
 
   return Argument->MagicNumber;
 }
 
 EFI_STATUS
+EFIAPI
 SingleApAsyncProcedure (
   IN VOID  *ProcedureArgument
   )
@@ -270,7 +331,7 @@ SingleApAsyncProcedure (
   
   Argument = (PROCEDURE_ARGUMENTS *)ProcedureArgument;
 
-  Sleep (Argument->SleepTime);
+  RunProcedureBody (Argument, Argument->SpinTicks);
   
   DebugMsg (DEBUG_INFO, "    Ap Async Procedure function done, MagicNum = 0x%x, Processor Index = 0x%x!\n", Argument->MagicNumber, Argument->ProcessorIndex);
 
@@ -278,17 +339,49 @@ SingleApAsyncProcedure (
 }
 
 EFI_STATUS
+EFIAPI
 MultipleApAsyncProcedure (
   IN VOID  *ProcedureArgument
   )
 {
   PROCEDURE_ARGUMENTS            *Argument;
+  UINT64                         CurrentTime;
   
   Argument = (PROCEDURE_ARGUMENTS *)ProcedureArgument;
 
-  Sleep (Argument->SleepTime);
-  
-  DebugMsg (DEBUG_INFO, "    Ap Async Procedure function done, MagicNum = 0x%x!\n", Argument->MagicNumber);
+  if (Argument->Workload != NULL) {
+    MpWorkloadRun (Argument->Workload, CalculateTimeout (Argument->SleepTime, &CurrentTime));
+  } else {
+    Sleep (Argument->SleepTime);
+  }
+
+  MmMpTestResultMarkRan (Argument->Result);
+
+  return Argument->MagicNumber;
+}
+
+/**
+  Quiet procedure used by the CheckForProcedure boundary search and by the
+  non-block DispatchProcedure checks placed around that boundary.
+
+  It only runs its body for Argument->SpinTicks, so its duration is not
+  stretched by serial output or by waiting for mConsoleLock.
+
+  @param[in]  ProcedureArgument   The PROCEDURE_ARGUMENTS of the probe.
+
+  @return Argument->MagicNumber.
+**/
+EFI_STATUS
+EFIAPI
+BoundaryProbeProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PROCEDURE_ARGUMENTS            *Argument;
+
+  Argument = (PROCEDURE_ARGUMENTS *)ProcedureArgument;
+
+  RunProcedureBody (Argument, Argument->SpinTicks);
 
   return Argument->MagicNumber;
 }
@@ -312,7 +405,9 @@ SmmMpDispatchProcedureSyncModeVerification (
   DEBUG ((DEBUG_INFO, "1.0 Input Argument.MagicNumber = 0x%x.\n", Argument.MagicNumber));
   DEBUG ((DEBUG_INFO, "1.0 Input Argument.ProcessorIndex = 0x%x.\n", Argument.ProcessorIndex));
 
+  PERF_INMODULE_BEGIN ("MmMpDispatchSync");
   Status = SmmMp->DispatchProcedure (SmmMp, SingleApSyncProcedure, CpuNumber, 0, &Argument, NULL, NULL);
+  PERF_INMODULE_END ("MmMpDispatchSync");
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "1.1 DispatchProcedure return status = %r.\n", Status));
     goto ErrorExit;
@@ -325,7 +420,9 @@ SmmMpDispatchProcedureSyncModeVerification (
   DEBUG ((DEBUG_INFO, "1.0 Input Argument.MagicNumber = 0x%x.\n", Argument.MagicNumber));
   DEBUG ((DEBUG_INFO, "1.0 Input Argument.ProcessorIndex = 0x%x.\n", Argument.ProcessorIndex));
 
+  PERF_INMODULE_BEGIN ("MmMpDispatchSyncStatus");
   Status = SmmMp->DispatchProcedure (SmmMp, SingleApSyncProcedure, CpuNumber, 0, &Argument, NULL, &ProcedureStatus);
+  PERF_INMODULE_END ("MmMpDispatchSyncStatus");
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "1.2 DispatchProcedure return status = %r.\n", Status));
     goto ErrorExit;
@@ -354,12 +451,13 @@ EFI_STATUS
 SmmMpDispatchProcedureAsyncModeVerification (
   IN EFI_MM_MP_PROTOCOL                *SmmMp,
   IN UINT32                             CpuNumber,
-  IN UINT32                            SleepNum,
+  IN UINT64                            SpinTicks,
   IN BOOLEAN                           WithStatus
   )
 {
   MM_COMPLETION                  Token;
   EFI_STATUS                     Status;
+  EFI_STATUS                     CheckStatus;
   EFI_STATUS                     ProcedureStatus;
   PROCEDURE_ARGUMENTS            Argument;
   EFI_STATUS                     *ProcStatus;
@@ -376,20 +474,36 @@ SmmMpDispatchProcedureAsyncModeVerification (
   // 1. Check non-block style. 
   //
   Argument.MagicNumber = 0x20;
-  Argument.SleepTime = SleepNum;
+  Argument.SleepTime = 0;
+  Argument.SpinTicks = SpinTicks;
+  Argument.Workload = mWorkload;
   Argument.ProcessorIndex = (UINT32) CpuNumber;
 
   DEBUG ((DEBUG_INFO, "2.0 Input Argument.MagicNumber = 0x%x!\n", Argument.MagicNumber));
   DEBUG ((DEBUG_INFO, "2.0 Input Argument.ProcessorIndex = 0x%x!\n", Argument.ProcessorIndex));
-  DEBUG ((DEBUG_INFO, "2.0 Input Argument.SleepTime = 0x%x!\n", Argument.SleepTime));
+  DEBUG ((DEBUG_INFO, "2.0 Input Argument.SpinTicks = 0x%lx!\n", Argument.SpinTicks));
 
-  Status = SmmMp->DispatchProcedure (SmmMp, SingleApAsyncProcedure, CpuNumber, 0, &Argument, &Token, ProcStatus);
+  PERF_INMODULE_BEGIN ("MmMpDispatchAsync");
+  //
+  // The quiet probe the boundary was measured with, a procedure printing
+  // when done would move the boundary by the length of its output.
+  //
+  Status = SmmMp->DispatchProcedure (SmmMp, BoundaryProbeProcedure, CpuNumber, 0, &Argument, &Token, ProcStatus);
+  PERF_INMODULE_END ("MmMpDispatchAsync");
   if (EFI_ERROR (Status)) {
     DebugMsg (DEBUG_ERROR, "2.1 DispatchProcedure return status = %r\n", Status);
     goto Exit;
-  } else {
-    DebugMsg (DEBUG_ERROR, "2.1 DispatchProcedure function return EFI_SUCCESS!\n");
   }
+
+  //
+  // Poll before printing anything, otherwise the serial output of the BSP
+  // rather than the procedure duration decides what CheckForProcedure sees.
+  //
+  PERF_INMODULE_BEGIN ("MmMpDispatchCheck");
+  CheckStatus = SmmMp->CheckForProcedure (SmmMp, Token);
+  PERF_INMODULE_END ("MmMpDispatchCheck");
+
+  DebugMsg (DEBUG_ERROR, "2.1 DispatchProcedure function return EFI_SUCCESS!\n");
   DebugMsg (DEBUG_ERROR, "\n");
 
   //
@@ -397,10 +511,15 @@ SmmMpDispatchProcedureAsyncModeVerification (
   //
   // DEBUG ((DEBUG_ERROR, "Token address = 0x%x!\n", &Token));
   DebugMsg (DEBUG_INFO, "2.2 Check For Procedure test begin.\n");
-  Status = SmmMp->CheckForProcedure (SmmMp, Token);
+  Status = CheckStatus;
   if (EFI_ERROR (Status)) {
     if (Status != EFI_NOT_READY) {
       DebugMsg (DEBUG_ERROR, "2.2 CheckForProcedure return status = %r!\n", Status);
+      //
+      // Argument and the procedure status are on this stack, the AP may
+      // still write them.
+      //
+      SmmMp->WaitForProcedure (SmmMp, Token);
       goto Exit;
     } else {
       DebugMsg (DEBUG_ERROR, "2.2 CheckForProcedure return EFI_NOT_READY!\n");
@@ -415,7 +534,9 @@ SmmMpDispatchProcedureAsyncModeVerification (
   // 3. check WaitForProcedure.
   //
   DebugMsg (DEBUG_INFO, "2.3 Wait For Procedure test begin.\n");
+  PERF_INMODULE_BEGIN ("MmMpDispatchWait");
   Status = SmmMp->WaitForProcedure (SmmMp, Token);
+  PERF_INMODULE_END ("MmMpDispatchWait");
   if (EFI_ERROR (Status)) {
     DebugMsg (DEBUG_ERROR, "2.3 SmmMpWaitForProcedure return status = %r!\n", Status);
   } else {
@@ -436,60 +557,308 @@ Exit:
   return Status;
 }
 
+/**
+  Dispatch the quiet probe procedure and poll it once with CheckForProcedure.
+
+  @param[in]  SmmMp         The MM MP protocol.
+  @param[in]  CpuNumber     The AP to dispatch the probe to.
+  @param[in]  SpinTicks     Duration of the probe in performance counter ticks.
+  @param[in]  WithStatus    Whether to pass a CPUStatus buffer to DispatchProcedure.
+  @param[out] NotReady      TRUE if the first CheckForProcedure returned
+                            EFI_NOT_READY in most of the samples.
+
+  @retval EFI_SUCCESS       The probe completed on every sample.
+  @retval Others            DispatchProcedure or WaitForProcedure failed.
+**/
+EFI_STATUS
+SmmMpProbeFirstPoll (
+  IN  EFI_MM_MP_PROTOCOL                *SmmMp,
+  IN  UINTN                             CpuNumber,
+  IN  UINT64                            SpinTicks,
+  IN  BOOLEAN                           WithStatus,
+  OUT BOOLEAN                           *NotReady
+  )
+{
+  MM_COMPLETION                  Token;
+  EFI_STATUS                     Status;
+  EFI_STATUS                     ProcedureStatus;
+  PROCEDURE_ARGUMENTS            Argument;
+  UINTN                          Sample;
+  UINTN                          NotReadyCount;
+
+  Argument.MagicNumber    = 0x30;
+  Argument.ProcessorIndex = (UINT32) CpuNumber;
+  Argument.SleepTime      = 0;
+  Argument.SpinTicks      = SpinTicks;
+  Argument.Workload       = mWorkload;
+
+  NotReadyCount = 0;
+  for (Sample = 0; Sample < MM_MP_TEST_BOUNDARY_SAMPLES; Sample++) {
+    Status = SmmMp->DispatchProcedure (
+                      SmmMp,
+                      BoundaryProbeProcedure,
+                      CpuNumber,
+                      0,
+                      &Argument,
+                      &Token,
+                      WithStatus ? &ProcedureStatus : NULL
+                      );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Status = SmmMp->CheckForProcedure (SmmMp, Token);
+    if (Status == EFI_NOT_READY) {
+      NotReadyCount++;
+    }
+    if (EFI_ERROR (Status)) {
+      //
+      // The token is only released once the procedure is reported done,
+      // and Argument is on this stack.
+      //
+      Status = SmmMp->WaitForProcedure (SmmMp, Token);
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  *NotReady = (BOOLEAN) (NotReadyCount * 2 > MM_MP_TEST_BOUNDARY_SAMPLES);
+  return EFI_SUCCESS;
+}
+
+/**
+  Binary search the shortest procedure duration for which the first
+  CheckForProcedure after DispatchProcedure returns EFI_NOT_READY.
+
+  That duration is the dispatch-to-first-poll latency of the platform: shorter
+  procedures are already done when the BSP polls, longer ones are not.
+
+  @param[in]  SmmMp         The MM MP protocol.
+  @param[in]  CpuNumber     The AP to measure.
+  @param[in]  WithStatus    Whether to pass a CPUStatus buffer to DispatchProcedure.
+  @param[out] Threshold     The boundary in performance counter ticks.
+
+  @retval EFI_SUCCESS       The boundary was found.
+  @retval EFI_NOT_FOUND     Even MM_MP_TEST_BOUNDARY_LIMIT_US finished before the first poll.
+  @retval Others            The probe dispatch failed.
+**/
+EFI_STATUS
+SmmMpFindDispatchBoundary (
+  IN  EFI_MM_MP_PROTOCOL                *SmmMp,
+  IN  UINTN                             CpuNumber,
+  IN  BOOLEAN                           WithStatus,
+  OUT UINT64                            *Threshold
+  )
+{
+  EFI_STATUS                     Status;
+  BOOLEAN                        NotReady;
+  UINT64                         Low;
+  UINT64                         High;
+  UINT64                         Middle;
+  UINT64                         Limit;
+  UINT64                         CurrentTime;
+
+  Status = SmmMpProbeFirstPoll (SmmMp, CpuNumber, 0, WithStatus, &NotReady);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if (NotReady) {
+    *Threshold = 0;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Low is always a duration that finished before the first poll, High one
+  // that did not. Grow High exponentially first, then bisect [Low, High].
+  //
+  Limit = CalculateTimeout (MM_MP_TEST_BOUNDARY_LIMIT_US, &CurrentTime);
+  Low   = 0;
+  High  = 1;
+  while (TRUE) {
+    Status = SmmMpProbeFirstPoll (SmmMp, CpuNumber, High, WithStatus, &NotReady);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    if (NotReady) {
+      break;
+    }
+    if (High >= Limit) {
+      return EFI_NOT_FOUND;
+    }
+    Low  = High;
+    High = LShiftU64 (High, 1);
+  }
+
+  while (High - Low > 1) {
+    Middle = Low + RShiftU64 (High - Low, 1);
+    Status = SmmMpProbeFirstPoll (SmmMp, CpuNumber, Middle, WithStatus, &NotReady);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    if (NotReady) {
+      High = Middle;
+    } else {
+      Low  = Middle;
+    }
+  }
+
+  *Threshold = High;
+  return EFI_SUCCESS;
+}
+
+/**
+  Report the CheckForProcedure boundary of every AP, with and without CPUStatus.
+
+  Per AP lines are only printed on small systems, the summary gives the
+  distribution over all APs, the APs at both ends and the failures.
+
+  @param[in]  SmmMp         The MM MP protocol.
+  @param[in]  SmmCpu        The SMM CPU service protocol.
+  @param[in]  ProcessorNum  Number of processors.
+  @param[in]  BspIndex      Index of the BSP, which is skipped.
+**/
+VOID
+SmmMpDispatchBoundarySweep (
+  IN EFI_MM_MP_PROTOCOL                 *SmmMp,
+  IN EFI_SMM_CPU_SERVICE_PROTOCOL       *SmmCpu,
+  IN UINTN                              ProcessorNum,
+  IN UINTN                              BspIndex
+  )
+{
+  EFI_STATUS                     Status;
+  UINTN                          Index;
+  UINTN                          Mode;
+  UINT64                         Threshold;
+  UINT64                         Ns;
+  UINTN                          MinAp;
+  UINTN                          MaxAp;
+  MP_BENCH_STATS                 Stats;
+  MM_MP_TEST_RESULT              Result;
+  CHAR8                          Label[48];
+
+  for (Mode = 0; Mode < 2; Mode++) {
+    Status = MmMpTestResultInitialize (&Result, SmmCpu, ProcessorNum, BspIndex);
+    if (EFI_ERROR (Status)) {
+      return;
+    }
+    MpBenchStatsReset (&Stats);
+    MinAp = BspIndex;
+    MaxAp = BspIndex;
+
+    for (Index = 0; Index < ProcessorNum; Index++) {
+      if (Index == BspIndex) {
+        continue;
+      }
+
+      Status = SmmMpFindDispatchBoundary (SmmMp, Index, (BOOLEAN) (Mode != 0), &Threshold);
+      if (EFI_ERROR (Status)) {
+        MmMpTestResultFail (&Result, Index, Status);
+        continue;
+      }
+
+      Ns = GetTimeInNanoSecond (Threshold);
+      DEBUG ((MM_MP_TEST_DETAIL_LEVEL (ProcessorNum), "2.5 Boundary Ap 0x%x CpuStatus %a: %ld ticks (%ld ns)\n", Index, (Mode != 0) ? "!= NULL" : "== NULL", Threshold, Ns));
+      if (Stats.Count == 0 || Ns < Stats.Min) {
+        MinAp = Index;
+      }
+      if (Stats.Count == 0 || Ns > Stats.Max) {
+        MaxAp = Index;
+      }
+      MpBenchStatsAdd (&Stats, Ns);
+    }
+
+    AsciiSPrint (Label, sizeof (Label), "2.5 Boundary CpuStatus %a", (Mode != 0) ? "!= NULL" : "== NULL");
+    if (Stats.Count != 0) {
+      MpBenchStatsPrint (DEBUG_INFO, Label, "ns", &Stats);
+      MpBenchStatsPrintHistogram (DEBUG_INFO, Label, "ns", &Stats);
+      DEBUG ((DEBUG_INFO, "%a: shortest on Ap 0x%x, longest on Ap 0x%x\n", Label, MinAp, MaxAp));
+    }
+    MmMpTestResultPrint (&Result, Label);
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+}
+
 VOID
 SmmMpDispatchProcedureVerification (
   IN EFI_MM_MP_PROTOCOL                 *SmmMp,
   IN UINT32                             CpuNumber
   )
 {
+  EFI_STATUS                     Status;
+  UINTN                          Mode;
+  BOOLEAN                        WithStatus;
+  UINT64                         Threshold;
+  UINT64                         ShortTicks;
+  UINT64                         LongTicks;
+  UINT64                         CurrentTime;
+
   //
   // 1. Check block style. 
   // 
   SmmMpDispatchProcedureSyncModeVerification (SmmMp, CpuNumber);
 
-  //
-  // 2. Check non-block style with 0x80 sleep time. 
-  // Expect WaitForProcedure should not work at this test.
-  //
-  SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, 0x80, FALSE);
+  for (Mode = 0; Mode < 2; Mode++) {
+    WithStatus = (BOOLEAN) (Mode != 0);
 
-  //
-  // 3. Check non-block style with 0x80 sleep time. 
-  // Expect WaitForProcedure should not work at this test.
-  //
-  SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, 0x80, TRUE);
+    //
+    // 2. Find where CheckForProcedure starts to return EFI_NOT_READY on this
+    // AP, so the non-block checks below straddle the real boundary.
+    //
+    Status = SmmMpFindDispatchBoundary (SmmMp, CpuNumber, WithStatus, &Threshold);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "2.5 Boundary Ap 0x%x CpuStatus %a: %r, falling back to %d and %d us\n",
+        CpuNumber,
+        WithStatus ? "!= NULL" : "== NULL",
+        Status,
+        MM_MP_TEST_BOUNDARY_SHORT_US,
+        MM_MP_TEST_BOUNDARY_LONG_US
+        ));
+      ShortTicks = CalculateTimeout (MM_MP_TEST_BOUNDARY_SHORT_US, &CurrentTime);
+      LongTicks  = CalculateTimeout (MM_MP_TEST_BOUNDARY_LONG_US, &CurrentTime);
+    } else {
+      DEBUG ((DEBUG_INFO, "2.5 Boundary Ap 0x%x CpuStatus %a: %ld ticks (%ld ns)\n", CpuNumber, WithStatus ? "!= NULL" : "== NULL", Threshold, GetTimeInNanoSecond (Threshold)));
+      ShortTicks = RShiftU64 (Threshold, 1);
+      LongTicks  = LShiftU64 (Threshold, 2) + 1;
+    }
+    DEBUG ((DEBUG_INFO, "\n"));
 
-  //
-  // 4. Check non-block style with 0x400 sleep time.
-  // Expect WaitForProcedure should work at this test.
-  //
-  SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, 0x800, FALSE);
+    //
+    // 3. Check non-block style with half the boundary.
+    // Expect WaitForProcedure should not work at this test.
+    //
+    SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, ShortTicks, WithStatus);
 
-  //
-  // 5. Check non-block style with 0x400 sleep time.
-  // Expect WaitForProcedure should work at this test.
-  //
-  SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, 0x800, TRUE);
+    //
+    // 4. Check non-block style with four times the boundary.
+    // Expect WaitForProcedure should work at this test.
+    //
+    SmmMpDispatchProcedureAsyncModeVerification (SmmMp, CpuNumber, LongTicks, WithStatus);
+  }
 }
 
 EFI_STATUS
 SmmMpBroadcastProcedureSyncModeVerification (
   IN EFI_MM_MP_PROTOCOL                 *SmmMp,
+  IN EFI_SMM_CPU_SERVICE_PROTOCOL       *SmmCpu,
   IN UINT32                             ProcessorNum,
+  IN UINTN                              BspIndex,
   IN BOOLEAN                            WithStatus
   )
 {
   EFI_STATUS                     Status;
   EFI_STATUS                     *StatusArray;
   PROCEDURE_ARGUMENTS            Argument;
-  UINTN                          Index;
-  BOOLEAN                        FoundError;
+  MM_MP_TEST_RESULT              Result;
 
   if (WithStatus) {
     DEBUG ((DEBUG_INFO, "3.0 Block Mode BroadcastProcedure test with CPUStatus != NULL\n"));
-    StatusArray = AllocateZeroPool (sizeof(EFI_STATUS) * ProcessorNum);
-    ASSERT (StatusArray != NULL);
-    ZeroMem (StatusArray, sizeof(EFI_STATUS) * ProcessorNum);
+    StatusArray = MmMpTestArenaAllocateZero (sizeof(EFI_STATUS) * ProcessorNum);
+    if (StatusArray == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
   } else {
     DEBUG ((DEBUG_INFO, "3.0 Block Mode BroadcastProcedure test with CPUStatus == NULL\n"));
     StatusArray = NULL;
@@ -498,15 +867,23 @@ SmmMpBroadcastProcedureSyncModeVerification (
   //
   // 1. Check block style. 
   // 
+  Status = MmMpTestResultInitialize (&Result, SmmCpu, ProcessorNum, BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Argument.MagicNumber    = 0x10;
   Argument.ProcessorIndex = (UINT32) ProcessorNum;
+  Argument.Result         = &Result;
   DEBUG ((DEBUG_INFO, "3.0 Input Argument.MagicNumber = 0x%x!\n", Argument.MagicNumber));
   DEBUG ((DEBUG_INFO, "3.0 Input Argument.ProcessorIndex = 0x%x!\n", Argument.ProcessorIndex));
 
   //
   // 1. Check block style. 
   //
+  PERF_INMODULE_BEGIN ("MmMpBroadcastSync");
   Status = SmmMp->BroadcastProcedure (SmmMp, MultipleApSyncProcedure, 0, &Argument, NULL, StatusArray);
+  PERF_INMODULE_END ("MmMpBroadcastSync");
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "3.1 BroadcastProcedure function return %r!\n", Status));
     goto ErrorExit;
@@ -514,26 +891,11 @@ SmmMpBroadcastProcedureSyncModeVerification (
     DEBUG ((DEBUG_ERROR, "3.1 BroadcastProcedure function return EFI_SUCCESS!\n"));
   }
 
-  if (WithStatus) {
-    //
-    // 2. Check procedure return status.
-    //
-    FoundError = FALSE;
-    //
-    // Skip BSP, Index begin from 1.
-    //
-    DEBUG ((DEBUG_ERROR, "3.2 BroadcastProcedure check Procedure return Status!\n"));
-    for (Index = 1; Index < ProcessorNum; Index ++) {
-      if (StatusArray[Index] != Argument.MagicNumber) {
-        DEBUG ((DEBUG_ERROR, "3.2 BroadcastProcedure check procedure return status failed, Ap = 0x%x!\n", Index));
-        FoundError = TRUE;
-      }
-    }
-    
-    if (!FoundError) {
-      DEBUG ((DEBUG_ERROR, "3.2 BroadcastProcedure function check procedure return status pass!\n"));
-    }
-  }
+  //
+  // 2. Check every AP ran the procedure, and its return status.
+  //
+  MmMpTestResultCheck (&Result, StatusArray, Argument.MagicNumber, TRUE);
+  MmMpTestResultPrint (&Result, "3.2 BroadcastProcedure procedure run and return status");
 
 ErrorExit:
   DEBUG ((DEBUG_ERROR, "\n"));
@@ -545,7 +907,9 @@ ErrorExit:
 EFI_STATUS
 SmmMpBroadcastProcedureAsyncModeVerification (
   IN EFI_MM_MP_PROTOCOL                 *SmmMp,
+  IN EFI_SMM_CPU_SERVICE_PROTOCOL       *SmmCpu,
   IN UINT32                             ProcessorNum,
+  IN UINTN                              BspIndex,
   IN UINT32                             SleepNum,
   IN BOOLEAN                            WithStatus
   )
@@ -554,14 +918,14 @@ SmmMpBroadcastProcedureAsyncModeVerification (
   EFI_STATUS                     Status;
   EFI_STATUS                     *StatusArray;
   PROCEDURE_ARGUMENTS            Argument;
-  BOOLEAN                        FoundError;
-  UINTN                          Index;
+  MM_MP_TEST_RESULT              Result;
 
   if (WithStatus) {
     DEBUG ((DEBUG_INFO, "4.0 Non-Block mode BroadcastProcedure test with CPUStatus != NULL\n"));
-    StatusArray = AllocateZeroPool (sizeof(EFI_STATUS) * ProcessorNum);
-    ASSERT (StatusArray != NULL);
-    ZeroMem (StatusArray, sizeof(EFI_STATUS) * ProcessorNum);
+    StatusArray = MmMpTestArenaAllocateZero (sizeof(EFI_STATUS) * ProcessorNum);
+    if (StatusArray == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
   } else {
     DEBUG ((DEBUG_INFO, "4.0 Non-Block mode BroadcastProcedure test with CPUStatus == NULL\n"));
     StatusArray = NULL;
@@ -570,14 +934,23 @@ SmmMpBroadcastProcedureAsyncModeVerification (
   //
   // 1. Check Non-block style. 
   //
+  Status = MmMpTestResultInitialize (&Result, SmmCpu, ProcessorNum, BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Argument.ProcessorIndex = (UINT32) ProcessorNum;
   Argument.MagicNumber    = 0x20;
   Argument.SleepTime      = SleepNum;
+  Argument.Workload       = mWorkload;
+  Argument.Result         = &Result;
   DEBUG ((DEBUG_INFO, "4.0 Input Argument.MagicNumber = 0x%x!\n", Argument.MagicNumber));
   DEBUG ((DEBUG_INFO, "4.0 Input Argument.ProcessorIndex = 0x%x!\n", Argument.ProcessorIndex));
   DEBUG ((DEBUG_INFO, "4.0 Input Argument.SleepTime = 0x%x!\n", Argument.SleepTime));
 
+  PERF_INMODULE_BEGIN ("MmMpBroadcastAsync");
   Status = SmmMp->BroadcastProcedure (SmmMp, MultipleApAsyncProcedure, 0, &Argument, &Token, StatusArray);
+  PERF_INMODULE_END ("MmMpBroadcastAsync");
   if (EFI_ERROR (Status)) {
     DebugMsg (DEBUG_ERROR, "4.1 BroadcastProcedure function return %r!\n", Status);
     goto Exit;
@@ -587,10 +960,16 @@ SmmMpBroadcastProcedureAsyncModeVerification (
   DebugMsg (DEBUG_ERROR, "\n");
 
   DebugMsg (DEBUG_INFO, "4.2 Check For Procedure test begin.\n");
+  PERF_INMODULE_BEGIN ("MmMpBroadcastCheck");
   Status = SmmMp->CheckForProcedure (SmmMp, Token);
+  PERF_INMODULE_END ("MmMpBroadcastCheck");
   if (EFI_ERROR (Status)) {
     if (Status != EFI_NOT_READY) {
       DebugMsg (DEBUG_ERROR, "4.2 CheckForProcedure return status = %r!\n", Status);
+      //
+      // Argument and Result are on this stack, the APs may still write them.
+      //
+      SmmMp->WaitForProcedure (SmmMp, Token);
       goto Exit;
     } else {
       DebugMsg (DEBUG_ERROR, "4.2 CheckForProcedure not get the final result! status = EFI_NOT_READY!\n");
@@ -602,7 +981,9 @@ SmmMpBroadcastProcedureAsyncModeVerification (
   DebugMsg (DEBUG_ERROR, "\n");
 
   DebugMsg (DEBUG_INFO, "4.3 Wait For Procedure test begin.\n");
+  PERF_INMODULE_BEGIN ("MmMpBroadcastWait");
   Status = SmmMp->WaitForProcedure (SmmMp, Token);
+  PERF_INMODULE_END ("MmMpBroadcastWait");
   if (EFI_ERROR (Status)) {
     DebugMsg (DEBUG_ERROR, "4.3 WaitForProcedure return status = %r!\n", Status);
   } else {
@@ -611,22 +992,9 @@ SmmMpBroadcastProcedureAsyncModeVerification (
 
 Exit:
 
-  if (EFI_SUCCESS == Status && StatusArray != NULL) {
-    FoundError = FALSE;
-    //
-    // Skip BSP, Index begin from 1.
-    //
-    DEBUG ((DEBUG_ERROR, "4.4 BroadcastProcedure check Procedure return Status!\n"));
-    for (Index = 1; Index < ProcessorNum; Index ++) {
-      if (StatusArray[Index] != Argument.MagicNumber) {
-        DEBUG ((DEBUG_ERROR, "4.4 BroadcastProcedure check procedure return status failed, Ap = 0x%x!\n", Index));
-        FoundError = TRUE;
-      }
-    }
-
-    if (!FoundError) {
-      DEBUG ((DEBUG_ERROR, "4.4 BroadcastProcedure check procedure return status pass!\n"));
-    }
+  if (EFI_SUCCESS == Status) {
+    MmMpTestResultCheck (&Result, StatusArray, Argument.MagicNumber, TRUE);
+    MmMpTestResultPrint (&Result, "4.4 BroadcastProcedure procedure run and return status");
   }
 
   DEBUG ((DEBUG_ERROR, "\n"));
@@ -638,42 +1006,70 @@ Exit:
 VOID
 SmmMpBroadcastProcedureVerification (
   IN EFI_MM_MP_PROTOCOL                 *SmmMp,
-  IN UINT32                             ProcessorNum
+  IN EFI_SMM_CPU_SERVICE_PROTOCOL       *SmmCpu,
+  IN UINT32                             ProcessorNum,
+  IN UINTN                              BspIndex
   )
 {
   //
   // 1. Check block style. 
   //
-  SmmMpBroadcastProcedureSyncModeVerification (SmmMp, ProcessorNum, FALSE);
+  SmmMpBroadcastProcedureSyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, FALSE);
 
   //
   // 1. Check block style. 
   //
-  SmmMpBroadcastProcedureSyncModeVerification (SmmMp, ProcessorNum, TRUE);
+  SmmMpBroadcastProcedureSyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, TRUE);
 
   //
   // 2. Check Non-block style.
   // Expect WaitForProcedure should not work at this test.
   // 
-  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, ProcessorNum, 0x80, FALSE);
+  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, 0x80, FALSE);
 
   //
   // 2. Check Non-block style.
   // Expect WaitForProcedure should not work at this test.
   // 
-  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, ProcessorNum, 0x80, TRUE);
+  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, 0x80, TRUE);
 
   //
   // 3. Check Non-block style.
   // Expect WaitForProcedure should work at this test.
   // 
-  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, ProcessorNum, 0x400, FALSE);
+  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, 0x400, FALSE);
 
   //
   // 3. Check Non-block style.
   // Expect WaitForProcedure should work at this test.
   // 
-  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, ProcessorNum, 0x400, TRUE);
+  SmmMpBroadcastProcedureAsyncModeVerification (SmmMp, SmmCpu, ProcessorNum, BspIndex, 0x400, TRUE);
+}
+
+/**
+  Select the AP the single AP tests dispatch to, PcdMmMpTestTargetAp if it
+  names an AP, otherwise the highest numbered AP.
+
+  @param[in]  ProcessorNum  Number of processors, at least 2.
+  @param[in]  BspIndex      Index of the BSP.
+
+  @return The AP index.
+**/
+STATIC
+UINTN
+MmMpTestSelectAp (
+  IN UINTN                              ProcessorNum,
+  IN UINTN                              BspIndex
+  )
+{
+  UINTN                          TargetAp;
+
+  TargetAp = FixedPcdGet32 (PcdMmMpTestTargetAp);
+  if (TargetAp < ProcessorNum && TargetAp != BspIndex) {
+    return TargetAp;
+  }
+
+  return ProcessorNum - 1 != BspIndex ? ProcessorNum - 1 : BspIndex - 1;
 }
 
 
@@ -711,8 +1107,7 @@ SmmMpVerification (
   //
   // 0. Test SmmMp->SetStartupProcedure API.
   //
-  Argument = AllocatePool (sizeof (PROCEDURE_ARGUMENTS));
-  ASSERT (Argument != NULL);
+  Argument = &mStartupArgument;
   Argument->ProcessorIndex = (UINT32) BspIndex;
   Argument->MagicNumber    = 0x1234;
   Status = SmmMp->SetStartupProcedure (SmmMp, StartupProcedure, Argument);
@@ -728,7 +1123,7 @@ SmmMpVerification (
   DEBUG ((DEBUG_INFO, "Test for SmmMpGetNumberOfProcessors Done!\n"));
 
   if (ProcessorsNum != 1) {
-    SelectedApIndex = ProcessorsNum - 1 != BspIndex ? ProcessorsNum - 1 : BspIndex - 1;
+    SelectedApIndex = MmMpTestSelectAp (ProcessorsNum, BspIndex);
     DEBUG ((DEBUG_ERROR, "Selected Ap Index = %x to trig Smm Mp Dispatch Procedure!\n", SelectedApIndex));
   } else {
     DEBUG ((DEBUG_ERROR, "Only one processor found, can't do SMM MP protocol test.!\n"));
@@ -743,16 +1138,117 @@ SmmMpVerification (
   SmmMpDispatchProcedureVerification (SmmMp, (UINT32)SelectedApIndex);
   DebugMsg (DEBUG_ERROR, "\n");
 
+  //
+  // Track the CheckForProcedure boundary of every AP, not only the selected one.
+  //
+  SmmMpDispatchBoundarySweep (SmmMp, SmmCpu, ProcessorsNum, BspIndex);
+
   //
   // 3. Test SmmMp->BroadcastProcedure API.
   //
   DebugMsg (DEBUG_INFO, "2. Begin to verify Broadcast Procedure!\n", Status);
-  SmmMpBroadcastProcedureVerification (SmmMp, (UINT32)ProcessorsNum);
+  SmmMpBroadcastProcedureVerification (SmmMp, SmmCpu, (UINT32)ProcessorsNum, BspIndex);
   DebugMsg (DEBUG_ERROR, "\n");
 
   return Status;
 }
 
+/**
+  Set up the workload the test procedures run as their body.
+
+  The buffer of the memory profiles is allocated by MpWorkloadSelect on
+  first use and kept, the pointer chase cycles are rebuilt on every
+  selection. It holds a slot per CPU, sized to fit
+  MM_MP_TEST_WORKLOAD_BUDGET.
+
+  @param[in]  Profile   The MP_WORKLOAD_PROFILE from the data port.
+
+  @return The workload, or NULL to keep the CpuPause spin.
+**/
+MP_WORKLOAD *
+MmMpTestSelectWorkload (
+  IN UINTN                          Profile
+  )
+{
+  UINTN                          CpuCount;
+
+  if ((Profile == MpWorkloadStream || Profile == MpWorkloadPointerChase) && mWorkloadBuffer == NULL) {
+    CpuCount           = MAX (gSmst->NumberOfCpus, 1);
+    mWorkloadSlotSize  = MIN (MM_MP_TEST_WORKLOAD_SLOT_SIZE, MM_MP_TEST_WORKLOAD_BUDGET / CpuCount);
+    mWorkloadSlotSize  = MAX (mWorkloadSlotSize & ~(UINTN) (MM_MP_TEST_CACHE_LINE_SIZE - 1), MM_MP_TEST_WORKLOAD_SLOT_MIN);
+    mWorkloadSlotCount = MIN (CpuCount, MAX (MM_MP_TEST_WORKLOAD_BUDGET / mWorkloadSlotSize, 1));
+    if (mWorkloadSlotCount < CpuCount) {
+      DEBUG ((DEBUG_WARN, "Workload: 0x%x Cpus share 0x%x slots of 0x%x bytes.\n", CpuCount, mWorkloadSlotCount, mWorkloadSlotSize));
+    }
+  }
+
+  if (MpWorkloadSelect (
+        &mWorkloadStorage,
+        Profile,
+        &mWorkloadBuffer,
+        mWorkloadSlotSize,
+        mWorkloadSlotCount,
+        MM_MP_TEST_WORKLOAD_STREAM_MBPS
+        ) == NULL) {
+    return NULL;
+  }
+
+  if (mWorkloadStorage.Buffer != NULL) {
+    DEBUG ((DEBUG_INFO, "Procedure body: %a workload, 0x%x slots of 0x%x bytes\n", MpWorkloadProfileName ((MP_WORKLOAD_PROFILE) Profile), mWorkloadSlotCount, mWorkloadSlotSize));
+  } else {
+    DEBUG ((DEBUG_INFO, "Procedure body: %a workload\n", MpWorkloadProfileName ((MP_WORKLOAD_PROFILE) Profile)));
+  }
+  return &mWorkloadStorage;
+}
+
+/**
+  Collect what the benchmarks need to know about the MM MP environment.
+
+  @param[out] Context   The MM MP test context.
+
+  @retval EFI_SUCCESS       The context is filled.
+  @retval EFI_UNSUPPORTED   Only one processor found.
+  @retval Others            A protocol is missing.
+**/
+EFI_STATUS
+SmmMpGetTestContext (
+  OUT MM_MP_TEST_CONTEXT                *Context
+  )
+{
+  EFI_STATUS                        Status;
+
+  Status = gSmst->SmmLocateProtocol (&gEfiMmMpProtocolGuid, NULL, (VOID **) &Context->SmmMp);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "gEfiSmmMpProtocolGuid not found!\n"));
+    return Status;
+  }
+
+  Status = gSmst->SmmLocateProtocol (&gEfiSmmCpuServiceProtocolGuid, NULL, (VOID **) &Context->SmmCpu);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "gEfiSmmCpuServiceProtocolGuid not found!\n"));
+    return Status;
+  }
+
+  Status = Context->SmmCpu->WhoAmI (Context->SmmCpu, &Context->BspIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  Status = Context->SmmMp->GetNumberOfProcessors (Context->SmmMp, &Context->ProcessorNum);
+  ASSERT_EFI_ERROR (Status);
+
+  if (Context->ProcessorNum == 1) {
+    DEBUG ((DEBUG_ERROR, "Only one processor found, can't do SMM MP protocol test.!\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  Context->SelectedApIndex = MmMpTestSelectAp (Context->ProcessorNum, Context->BspIndex);
+
+  //
+  // Without the table procedures fall back to WhoAmI.
+  //
+  MmMpTestPerCpuInitialize (Context);
+  return EFI_SUCCESS;
+}
+
 /**
   A SW SMI callback to check whole memory CRC32
 
@@ -767,8 +1263,86 @@ MmMpTestSwSmiCallback (
   IN  OUT UINTN                         *CommBufferSize
   )
 {
-  //CpuDeadLoop ();
-  SmmMpVerification ();
+  MM_MP_TEST_CONTEXT                Context;
+  UINT8                             TestId;
+  UINT8                             Profile;
+
+  //
+  // The SW SMI data port selects the test, default to the MM MP verification.
+  //
+  TestId = MM_MP_TEST_ID_VERIFICATION;
+  if (CommBuffer != NULL && CommBufferSize != NULL && *CommBufferSize >= sizeof (EFI_SMM_SW_CONTEXT)) {
+    TestId = ((EFI_SMM_SW_CONTEXT *) CommBuffer)->DataPort;
+  }
+  Profile = TestId >> MM_MP_TEST_WORKLOAD_SHIFT;
+  TestId &= MM_MP_TEST_ID_MASK;
+  mWorkload = MmMpTestSelectWorkload (Profile);
+
+  if (mMmMpTestApLost) {
+    DEBUG ((DEBUG_ERROR, "An Ap did not come back from a timed out procedure, Mm Mp tests are disabled until reset!\n"));
+  } else if (TestId == MM_MP_TEST_ID_VERIFICATION) {
+    //CpuDeadLoop ();
+    SmmMpVerification ();
+  } else if (!EFI_ERROR (SmmMpGetTestContext (&Context))) {
+    switch (TestId) {
+    case MM_MP_TEST_ID_TIMEOUT:
+      SmmMpTimeoutBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_ARENA:
+      SmmMpArenaBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_STACK:
+      SmmMpStackBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_TOPOLOGY:
+      SmmMpTopologyBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_PINGPONG:
+      SmmMpPingPongBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_SIMD:
+      SmmMpSimdBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_TSC:
+      SmmMpTscSkewBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_IMBALANCE:
+      SmmMpImbalanceBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_PER_CPU:
+      SmmMpPerCpuBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_COUNTER:
+      SmmMpCounterBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_COLD_CACHE:
+      SmmMpColdCacheBenchmark (&Context);
+      break;
+
+    case MM_MP_TEST_ID_PAYLOAD:
+      SmmMpPayloadBenchmark (&Context);
+      break;
+
+    default:
+      DEBUG ((DEBUG_ERROR, "Unknown Mm Mp test id 0x%x!\n", TestId));
+      break;
+    }
+  }
+
+  //
+  // Everything carved from the scratch arena during this SMI is released here.
+  //
+  MmMpTestArenaReset ();
 
   return EFI_SUCCESS;
 }
@@ -781,6 +1355,7 @@ MmMpTestSwSmiCallback (
   @param[in] SystemTable - The standard EFI system table
 
   @retval EFI_SUCCESS - RapidStart S3 entry callback SMI handle has been registered when RapidStart wake up policy enabled
+  @retval EFI_OUT_OF_RESOURCES - No SMRAM for the scratch arena, the SW SMI handler is not registered
 **/
 EFI_STATUS
 EFIAPI
@@ -799,6 +1374,16 @@ MmMpTestSmmEntryPoint (
 
   InitializeSpinLock((SPIN_LOCK*) &mConsoleLock);
 
+  //
+  // Every test carves its buffers from the arena, without it there is no
+  // point in registering the handler.
+  //
+  Status = MmMpTestArenaInitialize (MM_MP_TEST_ARENA_SIZE);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Mm Mp Test: no SMRAM for the 0x%x byte scratch arena, %r!\n", MM_MP_TEST_ARENA_SIZE, Status));
+    return Status;
+  }
+
   Status = gSmst->SmmLocateProtocol (&gEfiSmmSwDispatch2ProtocolGuid, NULL, (VOID**)&SwDispatch);
   ASSERT_EFI_ERROR (Status);
 
@@ -0,0 +1,674 @@
+/** @file
+  Internal definitions shared by the source files of MmMpTestSmm.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_MP_TEST_SMM_H_
+#define _MM_MP_TEST_SMM_H_
+
+///
+/// External include files do NOT need to be explicitly specified in real EDKII
+/// environment
+///
+
+#include <PiDxe.h>
+#include <Protocol/SmmControl2.h>
+#include <Protocol/SmmSwDispatch2.h>
+#include <Protocol/MmMp.h>
+#include <Protocol/SmmCpuService.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/PciLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/SmmServicesTableLib.h>
+#include <Library/TimerLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PrintLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Library/MpWorkloadLib.h>
+#include <Library/MpPerCpuLib.h>
+#include <Library/MpShardedCounterLib.h>
+
+#include "MmMpTest.h"
+
+#define MM_MP_TEST_CACHE_LINE_SIZE        MP_BENCH_CACHE_LINE_SIZE
+
+//
+// Samples per measurement, PcdMmMpTestSamples divided by the relative cost
+// of one sample of the test.
+//
+#define MM_MP_TEST_SAMPLES(Divisor)       MAX (FixedPcdGet32 (PcdMmMpTestSamples) / (Divisor), 1)
+
+//
+// Size of the per-SMI scratch arena in SMRAM.
+//
+#define MM_MP_TEST_ARENA_SIZE             SIZE_256KB
+
+//
+// Buffer of the memory workload profiles: one slot per CPU of at most
+// PcdMmMpTestWorkloadSlotSize bytes, all slots within
+// MM_MP_TEST_WORKLOAD_BUDGET. Slots are not made smaller than
+// MM_MP_TEST_WORKLOAD_SLOT_MIN; with more CPUs than that allows, CPUs
+// share slots and the selection says so.
+//
+#define MM_MP_TEST_WORKLOAD_SLOT_SIZE     FixedPcdGet32 (PcdMmMpTestWorkloadSlotSize)
+#define MM_MP_TEST_WORKLOAD_BUDGET        SIZE_4MB
+#define MM_MP_TEST_WORKLOAD_SLOT_MIN      SIZE_16KB
+#define MM_MP_TEST_WORKLOAD_STREAM_MBPS   2000
+
+//
+// What every benchmark needs to know about the MM MP environment.
+//
+typedef struct {
+  EFI_MM_MP_PROTOCOL                *SmmMp;
+  EFI_SMM_CPU_SERVICE_PROTOCOL      *SmmCpu;
+  UINTN                             ProcessorNum;
+  UINTN                             BspIndex;
+  UINTN                             SelectedApIndex;
+} MM_MP_TEST_CONTEXT;
+
+//
+// Per CPU lines are printed up to MM_MP_TEST_DETAIL_CPUS processors, above
+// that they go to DEBUG_VERBOSE and only the summaries stay at DEBUG_INFO.
+//
+#define MM_MP_TEST_DETAIL_CPUS            16
+#define MM_MP_TEST_DETAIL_LEVEL(CpuCount) \
+  ((CpuCount) <= MM_MP_TEST_DETAIL_CPUS ? DEBUG_INFO : DEBUG_VERBOSE)
+
+//
+// Distinct failure statuses a MM_MP_TEST_RESULT keeps a CPU bitmap of, and
+// CPU ranges printed per bitmap.
+//
+#define MM_MP_TEST_RESULT_KINDS           8
+#define MM_MP_TEST_RESULT_RANGES          8
+
+//
+// Failure kind of the APs a procedure tracking MM_MP_TEST_RESULT never ran on.
+//
+#define MM_MP_TEST_RESULT_NOT_RUN         EFI_NOT_STARTED
+
+//
+// Results of one test over all CPUs, as bitmaps of UINT32 words, so the
+// report grows with the number of distinct failures rather than the number
+// of CPUs. Bitmaps are carved out of the scratch arena.
+//
+typedef struct {
+  EFI_SMM_CPU_SERVICE_PROTOCOL      *SmmCpu;
+  UINTN                             CpuCount;
+  UINTN                             BspIndex;
+  //
+  // CPUs the procedure ran on, set by MmMpTestResultMarkRan.
+  //
+  volatile UINT32                   *Ran;
+  UINT32                            *Failed;
+  UINTN                             FailedCount;
+  UINTN                             KindCount;
+  EFI_STATUS                        KindStatus[MM_MP_TEST_RESULT_KINDS];
+  UINT32                            *KindCpus[MM_MP_TEST_RESULT_KINDS];
+  UINTN                             KindTotal[MM_MP_TEST_RESULT_KINDS];
+  //
+  // Failures whose status found no free kind.
+  //
+  UINTN                             Untracked;
+} MM_MP_TEST_RESULT;
+
+//
+// Per CPU argument vector of a broadcast procedure. BroadcastProcedure hands
+// every AP the same argument, so the procedure is given the table and picks
+// its own entry by processor index. Entries are carved out of the scratch
+// arena, each on its own cache lines.
+//
+typedef struct {
+  EFI_SMM_CPU_SERVICE_PROTOCOL      *SmmCpu;
+  UINT8                             *Entry;
+  UINTN                             Stride;
+  UINTN                             Count;
+} MM_MP_TEST_ARGUMENT_TABLE;
+
+extern SPIN_LOCK    mConsoleLock;
+
+//
+// Body of the test procedures selected for the current SMI, NULL to spin.
+//
+extern MP_WORKLOAD  *mWorkload;
+
+//
+// Set when an AP did not come back from a timed out procedure. It may still
+// be running it, so no further test is started on this boot.
+//
+extern BOOLEAN      mMmMpTestApLost;
+
+/**
+  Calculate timeout value and return the current performance counter value.
+
+  @param[in]  TimeoutInMicroseconds   Timeout value in microseconds.
+  @param[out] CurrentTime             Returns the current value of the performance counter.
+
+  @return Expected time stamp counter for timeout, 0 for infinity.
+**/
+UINT64
+CalculateTimeout (
+  IN  UINTN   TimeoutInMicroseconds,
+  OUT UINT64  *CurrentTime
+  );
+
+/**
+  Checks whether timeout expires.
+
+  @param[in, out]  PreviousTime   The performance counter when it was last read.
+  @param[in]       TotalTime      The total amount of elapsed time in ticks.
+  @param[in]       Timeout        The number of ticks required to reach a timeout.
+
+  @retval TRUE                    A timeout condition has been reached.
+  @retval FALSE                   A timeout condition has not been reached.
+**/
+BOOLEAN
+CheckTimeout (
+  IN OUT UINT64  *PreviousTime,
+  IN     UINT64  *TotalTime,
+  IN     UINT64  Timeout
+  );
+
+/**
+  Busy wait for a number of microseconds, which must not be 0.
+
+  @param[in]  TimeoutInMicroseconds   Time to wait.
+**/
+VOID
+Sleep (
+  IN  UINTN   TimeoutInMicroseconds
+  );
+
+/**
+  Busy wait for a number of performance counter ticks.
+
+  @param[in]  Ticks   Number of performance counter ticks to wait.
+**/
+VOID
+SpinForTicks (
+  IN  UINT64  Ticks
+  );
+
+/**
+  Print a debug message while holding mConsoleLock, so APs and BSP do not
+  interleave their output.
+
+  @param[in]  ErrorLevel  The error level of the debug message.
+  @param[in]  Format      Format string for the debug message to print.
+  @param[in]  ...         Variable argument list.
+**/
+VOID
+EFIAPI
+DebugMsg (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  );
+
+/**
+  Run the body of a test procedure: the workload of the argument, or a
+  CpuPause spin without one.
+
+  @param[in]  Argument   The PROCEDURE_ARGUMENTS of the procedure.
+  @param[in]  Ticks      Performance counter ticks to run, 0 returns at once.
+**/
+VOID
+RunProcedureBody (
+  IN PROCEDURE_ARGUMENTS  *Argument,
+  IN UINT64               Ticks
+  );
+
+/**
+  Quiet procedure that only runs its body for Argument->SpinTicks.
+
+  @param[in]  ProcedureArgument   The PROCEDURE_ARGUMENTS of the caller.
+
+  @return Argument->MagicNumber.
+**/
+EFI_STATUS
+EFIAPI
+BoundaryProbeProcedure (
+  IN VOID  *ProcedureArgument
+  );
+
+//
+// Test procedures of MmMpTestSmm.c, see there.
+//
+EFI_STATUS
+EFIAPI
+SingleApSyncProcedure (
+  IN VOID  *ProcedureArgument
+  );
+
+EFI_STATUS
+EFIAPI
+MultipleApSyncProcedure (
+  IN VOID  *ProcedureArgument
+  );
+
+EFI_STATUS
+EFIAPI
+SingleApAsyncProcedure (
+  IN VOID  *ProcedureArgument
+  );
+
+EFI_STATUS
+EFIAPI
+MultipleApAsyncProcedure (
+  IN VOID  *ProcedureArgument
+  );
+
+/**
+  Allocate the scratch arena in SMRAM.
+
+  @param[in]  Size    Size of the arena in bytes.
+
+  @retval EFI_SUCCESS             The arena is ready.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM.
+**/
+EFI_STATUS
+MmMpTestArenaInitialize (
+  IN UINTN                          Size
+  );
+
+/**
+  Carve a cache line aligned block out of the scratch arena. The block is
+  valid until the end of the current SMI.
+
+  @param[in]  Size    Size of the block in bytes.
+
+  @return The block, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocate (
+  IN UINTN                          Size
+  );
+
+/**
+  Carve a zeroed, cache line aligned block out of the scratch arena.
+
+  @param[in]  Size    Size of the block in bytes.
+
+  @return The block, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocateZero (
+  IN UINTN                          Size
+  );
+
+/**
+  Carve one zeroed slot per CPU out of the scratch arena, each slot on its
+  own cache lines.
+
+  @param[in]  SizePerCpu    Size of one slot in bytes.
+  @param[in]  CpuCount      Number of slots.
+  @param[out] Stride        Distance between two slots in bytes.
+
+  @return The first slot, or NULL if the arena is exhausted.
+**/
+VOID *
+MmMpTestArenaAllocatePerCpu (
+  IN  UINTN                         SizePerCpu,
+  IN  UINTN                         CpuCount,
+  OUT UINTN                         *Stride
+  );
+
+/**
+  Build a zeroed argument table of one entry per CPU in the scratch arena.
+
+  @param[out] Table       The argument table.
+  @param[in]  SmmCpu      The SMM CPU service protocol.
+  @param[in]  CpuCount    Number of entries.
+  @param[in]  EntrySize   Size of one entry in bytes.
+
+  @retval EFI_SUCCESS             The table is ready.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is exhausted.
+**/
+EFI_STATUS
+MmMpTestArgumentTableCreate (
+  OUT MM_MP_TEST_ARGUMENT_TABLE     *Table,
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  IN  UINTN                         CpuCount,
+  IN  UINTN                         EntrySize
+  );
+
+/**
+  Return the argument table entry of a CPU.
+
+  @param[in]  Table       The argument table.
+  @param[in]  CpuIndex    The CPU.
+
+  @return The entry, or NULL if CpuIndex is out of range.
+**/
+VOID *
+MmMpTestArgumentOf (
+  IN CONST MM_MP_TEST_ARGUMENT_TABLE  *Table,
+  IN UINTN                            CpuIndex
+  );
+
+/**
+  Return the argument table entry of the calling CPU, from a procedure.
+
+  @param[in]  Table       The argument table.
+
+  @return The entry, or NULL if WhoAmI failed.
+**/
+VOID *
+MmMpTestArgumentSelf (
+  IN CONST MM_MP_TEST_ARGUMENT_TABLE  *Table
+  );
+
+/**
+  Release everything carved out of the scratch arena.
+**/
+VOID
+MmMpTestArenaReset (
+  VOID
+  );
+
+/**
+  Set up an empty result in the scratch arena.
+
+  @param[out] Result     The result.
+  @param[in]  SmmCpu     The SMM CPU service protocol, for WhoAmI.
+  @param[in]  CpuCount   Number of processors.
+  @param[in]  BspIndex   The BSP, which is not counted.
+
+  @retval EFI_SUCCESS             The result is empty.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+**/
+EFI_STATUS
+MmMpTestResultInitialize (
+  OUT MM_MP_TEST_RESULT             *Result,
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  IN  UINTN                         CpuCount,
+  IN  UINTN                         BspIndex
+  );
+
+/**
+  Mark the calling CPU in the Ran bitmap. Called by procedures, on any CPU.
+
+  @param[in]  Result   The result, may be NULL.
+**/
+VOID
+MmMpTestResultMarkRan (
+  IN MM_MP_TEST_RESULT              *Result
+  );
+
+/**
+  Record a failure of one CPU.
+
+  @param[in, out] Result     The result.
+  @param[in]      CpuIndex   The CPU.
+  @param[in]      Status     What the CPU returned, used as the failure kind.
+**/
+VOID
+MmMpTestResultFail (
+  IN OUT MM_MP_TEST_RESULT          *Result,
+  IN     UINTN                      CpuIndex,
+  IN     EFI_STATUS                 Status
+  );
+
+/**
+  Record every AP whose status differs from Expected, and with CheckRan
+  every AP missing from the Ran bitmap.
+
+  @param[in, out] Result        The result.
+  @param[in]      StatusArray   Per CPU status, may be NULL.
+  @param[in]      Expected      The expected status.
+  @param[in]      CheckRan      Whether the procedure marked Ran.
+**/
+VOID
+MmMpTestResultCheck (
+  IN OUT MM_MP_TEST_RESULT          *Result,
+  IN     CONST EFI_STATUS           *StatusArray,
+  IN     EFI_STATUS                 Expected,
+  IN     BOOLEAN                    CheckRan
+  );
+
+/**
+  Print a pass count and one line per failure kind with its CPU ranges.
+
+  @param[in]  Result   The result.
+  @param[in]  Label    Prefix of the lines.
+**/
+VOID
+MmMpTestResultPrint (
+  IN CONST MM_MP_TEST_RESULT        *Result,
+  IN CONST CHAR8                    *Label
+  );
+
+/**
+  Compare the scratch arena with the SMM pool for the allocations one SMI of
+  the tests does.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The pool or the arena ran out of memory.
+**/
+EFI_STATUS
+SmmMpArenaBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Measure the stack peak of every test procedure on every AP.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS   All procedures ran on all APs.
+  @retval Others        A dispatch failed.
+**/
+EFI_STATUS
+SmmMpStackBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Measure the blocking DispatchProcedure round trip from the BSP to every AP
+  and report it per AP and per topology group.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS   All APs were measured.
+  @retval Others        GetProcessorInfo or a dispatch failed.
+**/
+EFI_STATUS
+SmmMpTopologyBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Measure the cache line round trip between every pair of CPUs and print the
+  latency matrix.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The matrix was printed.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A dispatch failed.
+**/
+EFI_STATUS
+SmmMpPingPongBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Measure the scalar, SSE2 and AVX2 kernels with their extended state save
+  on the selected AP, and report the payload from which each vector path is
+  a net win.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval EFI_UNSUPPORTED         Not built for X64.
+  @retval Others                  A dispatch failed.
+**/
+EFI_STATUS
+SmmMpSimdBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Build the per CPU table from the APIC IDs of GetProcessorInfo, unless it
+  exists for the same number of processors.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The table is ready.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM.
+  @retval Others                  GetProcessorInfo failed.
+**/
+EFI_STATUS
+MmMpTestPerCpuInitialize (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Return the index of the calling CPU, from the per CPU table once built,
+  from WhoAmI before. Callable on any CPU.
+
+  @param[in]  SmmCpu     The SMM CPU service protocol.
+  @param[out] CpuIndex   The index.
+
+  @retval EFI_SUCCESS   CpuIndex is valid.
+  @retval Others        WhoAmI failed.
+**/
+EFI_STATUS
+MmMpTestWhoAmI (
+  IN  EFI_SMM_CPU_SERVICE_PROTOCOL  *SmmCpu,
+  OUT UINTN                         *CpuIndex
+  );
+
+/**
+  Measure the cost of WhoAmI and of the per CPU table on every CPU, and
+  check that both give the same index.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM or scratch arena.
+  @retval Others                  The table could not be built.
+**/
+EFI_STATUS
+SmmMpPerCpuBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Compare InterlockedIncrement of one shared counter with a sharded
+  counter, for 1, 2, 4 ... and all APs counting at once.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A broadcast failed, or events were lost.
+**/
+EFI_STATUS
+SmmMpCounterBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Time DispatchProcedure to the selected AP and BroadcastProcedure to all
+  APs with warm caches, after WBINVD and after an eviction buffer walk, and
+  print the latencies side by side.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    No SMRAM for the eviction buffer.
+  @retval Others                  A dispatch or broadcast failed.
+**/
+EFI_STATUS
+SmmMpColdCacheBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Broadcast a copy of a per AP payload from 64 bytes to megabytes, read from
+  one shared buffer, from per AP copies and from per AP slices of one buffer,
+  and report completion time and bandwidth.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    No SMRAM for the payload buffer.
+  @retval Others                  A broadcast failed.
+**/
+EFI_STATUS
+SmmMpPayloadBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Measure the TSC offset and its error bound of every AP relative to the
+  BSP, keep them for MmMpTestTscToBsp and print them.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The offsets were measured.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM or scratch arena.
+**/
+EFI_STATUS
+SmmMpTscSkewBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Broadcast work drawn from each distribution and report the completion
+  time against the ideal of a balanced split.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES    The scratch arena is too small.
+  @retval Others                  A broadcast failed.
+**/
+EFI_STATUS
+SmmMpImbalanceBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+/**
+  Translate a TSC value read on a CPU to the BSP TSC, with the offsets of
+  the last SmmMpTscSkewBenchmark run.
+
+  @param[in]  CpuIndex   The CPU the value was read on.
+  @param[in]  Tsc        The value.
+
+  @return The BSP TSC value, or Tsc unchanged if the CPU was not measured.
+**/
+UINT64
+MmMpTestTscToBsp (
+  IN UINTN                          CpuIndex,
+  IN UINT64                         Tsc
+  );
+
+/**
+  Measure how accurately DispatchProcedure and BroadcastProcedure enforce
+  TimeoutInMicroseconds, and what it costs to reuse the APs afterwards.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS       The benchmark ran.
+  @retval EFI_UNSUPPORTED   The MM MP protocol does not support timeouts.
+**/
+EFI_STATUS
+SmmMpTimeoutBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  );
+
+#endif
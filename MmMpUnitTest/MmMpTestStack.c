@@ -0,0 +1,193 @@
+/** @file
+  Stack usage of the MM MP test procedures.
+
+  Every procedure is dispatched to every AP through a wrapper that paints the
+  AP stack before calling it and scans for the high watermark afterwards. The
+  peak of each procedure, and of the DebugMsg logging path on its own, is
+  what PcdCpuSmmStackSize has to cover.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Only the lower half of the SMM stack is painted: the wrapper does not know
+// how deep its own frame is, and painting below the stack bottom would
+// corrupt the stack of the neighbouring CPU.
+//
+#define MM_MP_TEST_STACK_PAINT_SIZE   (PcdGet32 (PcdCpuSmmStackSize) / 2)
+
+typedef struct {
+  EFI_AP_PROCEDURE2              Procedure;
+  VOID                           *Argument;
+  UINTN                          PaintSize;
+  UINTN                          Used;
+} MM_MP_TEST_STACK_PROBE;
+
+typedef struct {
+  CONST CHAR8                    *Name;
+  EFI_AP_PROCEDURE2              Procedure;
+} MM_MP_TEST_STACK_ENTRY;
+
+/**
+  Procedure doing nothing but one DebugMsg call with the widest argument list
+  the tests print, to isolate the stack cost of the logging path.
+
+  @param[in]  ProcedureArgument   The PROCEDURE_ARGUMENTS of the caller.
+
+  @return Argument->MagicNumber.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+LoggingPathProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PROCEDURE_ARGUMENTS            *Argument;
+
+  Argument = (PROCEDURE_ARGUMENTS *)ProcedureArgument;
+
+  DebugMsg (
+    DEBUG_INFO,
+    "    Stack probe %a, MagicNum = 0x%x, Processor Index = 0x%x, SpinTicks = %ld!\n",
+    "logging path",
+    Argument->MagicNumber,
+    Argument->ProcessorIndex,
+    Argument->SpinTicks
+    );
+
+  return Argument->MagicNumber;
+}
+
+STATIC CONST MM_MP_TEST_STACK_ENTRY  mStackEntries[] = {
+  { "BoundaryProbeProcedure",   BoundaryProbeProcedure   },
+  { "SingleApSyncProcedure",    SingleApSyncProcedure    },
+  { "MultipleApSyncProcedure",  MultipleApSyncProcedure  },
+  { "SingleApAsyncProcedure",   SingleApAsyncProcedure   },
+  { "MultipleApAsyncProcedure", MultipleApAsyncProcedure },
+  { "DebugMsg logging path",    LoggingPathProcedure     }
+};
+
+/**
+  Wrapper run on the AP: paint the stack, run the procedure, scan the stack.
+
+  @param[in]  ProcedureArgument   The MM_MP_TEST_STACK_PROBE to run.
+
+  @return The status of the wrapped procedure.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+StackProbeProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MM_MP_TEST_STACK_PROBE         *Probe;
+  MP_BENCH_STACK_PAINT           Paint;
+  EFI_STATUS                     Status;
+
+  Probe = (MM_MP_TEST_STACK_PROBE *)ProcedureArgument;
+
+  MpBenchStackPaint (&Paint, Probe->PaintSize);
+  Status = Probe->Procedure (Probe->Argument);
+  Probe->Used = MpBenchStackScan (&Paint);
+
+  return Status;
+}
+
+/**
+  Measure the stack peak of every test procedure on every AP.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS   All procedures ran on all APs.
+  @retval Others        A dispatch failed.
+**/
+EFI_STATUS
+SmmMpStackBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MM_MP_TEST_STACK_PROBE         Probe;
+  PROCEDURE_ARGUMENTS            Argument;
+  MP_BENCH_STATS                 Stats;
+  UINTN                          Entry;
+  UINTN                          Index;
+  UINTN                          Overflows;
+  UINTN                          PeakAp;
+  UINT64                         Quiet;
+  UINT64                         Logging;
+
+  Probe.Argument  = &Argument;
+  Probe.PaintSize = MM_MP_TEST_STACK_PAINT_SIZE;
+  Quiet   = 0;
+  Logging = 0;
+
+  DEBUG ((DEBUG_INFO, "Stack usage of MM MP procedures, 0x%x of 0x%x bytes painted\n", Probe.PaintSize, PcdGet32 (PcdCpuSmmStackSize)));
+
+  for (Entry = 0; Entry < ARRAY_SIZE (mStackEntries); Entry++) {
+    MpBenchStatsReset (&Stats);
+    Probe.Procedure = mStackEntries[Entry].Procedure;
+    Overflows = 0;
+    PeakAp    = 0;
+
+    for (Index = 0; Index < Context->ProcessorNum; Index++) {
+      if (Index == Context->BspIndex) {
+        continue;
+      }
+
+      Argument.MagicNumber    = 0x5000 + (UINT32) Entry;
+      Argument.ProcessorIndex = (UINT32) Index;
+      Argument.SleepTime      = 1;
+      Argument.SpinTicks      = 0;
+      Argument.Workload       = mWorkload;
+      Argument.Result         = NULL;
+      Probe.Used              = 0;
+
+      Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, StackProbeProcedure, Index, 0, &Probe, NULL, NULL);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Stack %a: DispatchProcedure to Ap 0x%x failed, %r!\n", mStackEntries[Entry].Name, Index, Status));
+        return Status;
+      }
+
+      if (Probe.Used == MP_BENCH_STACK_OVERFLOW) {
+        Overflows++;
+        continue;
+      }
+      if (Probe.Used > Stats.Max) {
+        PeakAp = Index;
+      }
+      MpBenchStatsAdd (&Stats, Probe.Used);
+    }
+
+    MpBenchStatsPrint (DEBUG_INFO, mStackEntries[Entry].Name, "bytes", &Stats);
+    if (Stats.Count != 0) {
+      DEBUG ((DEBUG_INFO, "  peak on Ap 0x%x\n", PeakAp));
+    }
+    if (Overflows != 0) {
+      DEBUG ((DEBUG_ERROR, "  %d APs used the whole painted window, the peak is above 0x%x bytes!\n", Overflows, Probe.PaintSize));
+    }
+
+    if (mStackEntries[Entry].Procedure == BoundaryProbeProcedure) {
+      Quiet = Stats.Max;
+    } else if (mStackEntries[Entry].Procedure == LoggingPathProcedure) {
+      Logging = Stats.Max;
+    }
+  }
+
+  //
+  // The wrapper frame is part of every figure, the quiet procedure is the
+  // closest thing to an empty one.
+  //
+  if (Logging > Quiet) {
+    DEBUG ((DEBUG_INFO, "DebugMsg logging path adds %ld bytes over the quiet procedure\n", Logging - Quiet));
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,434 @@
+/** @file
+  Timeout enforcement accuracy of the MM MP protocol.
+
+  Procedures that overrun TimeoutInMicroseconds are dispatched to one AP and
+  broadcast to all APs. For every timeout value the benchmark reports how late
+  EFI_TIMEOUT is returned, in which state the APs are left, and how long it
+  takes until they accept the next procedure.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Samples per timeout value, and how many times longer than the timeout
+// the dispatched procedure runs.
+//
+#define MM_MP_TEST_TIMEOUT_SAMPLES          MM_MP_TEST_SAMPLES (4)
+#define MM_MP_TEST_TIMEOUT_OVERRUN          4
+
+//
+// Stop waiting for an AP to come back after this many procedure durations.
+//
+#define MM_MP_TEST_TIMEOUT_RECOVERY_LIMIT   16
+
+//
+// Written to CPUStatus before each call, so untouched entries can be told apart.
+//
+#define MM_MP_TEST_TIMEOUT_NO_STATUS        EFI_NOT_STARTED
+
+STATIC CONST UINTN  mTimeoutPointsUs[] = {
+  10, 50, 100, 500, 1000, 5000
+};
+
+//
+// Argument, procedure status and CPU status array of the timed out
+// procedures. An AP still running one may write them at any time, so they
+// live outside the stack and the scratch arena, and once an AP does not
+// come back mMmMpTestApLost stops the tests before they are reused.
+//
+STATIC PROCEDURE_ARGUMENTS  mTimeoutArgument;
+STATIC EFI_STATUS           mTimeoutProcedureStatus;
+STATIC EFI_STATUS           *mTimeoutStatusArray;
+STATIC UINTN                mTimeoutStatusCount;
+
+/**
+  Wait until the AP, or all APs, accept a new procedure after a timeout.
+
+  @param[in]  SmmMp         The MM MP protocol.
+  @param[in]  CpuNumber     The AP, or MAX_UINTN to wait for all APs.
+  @param[in]  LimitTicks    Give up after that many performance counter ticks.
+  @param[out] BusyPolls     Number of EFI_NOT_READY answers before acceptance.
+  @param[out] RecoveryNs    Time until the no-op procedure completed.
+
+  @retval EFI_SUCCESS       The no-op procedure ran.
+  @retval EFI_TIMEOUT       The APs stayed busy for longer than LimitTicks.
+  @retval Others            The dispatch failed.
+**/
+STATIC
+EFI_STATUS
+SmmMpTimeoutRecover (
+  IN  EFI_MM_MP_PROTOCOL                *SmmMp,
+  IN  UINTN                             CpuNumber,
+  IN  UINT64                            LimitTicks,
+  OUT UINTN                             *BusyPolls,
+  OUT UINT64                            *RecoveryNs
+  )
+{
+  EFI_STATUS                     Status;
+  PROCEDURE_ARGUMENTS            NoOp;
+  UINT64                         Start;
+  UINT64                         Now;
+
+  NoOp.MagicNumber    = 0x50;
+  NoOp.ProcessorIndex = (UINT32) CpuNumber;
+  NoOp.SleepTime      = 0;
+  NoOp.SpinTicks      = 0;
+  NoOp.Workload       = NULL;
+
+  *BusyPolls = 0;
+  Start      = GetPerformanceCounter ();
+  while (TRUE) {
+    if (CpuNumber == MAX_UINTN) {
+      Status = SmmMp->BroadcastProcedure (SmmMp, BoundaryProbeProcedure, 0, &NoOp, NULL, NULL);
+    } else {
+      Status = SmmMp->DispatchProcedure (SmmMp, BoundaryProbeProcedure, CpuNumber, 0, &NoOp, NULL, NULL);
+    }
+    Now = GetPerformanceCounter ();
+    if (Status != EFI_NOT_READY) {
+      break;
+    }
+
+    (*BusyPolls)++;
+    if (MpBenchElapsedTicks (Start, Now) > LimitTicks) {
+      Status = EFI_TIMEOUT;
+      break;
+    }
+    CpuPause ();
+  }
+
+  *RecoveryNs = MpBenchElapsedNs (Start, Now);
+  return Status;
+}
+
+/**
+  Dispatch an overrunning procedure to the selected AP with one timeout value.
+
+  @param[in]  Context     The MM MP test context.
+  @param[in]  TimeoutUs   The timeout passed to DispatchProcedure.
+
+  @retval EFI_SUCCESS     All samples ran.
+  @retval Others          A dispatch failed or the AP never came back.
+**/
+STATIC
+EFI_STATUS
+SmmMpDispatchTimeoutPoint (
+  IN MM_MP_TEST_CONTEXT             *Context,
+  IN UINTN                          TimeoutUs
+  )
+{
+  EFI_STATUS                     Status;
+  MP_BENCH_STATS                 Late;
+  MP_BENCH_STATS                 Recovery;
+  MP_BENCH_STATS                 Busy;
+  UINT64                         CurrentTime;
+  UINT64                         TimeoutNs;
+  UINT64                         ElapsedNs;
+  UINT64                         RecoveryNs;
+  UINT64                         Start;
+  UINT64                         End;
+  UINTN                          BusyPolls;
+  UINTN                          Sample;
+  UINT32                         Timeouts;
+  UINT32                         Early;
+  UINT32                         Completed;
+  UINT32                         Finished;
+  UINT32                         Reported;
+  UINT32                         NoStatus;
+
+  mTimeoutArgument.MagicNumber    = 0x40;
+  mTimeoutArgument.ProcessorIndex = (UINT32) Context->SelectedApIndex;
+  mTimeoutArgument.SleepTime      = 0;
+  mTimeoutArgument.SpinTicks      = MultU64x32 (CalculateTimeout (TimeoutUs, &CurrentTime), MM_MP_TEST_TIMEOUT_OVERRUN);
+  mTimeoutArgument.Workload       = mWorkload;
+  TimeoutNs                       = MultU64x32 (TimeoutUs, 1000);
+
+  MpBenchStatsReset (&Late);
+  MpBenchStatsReset (&Recovery);
+  MpBenchStatsReset (&Busy);
+  Timeouts  = 0;
+  Early     = 0;
+  Completed = 0;
+  Finished  = 0;
+  Reported  = 0;
+  NoStatus  = 0;
+
+  for (Sample = 0; Sample < MM_MP_TEST_TIMEOUT_SAMPLES; Sample++) {
+    mTimeoutProcedureStatus = MM_MP_TEST_TIMEOUT_NO_STATUS;
+
+    Start  = GetPerformanceCounter ();
+    Status = Context->SmmMp->DispatchProcedure (
+                               Context->SmmMp,
+                               BoundaryProbeProcedure,
+                               Context->SelectedApIndex,
+                               TimeoutUs,
+                               &mTimeoutArgument,
+                               NULL,
+                               &mTimeoutProcedureStatus
+                               );
+    End    = GetPerformanceCounter ();
+
+    if (Status == EFI_SUCCESS) {
+      //
+      // The timeout was not enforced, the procedure ran to its end.
+      //
+      Completed++;
+      continue;
+    }
+    if (Status != EFI_TIMEOUT) {
+      DEBUG ((DEBUG_ERROR, "Timeout Dispatch %ld us: DispatchProcedure return %r!\n", (UINT64) TimeoutUs, Status));
+      return Status;
+    }
+
+    Timeouts++;
+    ElapsedNs = MpBenchElapsedNs (Start, End);
+    if (ElapsedNs < TimeoutNs) {
+      Early++;
+      MpBenchStatsAdd (&Late, 0);
+    } else {
+      MpBenchStatsAdd (&Late, ElapsedNs - TimeoutNs);
+    }
+
+    //
+    // The AP is still running the procedure at this point and writes
+    // mTimeoutArgument and mTimeoutProcedureStatus until it is back.
+    //
+    Status = SmmMpTimeoutRecover (
+               Context->SmmMp,
+               Context->SelectedApIndex,
+               MultU64x32 (mTimeoutArgument.SpinTicks, MM_MP_TEST_TIMEOUT_RECOVERY_LIMIT),
+               &BusyPolls,
+               &RecoveryNs
+               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Timeout Dispatch %ld us: Ap 0x%x did not come back, %r!\n", (UINT64) TimeoutUs, Context->SelectedApIndex, Status));
+      mMmMpTestApLost = TRUE;
+      return Status;
+    }
+    MpBenchStatsAdd (&Recovery, RecoveryNs);
+    MpBenchStatsAdd (&Busy, BusyPolls);
+
+    if (mTimeoutProcedureStatus == (EFI_STATUS) mTimeoutArgument.MagicNumber) {
+      Finished++;
+    } else if (mTimeoutProcedureStatus == EFI_TIMEOUT) {
+      Reported++;
+    } else {
+      NoStatus++;
+    }
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Timeout Dispatch Ap 0x%x %ld us: %d EFI_TIMEOUT (%d early), %d completed; procedure after timeout: %d ran to end, %d EFI_TIMEOUT, %d no status\n",
+    Context->SelectedApIndex,
+    (UINT64) TimeoutUs,
+    Timeouts,
+    Early,
+    Completed,
+    Finished,
+    Reported,
+    NoStatus
+    ));
+  MpBenchStatsPrint (DEBUG_INFO, "  lateness", "ns", &Late);
+  MpBenchStatsPrintHistogram (DEBUG_INFO, "  lateness", "ns", &Late);
+  MpBenchStatsPrint (DEBUG_INFO, "  recovery", "ns", &Recovery);
+  MpBenchStatsPrint (DEBUG_INFO, "  busy polls", "polls", &Busy);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Broadcast an overrunning procedure to all APs with one timeout value.
+
+  @param[in]  Context     The MM MP test context.
+  @param[in]  TimeoutUs   The timeout passed to BroadcastProcedure.
+
+  @retval EFI_SUCCESS     All samples ran.
+  @retval Others          A broadcast failed or the APs never came back.
+**/
+STATIC
+EFI_STATUS
+SmmMpBroadcastTimeoutPoint (
+  IN MM_MP_TEST_CONTEXT             *Context,
+  IN UINTN                          TimeoutUs
+  )
+{
+  EFI_STATUS                     Status;
+  MP_BENCH_STATS                 Late;
+  MP_BENCH_STATS                 Recovery;
+  MP_BENCH_STATS                 Busy;
+  UINT64                         CurrentTime;
+  UINT64                         TimeoutNs;
+  UINT64                         ElapsedNs;
+  UINT64                         RecoveryNs;
+  UINT64                         Start;
+  UINT64                         End;
+  UINTN                          BusyPolls;
+  UINTN                          Sample;
+  UINTN                          Index;
+  UINT32                         Timeouts;
+  UINT32                         Early;
+  UINT32                         Completed;
+  UINT32                         Finished;
+  UINT32                         Reported;
+  UINT32                         NoStatus;
+
+  if (mTimeoutStatusCount < Context->ProcessorNum) {
+    //
+    // Never freed, an array an AP may still write is never handed back.
+    //
+    mTimeoutStatusArray = AllocatePool (sizeof (EFI_STATUS) * Context->ProcessorNum);
+    if (mTimeoutStatusArray == NULL) {
+      mTimeoutStatusCount = 0;
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mTimeoutStatusCount = Context->ProcessorNum;
+  }
+
+  mTimeoutArgument.MagicNumber    = 0x40;
+  mTimeoutArgument.ProcessorIndex = (UINT32) Context->ProcessorNum;
+  mTimeoutArgument.SleepTime      = 0;
+  mTimeoutArgument.SpinTicks      = MultU64x32 (CalculateTimeout (TimeoutUs, &CurrentTime), MM_MP_TEST_TIMEOUT_OVERRUN);
+  mTimeoutArgument.Workload       = mWorkload;
+  TimeoutNs                       = MultU64x32 (TimeoutUs, 1000);
+
+  MpBenchStatsReset (&Late);
+  MpBenchStatsReset (&Recovery);
+  MpBenchStatsReset (&Busy);
+  Timeouts  = 0;
+  Early     = 0;
+  Completed = 0;
+  Finished  = 0;
+  Reported  = 0;
+  NoStatus  = 0;
+
+  for (Sample = 0; Sample < MM_MP_TEST_TIMEOUT_SAMPLES; Sample++) {
+    for (Index = 0; Index < Context->ProcessorNum; Index++) {
+      mTimeoutStatusArray[Index] = MM_MP_TEST_TIMEOUT_NO_STATUS;
+    }
+
+    Start  = GetPerformanceCounter ();
+    Status = Context->SmmMp->BroadcastProcedure (
+                               Context->SmmMp,
+                               BoundaryProbeProcedure,
+                               TimeoutUs,
+                               &mTimeoutArgument,
+                               NULL,
+                               mTimeoutStatusArray
+                               );
+    End    = GetPerformanceCounter ();
+
+    if (Status == EFI_SUCCESS) {
+      Completed++;
+      continue;
+    }
+    if (Status != EFI_TIMEOUT) {
+      DEBUG ((DEBUG_ERROR, "Timeout Broadcast %ld us: BroadcastProcedure return %r!\n", (UINT64) TimeoutUs, Status));
+      return Status;
+    }
+
+    Timeouts++;
+    ElapsedNs = MpBenchElapsedNs (Start, End);
+    if (ElapsedNs < TimeoutNs) {
+      Early++;
+      MpBenchStatsAdd (&Late, 0);
+    } else {
+      MpBenchStatsAdd (&Late, ElapsedNs - TimeoutNs);
+    }
+
+    //
+    // State of every AP at the moment EFI_TIMEOUT was returned.
+    //
+    for (Index = 0; Index < Context->ProcessorNum; Index++) {
+      if (Index == Context->BspIndex) {
+        continue;
+      }
+      if (mTimeoutStatusArray[Index] == (EFI_STATUS) mTimeoutArgument.MagicNumber) {
+        Finished++;
+      } else if (mTimeoutStatusArray[Index] == EFI_TIMEOUT) {
+        Reported++;
+      } else {
+        NoStatus++;
+      }
+    }
+
+    Status = SmmMpTimeoutRecover (
+               Context->SmmMp,
+               MAX_UINTN,
+               MultU64x32 (mTimeoutArgument.SpinTicks, MM_MP_TEST_TIMEOUT_RECOVERY_LIMIT),
+               &BusyPolls,
+               &RecoveryNs
+               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Timeout Broadcast %ld us: APs did not come back, %r!\n", (UINT64) TimeoutUs, Status));
+      mMmMpTestApLost = TRUE;
+      return Status;
+    }
+    MpBenchStatsAdd (&Recovery, RecoveryNs);
+    MpBenchStatsAdd (&Busy, BusyPolls);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Timeout Broadcast %ld us: %d EFI_TIMEOUT (%d early), %d completed; AP status at timeout: %d finished, %d EFI_TIMEOUT, %d no status\n",
+    (UINT64) TimeoutUs,
+    Timeouts,
+    Early,
+    Completed,
+    Finished,
+    Reported,
+    NoStatus
+    ));
+  MpBenchStatsPrint (DEBUG_INFO, "  lateness", "ns", &Late);
+  MpBenchStatsPrintHistogram (DEBUG_INFO, "  lateness", "ns", &Late);
+  MpBenchStatsPrint (DEBUG_INFO, "  recovery", "ns", &Recovery);
+  MpBenchStatsPrint (DEBUG_INFO, "  busy polls", "polls", &Busy);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Measure how accurately DispatchProcedure and BroadcastProcedure enforce
+  TimeoutInMicroseconds, and what it costs to reuse the APs afterwards.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS       The benchmark ran.
+  @retval EFI_UNSUPPORTED   The MM MP protocol does not support timeouts.
+**/
+EFI_STATUS
+SmmMpTimeoutBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  UINTN                          Index;
+
+  if ((Context->SmmMp->Attributes & EFI_MM_MP_TIMEOUT_SUPPORTED) == 0) {
+    DEBUG ((DEBUG_ERROR, "Timeout: MM MP protocol does not support timeouts, Attributes = 0x%x!\n", Context->SmmMp->Attributes));
+    return EFI_UNSUPPORTED;
+  }
+
+  DEBUG ((DEBUG_INFO, "Timeout benchmark, procedures run %d times the timeout.\n", MM_MP_TEST_TIMEOUT_OVERRUN));
+
+  for (Index = 0; Index < ARRAY_SIZE (mTimeoutPointsUs); Index++) {
+    Status = SmmMpDispatchTimeoutPoint (Context, mTimeoutPointsUs[Index]);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  for (Index = 0; Index < ARRAY_SIZE (mTimeoutPointsUs); Index++) {
+    Status = SmmMpBroadcastTimeoutPoint (Context, mTimeoutPointsUs[Index]);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
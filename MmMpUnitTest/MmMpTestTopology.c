@@ -0,0 +1,186 @@
+/** @file
+  DispatchProcedure latency by processor topology.
+
+  The BSP dispatches a quiet procedure to every AP in blocking mode and
+  groups the round trip latencies by where the AP sits relative to the BSP:
+  SMT sibling of the BSP, other core of the BSP package, or another package.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+//
+// Timed round trips per AP, after one untimed warm-up dispatch.
+//
+#define MM_MP_TEST_TOPOLOGY_SAMPLES   MM_MP_TEST_SAMPLES (1)
+
+typedef enum {
+  TopologySmtSibling,
+  TopologySamePackage,
+  TopologyRemotePackage,
+  TopologyMax
+} MM_MP_TEST_TOPOLOGY_GROUP;
+
+STATIC CONST CHAR8  *mTopologyGroupName[TopologyMax] = {
+  "SMT sibling",
+  "same package",
+  "remote package"
+};
+
+/**
+  Classify an AP relative to the BSP.
+
+  @param[in]  Bsp   Location of the BSP.
+  @param[in]  Ap    Location of the AP.
+
+  @return The topology group of the AP.
+**/
+STATIC
+MM_MP_TEST_TOPOLOGY_GROUP
+SmmMpTopologyGroup (
+  IN CONST EFI_CPU_PHYSICAL_LOCATION    *Bsp,
+  IN CONST EFI_CPU_PHYSICAL_LOCATION    *Ap
+  )
+{
+  if (Ap->Package != Bsp->Package) {
+    return TopologyRemotePackage;
+  }
+  if (Ap->Core != Bsp->Core) {
+    return TopologySamePackage;
+  }
+  return TopologySmtSibling;
+}
+
+/**
+  Measure the blocking DispatchProcedure round trip from the BSP to every AP
+  and report it per AP and per topology group.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS   All APs were measured.
+  @retval Others        GetProcessorInfo or a dispatch failed.
+**/
+EFI_STATUS
+SmmMpTopologyBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_PROCESSOR_INFORMATION      BspInfo;
+  EFI_PROCESSOR_INFORMATION      ApInfo;
+  PROCEDURE_ARGUMENTS            Argument;
+  MP_BENCH_STATS                 ApStats;
+  MP_BENCH_STATS                 GroupStats[TopologyMax];
+  UINT64                         BestMean[TopologyMax];
+  UINTN                          BestAp[TopologyMax];
+  MM_MP_TEST_TOPOLOGY_GROUP      Group;
+  MM_MP_TEST_TOPOLOGY_GROUP      SelectedGroup;
+  UINTN                          Index;
+  UINTN                          Sample;
+  UINT64                         Start;
+  UINT64                         Mean;
+
+  Status = Context->SmmCpu->GetProcessorInfo (Context->SmmCpu, Context->BspIndex, &BspInfo);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Topology: GetProcessorInfo of the BSP failed, %r!\n", Status));
+    return Status;
+  }
+
+  for (Group = 0; Group < TopologyMax; Group++) {
+    MpBenchStatsReset (&GroupStats[Group]);
+    BestMean[Group] = MAX_UINT64;
+    BestAp[Group]   = 0;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Topology dispatch latency, Bsp 0x%x at Package %d Core %d Thread %d, %d samples per Ap\n",
+    Context->BspIndex,
+    BspInfo.Location.Package,
+    BspInfo.Location.Core,
+    BspInfo.Location.Thread,
+    MM_MP_TEST_TOPOLOGY_SAMPLES
+    ));
+
+  SelectedGroup        = TopologyMax;
+  Argument.MagicNumber = 0x60;
+  Argument.SleepTime   = 0;
+  Argument.SpinTicks   = 0;
+  Argument.Workload    = NULL;
+
+  for (Index = 0; Index < Context->ProcessorNum; Index++) {
+    if (Index == Context->BspIndex) {
+      continue;
+    }
+
+    Status = Context->SmmCpu->GetProcessorInfo (Context->SmmCpu, Index, &ApInfo);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Topology: GetProcessorInfo of Ap 0x%x failed, %r!\n", Index, Status));
+      return Status;
+    }
+    Group = SmmMpTopologyGroup (&BspInfo.Location, &ApInfo.Location);
+    if (Index == Context->SelectedApIndex) {
+      SelectedGroup = Group;
+    }
+
+    Argument.ProcessorIndex = (UINT32) Index;
+    Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, BoundaryProbeProcedure, Index, 0, &Argument, NULL, NULL);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Topology: DispatchProcedure to Ap 0x%x failed, %r!\n", Index, Status));
+      return Status;
+    }
+
+    MpBenchStatsReset (&ApStats);
+    for (Sample = 0; Sample < MM_MP_TEST_TOPOLOGY_SAMPLES; Sample++) {
+      Start  = GetPerformanceCounter ();
+      Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, BoundaryProbeProcedure, Index, 0, &Argument, NULL, NULL);
+      MpBenchStatsAdd (&ApStats, MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_ERROR, "Topology: DispatchProcedure to Ap 0x%x failed, %r!\n", Index, Status));
+        return Status;
+      }
+    }
+
+    Mean = MpBenchStatsMean (&ApStats);
+    DEBUG ((
+      MM_MP_TEST_DETAIL_LEVEL (Context->ProcessorNum),
+      "  Ap 0x%x Package %d Core %d Thread %d, %a: min %ld ns, mean %ld ns, p99 %ld ns\n",
+      Index,
+      ApInfo.Location.Package,
+      ApInfo.Location.Core,
+      ApInfo.Location.Thread,
+      mTopologyGroupName[Group],
+      ApStats.Min,
+      Mean,
+      MpBenchStatsPercentile (&ApStats, 99)
+      ));
+
+    MpBenchStatsMerge (&GroupStats[Group], &ApStats);
+    if (Mean < BestMean[Group]) {
+      BestMean[Group] = Mean;
+      BestAp[Group]   = Index;
+    }
+  }
+
+  for (Group = 0; Group < TopologyMax; Group++) {
+    if (GroupStats[Group].Count == 0) {
+      DEBUG ((DEBUG_INFO, "%a: no Ap\n", mTopologyGroupName[Group]));
+      continue;
+    }
+    MpBenchStatsPrint (DEBUG_INFO, mTopologyGroupName[Group], "ns", &GroupStats[Group]);
+    DEBUG ((DEBUG_INFO, "  fastest Ap 0x%x, mean %ld ns\n", BestAp[Group], BestMean[Group]));
+  }
+
+  //
+  // SelectedApIndex is what the verification tests use, it is picked by index only.
+  //
+  if (SelectedGroup < TopologyMax) {
+    DEBUG ((DEBUG_INFO, "SelectedApIndex 0x%x is a %a of the Bsp\n", Context->SelectedApIndex, mTopologyGroupName[SelectedGroup]));
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,232 @@
+/** @file
+  TSC offset of every AP relative to the BSP in SMM.
+
+  Each AP in turn is started with DispatchProcedure in non-blocking mode to
+  answer TSC exchange requests of the BSP, see MpBenchTscExchangeMeasure.
+  The offsets are kept in SMRAM across SMIs, so benchmarks comparing TSC
+  stamps of different CPUs can translate them with MmMpTestTscToBsp once
+  this test has run.
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MmMpTestSmm.h"
+
+#define MM_MP_TEST_TSC_ROUNDS           FixedPcdGet32 (PcdMpBenchTscRounds)
+#define MM_MP_TEST_TSC_TIMEOUT_US       10000
+
+//
+// Time used to relate the TSC to the performance counter.
+//
+#define MM_MP_TEST_TSC_CALIBRATE_US     1000
+
+//
+// Offset of every CPU to the BSP from the last run, NULL before the first.
+//
+STATIC MP_BENCH_TSC_OFFSET  *mTscOffset;
+STATIC UINTN                mTscOffsetCount;
+
+/**
+  Answer the TSC exchange of the BSP.
+
+  @param[in]  ProcedureArgument   The MP_BENCH_TSC_EXCHANGE of this CPU.
+
+  @return EFI_SUCCESS.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+TscExchangeProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  MpBenchTscExchangeServe ((MP_BENCH_TSC_EXCHANGE *)ProcedureArgument);
+  return EFI_SUCCESS;
+}
+
+/**
+  Translate a TSC value read on a CPU to the BSP TSC, with the offsets of
+  the last SmmMpTscSkewBenchmark run.
+
+  @param[in]  CpuIndex   The CPU the value was read on.
+  @param[in]  Tsc        The value.
+
+  @return The BSP TSC value, or Tsc unchanged if the CPU was not measured.
+**/
+UINT64
+MmMpTestTscToBsp (
+  IN UINTN                          CpuIndex,
+  IN UINT64                         Tsc
+  )
+{
+  if (mTscOffset == NULL || CpuIndex >= mTscOffsetCount) {
+    return Tsc;
+  }
+
+  return MpBenchTscToReference (&mTscOffset[CpuIndex], Tsc);
+}
+
+/**
+  Convert TSC cycles to nanoseconds, keeping the sign.
+
+  @param[in]  Ticks    TSC cycles.
+  @param[in]  TscMhz   TSC rate.
+
+  @return Nanoseconds.
+**/
+STATIC
+INT64
+TscTicksToNs (
+  IN INT64   Ticks,
+  IN UINT64  TscMhz
+  )
+{
+  return DivS64x64Remainder (MultS64x64 (Ticks, 1000), (INT64) TscMhz, NULL);
+}
+
+/**
+  Measure the TSC offset and its error bound of every AP relative to the
+  BSP, keep them for MmMpTestTscToBsp and print them.
+
+  @param[in]  Context   The MM MP test context.
+
+  @retval EFI_SUCCESS             The offsets were measured.
+  @retval EFI_OUT_OF_RESOURCES    Not enough SMRAM or scratch arena.
+**/
+EFI_STATUS
+SmmMpTscSkewBenchmark (
+  IN MM_MP_TEST_CONTEXT             *Context
+  )
+{
+  EFI_STATUS                     Status;
+  MP_BENCH_TSC_EXCHANGE          *Exchange;
+  MP_BENCH_TSC_OFFSET            *Offset;
+  MM_COMPLETION                  Token;
+  UINTN                          Index;
+  UINT64                         TscStart;
+  UINT64                         CounterStart;
+  UINT64                         TscMhz;
+  INT64                          Low;
+  INT64                          High;
+  UINT64                         MaxError;
+  UINTN                          Measured;
+  UINTN                          Drifting;
+  MM_MP_TEST_RESULT              Result;
+
+  if (mTscOffset == NULL) {
+    mTscOffset = AllocateZeroPool (sizeof (MP_BENCH_TSC_OFFSET) * Context->ProcessorNum);
+    if (mTscOffset == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mTscOffsetCount = Context->ProcessorNum;
+  }
+
+  Exchange = MmMpTestArenaAllocate (sizeof (MP_BENCH_TSC_EXCHANGE));
+  if (Exchange == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = MmMpTestResultInitialize (&Result, Context->SmmCpu, Context->ProcessorNum, Context->BspIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  TscStart     = AsmReadTsc ();
+  CounterStart = GetPerformanceCounter ();
+  Sleep (MM_MP_TEST_TSC_CALIBRATE_US);
+  TscMhz = DivU64x64Remainder (
+             MultU64x32 (AsmReadTsc () - TscStart, 1000),
+             MAX (MpBenchElapsedNs (CounterStart, GetPerformanceCounter ()), 1),
+             NULL
+             );
+  TscMhz = MAX (TscMhz, 1);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "TSC offset to Bsp 0x%x, %d exchange rounds per Cpu, TSC %ld MHz\n",
+    Context->BspIndex,
+    MM_MP_TEST_TSC_ROUNDS,
+    TscMhz
+    ));
+
+  //
+  // The BSP is the reference, its own offset is exactly 0.
+  //
+  ZeroMem (mTscOffset, sizeof (MP_BENCH_TSC_OFFSET) * mTscOffsetCount);
+  mTscOffset[Context->BspIndex].Valid      = TRUE;
+  mTscOffset[Context->BspIndex].Consistent = TRUE;
+
+  Low      = 0;
+  High     = 0;
+  MaxError = 0;
+  Measured = 0;
+  Drifting = 0;
+
+  for (Index = 0; Index < mTscOffsetCount; Index++) {
+    if (Index == Context->BspIndex) {
+      continue;
+    }
+
+    Offset = &mTscOffset[Index];
+    ZeroMem (Exchange, sizeof (MP_BENCH_TSC_EXCHANGE));
+    Status = Context->SmmMp->DispatchProcedure (Context->SmmMp, TscExchangeProcedure, Index, 0, Exchange, &Token, NULL);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((MM_MP_TEST_DETAIL_LEVEL (mTscOffsetCount), "  Cpu 0x%x: DispatchProcedure returns %r, skipped\n", Index, Status));
+      MmMpTestResultFail (&Result, Index, Status);
+      continue;
+    }
+
+    MpBenchTscExchangeMeasure (Exchange, MM_MP_TEST_TSC_ROUNDS, MM_MP_TEST_TSC_TIMEOUT_US, Offset);
+    Context->SmmMp->WaitForProcedure (Context->SmmMp, Token);
+    if (!Offset->Valid) {
+      DEBUG ((MM_MP_TEST_DETAIL_LEVEL (mTscOffsetCount), "  Cpu 0x%x: no reply in %d us\n", Index, MM_MP_TEST_TSC_TIMEOUT_US));
+      MmMpTestResultFail (&Result, Index, EFI_TIMEOUT);
+      continue;
+    }
+
+    DEBUG ((
+      MM_MP_TEST_DETAIL_LEVEL (mTscOffsetCount),
+      "  Cpu 0x%x: offset %ld +/- %ld cycles (%ld ns), shortest round trip %ld cycles%a\n",
+      Index,
+      Offset->Offset,
+      Offset->Error,
+      TscTicksToNs (Offset->Offset, TscMhz),
+      Offset->RoundTrip,
+      Offset->Consistent ? "" : ", drifting"
+      ));
+
+    Measured++;
+    Low      = MIN (Low, Offset->Offset);
+    High     = MAX (High, Offset->Offset);
+    MaxError = MAX (MaxError, Offset->Error);
+    if (!Offset->Consistent) {
+      Drifting++;
+    }
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "0x%x of 0x%x Aps measured, offsets %ld to %ld ns, largest error bound %ld ns, 0x%x drifting\n",
+    Measured,
+    mTscOffsetCount - 1,
+    TscTicksToNs (Low, TscMhz),
+    TscTicksToNs (High, TscMhz),
+    DivU64x64Remainder (MultU64x32 (MaxError, 1000), TscMhz, NULL),
+    Drifting
+    ));
+  MmMpTestResultPrint (&Result, "TSC offset");
+
+  //
+  // Offsets within their error bounds are no evidence of skew.
+  //
+  if ((UINT64) (High - Low) <= 2 * MaxError) {
+    DEBUG ((DEBUG_INFO, "TSCs agree within the error bound\n"));
+  } else {
+    DEBUG ((DEBUG_INFO, "TSCs disagree, correct cross-Cpu stamps with MmMpTestTscToBsp\n"));
+  }
+  DEBUG ((DEBUG_INFO, "\n"));
+
+  return EFI_SUCCESS;
+}
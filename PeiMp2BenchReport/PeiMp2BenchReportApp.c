@@ -0,0 +1,459 @@
+/** @file
+  Report, save and compare the PeiMp2UnitTest benchmark results handed off
+  in gPeiMp2BenchmarkHobGuid HOBs.
+
+  PeiMp2BenchReportApp            print every result HOB
+  PeiMp2BenchReportApp save       also save a summary in a NV variable, and
+                                  in the one of the requested AP loop mode of
+                                  the boot
+  PeiMp2BenchReportApp compare    also compare against the saved summary
+  PeiMp2BenchReportApp modes      also print the summaries saved for each AP
+                                  loop mode side by side
+
+  To choose an AP loop mode, build UnitTestPkgBenchmark.dsc and the platform
+  with -D AP_LOOP_MODE=1, 2 and 3, boot each and run "save", then "modes".
+
+  Copyright (c) 2026, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Protocol/ShellParameters.h>
+#include <Guid/PeiMp2BenchmarkHob.h>
+
+STATIC CONST CHAR8  *mPhaseName[] = {
+  "pre-memory",
+  "post-memory"
+};
+
+//
+// Indexed by PEI_MP2_AP_LOOP_* value.
+//
+STATIC CONST CHAR8  *mApLoopModeName[] = {
+  "unknown",
+  "HLT",
+  "MWAIT",
+  "run loop"
+};
+
+/**
+  Return the name of an AP loop mode.
+
+  @param[in]  ApLoopMode   A PEI_MP2_AP_LOOP_* value.
+
+  @return The name.
+**/
+CONST CHAR8 *
+ApLoopModeName (
+  IN UINT32  ApLoopMode
+  )
+{
+  return ApLoopMode < ARRAY_SIZE (mApLoopModeName) ? mApLoopModeName[ApLoopMode] : mApLoopModeName[0];
+}
+
+/**
+  Return the result held by a benchmark HOB, NULL if it is not usable.
+
+  @param[in]  GuidHob   The HOB.
+
+  @return The result.
+**/
+PEI_MP2_BENCHMARK_RESULT *
+GetBenchmarkResult (
+  IN VOID  *GuidHob
+  )
+{
+  PEI_MP2_BENCHMARK_RESULT  *Result;
+  UINTN                     Size;
+
+  Result = GET_GUID_HOB_DATA (GuidHob);
+  Size   = GET_GUID_HOB_DATA_SIZE (GuidHob);
+  if (Size < sizeof (PEI_MP2_BENCHMARK_RESULT) ||
+      Result->Revision != PEI_MP2_BENCHMARK_REVISION ||
+      Result->RecordCount > PEI_MP2_BENCHMARK_MAX_RECORDS ||
+      Size < sizeof (PEI_MP2_BENCHMARK_RESULT) + Result->ApStampCount * sizeof (UINT64)) {
+    return NULL;
+  }
+
+  return Result;
+}
+
+/**
+  Fill the saved form of a record.
+
+  @param[out] Summary    The summary.
+  @param[in]  Sequence   Index of the HOB the record comes from.
+  @param[in]  Result     The result holding the record.
+  @param[in]  Record     The record.
+**/
+VOID
+SummarizeRecord (
+  OUT PEI_MP2_BENCHMARK_SUMMARY       *Summary,
+  IN  UINTN                           Sequence,
+  IN  CONST PEI_MP2_BENCHMARK_RESULT  *Result,
+  IN  CONST PEI_MP2_BENCHMARK_RECORD  *Record
+  )
+{
+  ZeroMem (Summary, sizeof (*Summary));
+  Summary->Sequence = (UINT32) Sequence;
+  Summary->Phase    = Result->Phase;
+  CopyMem (Summary->Name, Record->Name, sizeof (Summary->Name));
+  CopyMem (Summary->Unit, Record->Unit, sizeof (Summary->Unit));
+  Summary->Name[PEI_MP2_BENCHMARK_NAME_SIZE - 1] = '\0';
+  Summary->Unit[PEI_MP2_BENCHMARK_UNIT_SIZE - 1] = '\0';
+  Summary->Count = Record->Stats.Count;
+  Summary->Min   = Record->Stats.Min;
+  Summary->Mean  = MpBenchStatsMean (&Record->Stats);
+  Summary->P99   = MpBenchStatsPercentile (&Record->Stats, 99);
+  Summary->Max   = Record->Stats.Max;
+}
+
+/**
+  Print one result HOB.
+
+  @param[in]  Sequence   Index of the HOB.
+  @param[in]  Result     The result.
+**/
+VOID
+PrintBenchmarkResult (
+  IN UINTN                           Sequence,
+  IN CONST PEI_MP2_BENCHMARK_RESULT  *Result
+  )
+{
+  PEI_MP2_BENCHMARK_SUMMARY  Summary;
+  CONST UINT64               *ApStartNs;
+  UINTN                      Index;
+  UINTN                      Bucket;
+
+  Print (
+    L"Run %d, %a, 0x%x Cpus, Bsp 0x%x, TSC %ld MHz, requested AP loop %a\n",
+    Sequence,
+    Result->Phase < ARRAY_SIZE (mPhaseName) ? mPhaseName[Result->Phase] : "unknown phase",
+    Result->NumberOfProcessors,
+    Result->BspIndex,
+    Result->TscMhz,
+    ApLoopModeName (Result->RequestedApLoopMode)
+    );
+  if (Result->DroppedRecordCount != 0) {
+    Print (L"  0x%x records did not fit in the HOB and were dropped\n", Result->DroppedRecordCount);
+  }
+
+  for (Index = 0; Index < Result->RecordCount; Index++) {
+    SummarizeRecord (&Summary, Sequence, Result, &Result->Record[Index]);
+    Print (
+      L"  %-24a count %ld min %ld mean %ld p99 %ld max %ld %a\n",
+      Summary.Name,
+      Summary.Count,
+      Summary.Min,
+      Summary.Mean,
+      Summary.P99,
+      Summary.Max,
+      Summary.Unit
+      );
+    if (Summary.Count < 2) {
+      continue;
+    }
+    for (Bucket = 0; Bucket < MP_BENCH_HISTOGRAM_BUCKETS; Bucket++) {
+      if (Result->Record[Index].Stats.Histogram[Bucket] != 0) {
+        Print (
+          L"    < %ld: %d\n",
+          LShiftU64 (1, Bucket),
+          Result->Record[Index].Stats.Histogram[Bucket]
+          );
+      }
+    }
+  }
+
+  ApStartNs = (CONST UINT64 *)(Result + 1);
+  for (Index = 0; Index < Result->ApStampCount; Index++) {
+    if (ApStartNs[Index] != 0) {
+      Print (L"  Ap 0x%x started %ld ns after the call\n", Index, ApStartNs[Index]);
+    }
+  }
+}
+
+/**
+  Print a change between a saved and a current value.
+
+  @param[in]  Label     Name of the value.
+  @param[in]  Saved     Saved value.
+  @param[in]  Current   Current value.
+**/
+VOID
+PrintChange (
+  IN CONST CHAR16  *Label,
+  IN UINT64        Saved,
+  IN UINT64        Current
+  )
+{
+  INT64  Percent;
+
+  Percent = 0;
+  if (Saved != 0) {
+    Percent = DivS64x64Remainder (MultS64x64 ((INT64) (Current - Saved), 100), (INT64) Saved, NULL);
+  }
+  Print (L" %s %ld -> %ld (%ld%%)", Label, Saved, Current, Percent);
+}
+
+/**
+  Find the saved summary of the same run and name as a record.
+
+  @param[in]  Current      The summary of the record.
+  @param[in]  Saved        The saved summaries.
+  @param[in]  SavedCount   Number of saved summaries.
+
+  @return The saved summary, or NULL.
+**/
+CONST PEI_MP2_BENCHMARK_SUMMARY *
+FindSummary (
+  IN CONST PEI_MP2_BENCHMARK_SUMMARY  *Current,
+  IN CONST PEI_MP2_BENCHMARK_SUMMARY  *Saved,
+  IN UINTN                            SavedCount
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < SavedCount; Index++) {
+    if (Saved[Index].Sequence == Current->Sequence &&
+        AsciiStrCmp (Saved[Index].Name, Current->Name) == 0) {
+      return &Saved[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Compare one record against the saved summaries.
+
+  @param[in]  Current      The summary of the record.
+  @param[in]  Saved        The saved summaries.
+  @param[in]  SavedCount   Number of saved summaries.
+**/
+VOID
+CompareRecord (
+  IN CONST PEI_MP2_BENCHMARK_SUMMARY  *Current,
+  IN CONST PEI_MP2_BENCHMARK_SUMMARY  *Saved,
+  IN UINTN                            SavedCount
+  )
+{
+  CONST PEI_MP2_BENCHMARK_SUMMARY  *Match;
+
+  Print (L"  run %d %-24a", Current->Sequence, Current->Name);
+  Match = FindSummary (Current, Saved, SavedCount);
+  if (Match == NULL) {
+    Print (L" not in the saved results\n");
+    return;
+  }
+
+  PrintChange (L"mean", Match->Mean, Current->Mean);
+  PrintChange (L"p99", Match->P99, Current->P99);
+  Print (L" %a\n", Current->Unit);
+}
+
+/**
+  Print the mean and p99 saved for each AP loop mode next to each other,
+  for the records of this boot.
+
+  @param[in]  Summary        The summaries of this boot.
+  @param[in]  SummaryCount   Number of summaries.
+
+  @retval EFI_SUCCESS     At least one mode was saved.
+  @retval EFI_NOT_FOUND   No mode was saved.
+**/
+EFI_STATUS
+PrintModeTable (
+  IN CONST PEI_MP2_BENCHMARK_SUMMARY  *Summary,
+  IN UINTN                            SummaryCount
+  )
+{
+  EFI_STATUS                       Status;
+  PEI_MP2_BENCHMARK_SUMMARY        *Saved[PEI_MP2_AP_LOOP_MODES + 1];
+  UINTN                            SavedCount[PEI_MP2_AP_LOOP_MODES + 1];
+  CONST PEI_MP2_BENCHMARK_SUMMARY  *Match;
+  CHAR16                           VariableName[32];
+  UINTN                            SavedSize;
+  UINTN                            Mode;
+  UINTN                            Found;
+  UINTN                            Index;
+
+  Found = 0;
+  for (Mode = PEI_MP2_AP_LOOP_HLT; Mode <= PEI_MP2_AP_LOOP_MODES; Mode++) {
+    UnicodeSPrint (VariableName, sizeof (VariableName), PEI_MP2_BENCHMARK_MODE_VARIABLE_FORMAT, Mode);
+    Status = GetVariable2 (VariableName, &gPeiMp2BenchmarkHobGuid, (VOID **) &Saved[Mode], &SavedSize);
+    if (EFI_ERROR (Status)) {
+      Saved[Mode]      = NULL;
+      SavedCount[Mode] = 0;
+      continue;
+    }
+    SavedCount[Mode] = SavedSize / sizeof (PEI_MP2_BENCHMARK_SUMMARY);
+    Found++;
+  }
+
+  if (Found == 0) {
+    Print (L"No results saved for any AP loop mode\n");
+    return EFI_NOT_FOUND;
+  }
+
+  Print (L"AP loop modes, mean/p99:\n  %-30a", "");
+  for (Mode = PEI_MP2_AP_LOOP_HLT; Mode <= PEI_MP2_AP_LOOP_MODES; Mode++) {
+    Print (L" %17a", ApLoopModeName ((UINT32) Mode));
+  }
+  Print (L"\n");
+
+  for (Index = 0; Index < SummaryCount; Index++) {
+    Print (L"  run %d %-24a", Summary[Index].Sequence, Summary[Index].Name);
+    for (Mode = PEI_MP2_AP_LOOP_HLT; Mode <= PEI_MP2_AP_LOOP_MODES; Mode++) {
+      Match = FindSummary (&Summary[Index], Saved[Mode], SavedCount[Mode]);
+      if (Match == NULL) {
+        Print (L" %17a", "-");
+      } else {
+        Print (L" %8ld/%-8ld", Match->Mean, Match->P99);
+      }
+    }
+    Print (L" %a\n", Summary[Index].Unit);
+  }
+
+  for (Mode = PEI_MP2_AP_LOOP_HLT; Mode <= PEI_MP2_AP_LOOP_MODES; Mode++) {
+    if (Saved[Mode] != NULL) {
+      FreePool (Saved[Mode]);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Report the benchmark results of this boot, and save or compare them.
+
+  @param[in] ImageHandle    The image handle.
+  @param[in] SystemTable    The system table.
+
+  @retval EFI_SUCCESS       The results were reported.
+  @retval EFI_NOT_FOUND     There is no result HOB, or nothing saved to
+                            compare against.
+  @retval other             Saving the results failed.
+**/
+EFI_STATUS
+EFIAPI
+PeiMp2BenchReportEntryPoint (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL   *ShellParameters;
+  BOOLEAN                         Save;
+  BOOLEAN                         Compare;
+  BOOLEAN                         Modes;
+  UINT32                          ApLoopMode;
+  CHAR16                          VariableName[32];
+  VOID                            *GuidHob;
+  PEI_MP2_BENCHMARK_RESULT        *Result;
+  PEI_MP2_BENCHMARK_SUMMARY       *Summary;
+  PEI_MP2_BENCHMARK_SUMMARY       *Saved;
+  UINTN                           SummaryCount;
+  UINTN                           SavedSize;
+  UINTN                           Sequence;
+  UINTN                           Index;
+
+  Save    = FALSE;
+  Compare = FALSE;
+  Modes   = FALSE;
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **) &ShellParameters);
+  if (!EFI_ERROR (Status) && ShellParameters->Argc > 1) {
+    Save    = (BOOLEAN) (StrCmp (ShellParameters->Argv[1], L"save") == 0);
+    Compare = (BOOLEAN) (StrCmp (ShellParameters->Argv[1], L"compare") == 0);
+    Modes   = (BOOLEAN) (StrCmp (ShellParameters->Argv[1], L"modes") == 0);
+  }
+
+  Summary = AllocateZeroPool (sizeof (PEI_MP2_BENCHMARK_SUMMARY) * PEI_MP2_BENCHMARK_MAX_RECORDS * ARRAY_SIZE (mPhaseName));
+  if (Summary == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // At most one entry run and one memory discovered run per boot.
+  //
+  SummaryCount = 0;
+  Sequence     = 0;
+  ApLoopMode   = 0;
+  for (GuidHob = GetFirstGuidHob (&gPeiMp2BenchmarkHobGuid);
+       GuidHob != NULL && Sequence < ARRAY_SIZE (mPhaseName);
+       GuidHob = GetNextGuidHob (&gPeiMp2BenchmarkHobGuid, GET_NEXT_HOB (GuidHob))) {
+    Result = GetBenchmarkResult (GuidHob);
+    if (Result == NULL) {
+      Print (L"Skipped a result HOB of another revision or size\n");
+      continue;
+    }
+
+    PrintBenchmarkResult (Sequence, Result);
+    ApLoopMode = Result->RequestedApLoopMode;
+    for (Index = 0; Index < Result->RecordCount; Index++) {
+      SummarizeRecord (&Summary[SummaryCount++], Sequence, Result, &Result->Record[Index]);
+    }
+    Sequence++;
+  }
+
+  if (Sequence == 0) {
+    Print (L"No PeiMp2UnitTest benchmark result in the HOB list\n");
+    FreePool (Summary);
+    return EFI_NOT_FOUND;
+  }
+
+  Status = EFI_SUCCESS;
+  if (Save) {
+    Status = gRT->SetVariable (
+                    PEI_MP2_BENCHMARK_VARIABLE_NAME,
+                    &gPeiMp2BenchmarkHobGuid,
+                    EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                    SummaryCount * sizeof (PEI_MP2_BENCHMARK_SUMMARY),
+                    Summary
+                    );
+    Print (L"Saved %d records: %r\n", SummaryCount, Status);
+
+    if (!EFI_ERROR (Status) && ApLoopMode >= PEI_MP2_AP_LOOP_HLT && ApLoopMode <= PEI_MP2_AP_LOOP_MODES) {
+      UnicodeSPrint (VariableName, sizeof (VariableName), PEI_MP2_BENCHMARK_MODE_VARIABLE_FORMAT, ApLoopMode);
+      Status = gRT->SetVariable (
+                      VariableName,
+                      &gPeiMp2BenchmarkHobGuid,
+                      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                      SummaryCount * sizeof (PEI_MP2_BENCHMARK_SUMMARY),
+                      Summary
+                      );
+      Print (L"Saved them for requested AP loop %a: %r\n", ApLoopModeName (ApLoopMode), Status);
+    }
+  }
+
+  if (Compare) {
+    Status = GetVariable2 (PEI_MP2_BENCHMARK_VARIABLE_NAME, &gPeiMp2BenchmarkHobGuid, (VOID **) &Saved, &SavedSize);
+    if (EFI_ERROR (Status)) {
+      Print (L"No saved results to compare with: %r\n", Status);
+      Status = EFI_NOT_FOUND;
+    } else {
+      Print (L"Saved -> current:\n");
+      for (Index = 0; Index < SummaryCount; Index++) {
+        CompareRecord (&Summary[Index], Saved, SavedSize / sizeof (PEI_MP2_BENCHMARK_SUMMARY));
+      }
+      FreePool (Saved);
+    }
+  }
+
+  if (Modes) {
+    Status = PrintModeTable (Summary, SummaryCount);
+  }
+
+  FreePool (Summary);
+  return Status;
+}
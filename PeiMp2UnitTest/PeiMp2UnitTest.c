@@ -12,16 +12,162 @@
 #include <Ppi/MpServices2.h>
 #include <Library/PeiServicesLib.h>
 #include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/TimerLib.h>
 #include <Library/SynchronizationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MpBenchmarkLib.h>
+#include <Library/MpWorkloadLib.h>
+#include <Library/MpPerCpuLib.h>
+#include <Library/MpShardedCounterLib.h>
+#include <Library/HobLib.h>
+#include <Library/PrintLib.h>
+#include <Library/PerformanceLib.h>
+#include <Guid/PeiMp2BenchmarkHob.h>
+
+//
+// Only the lower half of the AP stack is painted: the wrapper does not know
+// how deep its own frame is, and painting below the stack bottom would
+// corrupt the stack of the neighbouring AP.
+//
+#define PEI_MP2_STACK_PAINT_SIZE   (PcdGet32 (PcdCpuApStackSize) / 2)
+
+//
+// Buffer of the memory workload profiles, kept small for PEI.
+//
+#define PEI_MP2_WORKLOAD_SLOT_SIZE     FixedPcdGet32 (PcdPeiMp2WorkloadSlotSize)
+#define PEI_MP2_WORKLOAD_SLOTS         4
+#define PEI_MP2_WORKLOAD_STREAM_MBPS   2000
+
+//
+// Phase benchmark: samples per measurement, duration of the parallel kernel
+// and of the TSC calibration.
+//
+#define PEI_MP2_PHASE_SAMPLES          FixedPcdGet32 (PcdPeiMp2PhaseSamples)
+#define PEI_MP2_PHASE_KERNEL_US        1000
+#define PEI_MP2_PHASE_CALIBRATE_US     1000
+
+//
+// TSC exchange rounds per AP, and time to wait for each reply.
+//
+#define PEI_MP2_TSC_ROUNDS             FixedPcdGet32 (PcdMpBenchTscRounds)
+#define PEI_MP2_TSC_TIMEOUT_US         10000
+
+//
+// Calls per CPU timed for WhoAmI and for the per CPU table.
+//
+#define PEI_MP2_INDEX_CALLS            256
+
+//
+// Events each AP counts into the shared and into the sharded counter.
+//
+#define PEI_MP2_COUNTER_INCREMENTS     4096
+
+//
+// Whether the benchmark results go to serial: always when there is no
+// result HOB to hold them, else as PcdPeiMp2BenchmarkSerialReport says.
+// PEI_MP2_REPORT is DEBUG () for the lines around the results, failures
+// use DEBUG () and are printed either way.
+//
+#define PEI_MP2_REPORTING(Run)         (PcdGetBool (PcdPeiMp2BenchmarkSerialReport) || (Run)->Result == NULL)
+#define PEI_MP2_REPORT(Run, Expression) \
+  do {                                  \
+    if (PEI_MP2_REPORTING (Run)) {      \
+      DEBUG (Expression);               \
+    }                                   \
+  } while (FALSE)
 
 EDKII_PEI_MP_SERVICES2_PPI           *mCpuMp2Ppi;
 
 typedef struct {
   UINT32    MagicNum;
   UINT32    SleepTime;
+  //
+  // Body of Procedure, NULL to spin in Sleep ().
+  //
+  MP_WORKLOAD  *Workload;
+  MP_PER_CPU_TABLE  *PerCpu;
 } PEI_MP2_PROCEDURE_PARAM;
 
+typedef struct {
+  EFI_AP_PROCEDURE    Procedure;
+  VOID                *Argument;
+  UINTN               PaintSize;
+  UINTN               Used;
+} PEI_MP2_STACK_PROBE;
+
+typedef struct {
+  //
+  // Per processor slot, MP_BENCH_SLOT_STRIDE UINT64s apart.
+  //
+  volatile UINT64     *Slot;
+  MP_WORKLOAD         *Workload;
+  UINT64              KernelTicks;
+  MP_PER_CPU_TABLE    *PerCpu;
+} PEI_MP2_PHASE_PARAM;
+
+typedef struct {
+  //
+  // One mailbox and one offset per processor.
+  //
+  MP_BENCH_TSC_EXCHANGE  *Exchange;
+  MP_BENCH_TSC_OFFSET    *Offset;
+  UINTN                  NumberOfProcessors;
+  UINTN                  BspIndex;
+  MP_PER_CPU_TABLE       *PerCpu;
+} PEI_MP2_TSC_PARAM;
+
+typedef struct {
+  BOOLEAN             Sharded;
+  UINTN               BspIndex;
+  UINTN               ApCount;
+  //
+  // Shared counter and barrier, MP_BENCH_SLOT_STRIDE UINT64s apart.
+  //
+  volatile UINT32     *Shared;
+  volatile UINT32     *Arrived;
+  MP_SHARDED_COUNTER  *Counter;
+  //
+  // Per processor loop time in TSC cycles, MP_BENCH_SLOT_STRIDE
+  // UINT64s apart.
+  //
+  volatile UINT64     *Cycles;
+  MP_PER_CPU_TABLE    *PerCpu;
+} PEI_MP2_COUNTER_PARAM;
+
+//
+// Per CPU data area of the per CPU table, filled by PhaseIndexCostProcedure.
+//
+typedef struct {
+  UINT64    WhoAmICycles;
+  UINT64    IndexCycles;
+  BOOLEAN   Agree;
+} PEI_MP2_INDEX_COST;
+
+//
+// State of the tests of one phase. It lives on the stack of the entry point
+// or of the memory discovered notify, as the module globals of a PEIM
+// executing in place cannot be written.
+//
+typedef struct {
+  //
+  // Result HOB of the phase, NULL when there is no room for it.
+  //
+  PEI_MP2_BENCHMARK_RESULT    *Result;
+  //
+  // APIC ID to processor index table of the phase, NULL when not built.
+  // The pre-memory one lives in temporary RAM.
+  //
+  MP_PER_CPU_TABLE            *PerCpu;
+  //
+  // TSC offset of every processor to the BSP, measured by the benchmark of
+  // the phase. NULL until then.
+  //
+  MP_BENCH_TSC_OFFSET         *TscOffset;
+  UINTN                       TscOffsetCount;
+} PEI_MP2_RUN;
+
 SPIN_LOCK    mConsoleLock;
 
 /**
@@ -166,30 +312,211 @@ Sleep (
                        TimeoutInMicroseconds,
                        &CurrentTime
                        );
+  TotalTime     = 0;
 
   while (!CheckTimeout (&CurrentTime, &TotalTime, ExpectedTime)) {
     CpuPause ();
   }
 }
 
+/**
+  Build the result HOB of a phase into Run.
+
+  @param[in, out] Run     The state of the phase.
+  @param[in]      Phase   The PEI_MP2_BENCHMARK_PHASE of the run.
+**/
+VOID
+PeiMp2ResultBegin (
+  IN OUT PEI_MP2_RUN              *Run,
+  IN     PEI_MP2_BENCHMARK_PHASE  Phase
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINTN                       BspIndex;
+  UINTN                       ApStampCount;
+  PEI_MP2_BENCHMARK_RESULT    *Result;
+
+  Run->Result = NULL;
+  Status = mCpuMp2Ppi->GetNumberOfProcessors (
+                         mCpuMp2Ppi,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Status = mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, &BspIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  //
+  // A HOB is limited to 64KB, drop the stamps of the processors beyond it.
+  //
+  ApStampCount = MIN (
+                   NumberOfProcessors,
+                   (MAX_UINT16 - sizeof (EFI_HOB_GUID_TYPE) - sizeof (PEI_MP2_BENCHMARK_RESULT)) / sizeof (UINT64)
+                   );
+
+  Result = BuildGuidHob (&gPeiMp2BenchmarkHobGuid, sizeof (PEI_MP2_BENCHMARK_RESULT) + ApStampCount * sizeof (UINT64));
+  if (Result == NULL) {
+    DEBUG((DEBUG_INFO, "No room for the benchmark result HOB, results go to serial only.\n"));
+    return;
+  }
+
+  ZeroMem (Result, sizeof (PEI_MP2_BENCHMARK_RESULT) + ApStampCount * sizeof (UINT64));
+  Result->Revision            = PEI_MP2_BENCHMARK_REVISION;
+  Result->Phase               = Phase;
+  Result->NumberOfProcessors  = (UINT32) NumberOfProcessors;
+  Result->BspIndex            = (UINT32) BspIndex;
+  Result->ApStampCount        = (UINT32) ApStampCount;
+  Result->RequestedApLoopMode = PcdGet8 (PcdCpuApLoopMode);
+  Run->Result = Result;
+}
+
+/**
+  Record one measurement in the result HOB, and print it when
+  PcdPeiMp2BenchmarkSerialReport is TRUE.
+
+  @param[in]  Run     The state of the phase.
+  @param[in]  Name    Name of the measurement.
+  @param[in]  Unit    Unit of the samples.
+  @param[in]  Stats   The samples.
+**/
 VOID
+PeiMp2ResultRecord (
+  IN PEI_MP2_RUN            *Run,
+  IN CONST CHAR8            *Name,
+  IN CONST CHAR8            *Unit,
+  IN CONST MP_BENCH_STATS   *Stats
+  )
+{
+  PEI_MP2_BENCHMARK_RESULT  *Result;
+  PEI_MP2_BENCHMARK_RECORD  *Record;
+
+  if (PEI_MP2_REPORTING (Run)) {
+    MpBenchStatsPrint (DEBUG_INFO, Name, Unit, Stats);
+  }
+
+  Result = Run->Result;
+  if (Result == NULL) {
+    return;
+  }
+  if (Result->RecordCount == PEI_MP2_BENCHMARK_MAX_RECORDS) {
+    if (Result->DroppedRecordCount++ == 0) {
+      DEBUG ((DEBUG_WARN, "Result HOB full, \"%a\" and later records dropped!\n", Name));
+    }
+    return;
+  }
+
+  Record = &Result->Record[Result->RecordCount++];
+  AsciiStrnCpyS (Record->Name, sizeof (Record->Name), Name, sizeof (Record->Name) - 1);
+  AsciiStrnCpyS (Record->Unit, sizeof (Record->Unit), Unit, sizeof (Record->Unit) - 1);
+  CopyMem (&Record->Stats, Stats, sizeof (MP_BENCH_STATS));
+}
+
+/**
+  Build the per CPU table of Run from the APIC IDs of GetProcessorInfo. On
+  failure it stays NULL and PeiMp2WhoAmI uses WhoAmI.
+
+  @param[in, out] Run   The state of the phase.
+**/
+VOID
+PeiMp2PerCpuBuild (
+  IN OUT PEI_MP2_RUN  *Run
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_PROCESSOR_INFORMATION   Info;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINTN                       Index;
+  UINTN                       Size;
+  UINT32                      MaxApicId;
+  VOID                        *Buffer;
+  MP_PER_CPU_TABLE            *PerCpu;
+
+  Run->PerCpu = NULL;
+  Status = mCpuMp2Ppi->GetNumberOfProcessors (
+                         mCpuMp2Ppi,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  MaxApicId = 0;
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    Status = mCpuMp2Ppi->GetProcessorInfo (mCpuMp2Ppi, Index, &Info);
+    if (EFI_ERROR (Status)) {
+      return;
+    }
+    MaxApicId = MAX (MaxApicId, (UINT32) Info.ProcessorId);
+  }
+
+  Size   = MpPerCpuTableSize (MaxApicId, NumberOfProcessors, sizeof (PEI_MP2_INDEX_COST));
+  Buffer = (Size == 0) ? NULL : AllocatePool (Size);
+  if (Buffer == NULL) {
+    DEBUG((DEBUG_INFO, "No memory for the per Cpu table, procedures use WhoAmI.\n"));
+    return;
+  }
+
+  PerCpu = MpPerCpuTableInitialize (Buffer, Size, MaxApicId, NumberOfProcessors, sizeof (PEI_MP2_INDEX_COST));
+  ASSERT (PerCpu != NULL);
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    Status = mCpuMp2Ppi->GetProcessorInfo (mCpuMp2Ppi, Index, &Info);
+    if (!EFI_ERROR (Status)) {
+      MpPerCpuTableAdd (PerCpu, Index, (UINT32) Info.ProcessorId);
+    }
+  }
+  Run->PerCpu = PerCpu;
+}
+
+/**
+  Return the index of the calling processor, from the per CPU table when
+  built, from WhoAmI otherwise. Callable on any processor.
+
+  @param[in]  PerCpu           The per CPU table of the phase, or NULL.
+  @param[out] ProcessorIndex   The index.
+
+  @retval EFI_SUCCESS   ProcessorIndex is valid.
+  @retval Others        WhoAmI failed.
+**/
+EFI_STATUS
+PeiMp2WhoAmI (
+  IN  MP_PER_CPU_TABLE  *PerCpu,
+  OUT UINTN             *ProcessorIndex
+  )
+{
+  if (PerCpu != NULL) {
+    *ProcessorIndex = MpPerCpuIndex (PerCpu);
+    if (*ProcessorIndex != MP_PER_CPU_INVALID_INDEX) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  return mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, ProcessorIndex);
+}
+
+VOID
+EFIAPI
 Procedure (
   IN VOID  *ProcedureArgument
   )
 {
   PEI_MP2_PROCEDURE_PARAM            *Argument;
   UINTN                              ApIndex;
+  UINT64                             CurrentTime;
 
   ApIndex = 0;
 
   EFI_STATUS                         Status;
 
+  Argument = (PEI_MP2_PROCEDURE_PARAM *)ProcedureArgument;
   if (mCpuMp2Ppi != NULL) {
-    Status = mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, &ApIndex);
+    Status = PeiMp2WhoAmI (Argument->PerCpu, &ApIndex);
     ASSERT_EFI_ERROR (Status);
   }
 
-  Argument = (PEI_MP2_PROCEDURE_PARAM *)ProcedureArgument;
   while (!AcquireSpinLockOrFail (&mConsoleLock)) {
     CpuPause ();
   }
@@ -198,13 +525,173 @@ Procedure (
   ReleaseSpinLock (&mConsoleLock);
 
   if (Argument->SleepTime != 0) {
-    Sleep (Argument->SleepTime);
+    if (Argument->Workload != NULL) {
+      MpWorkloadRun (Argument->Workload, CalculateTimeout (Argument->SleepTime, &CurrentTime));
+    } else {
+      Sleep (Argument->SleepTime);
+    }
+  }
+}
+
+/**
+  Procedure doing nothing but one DEBUG call under mConsoleLock, to isolate
+  the stack cost of the logging path.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_PROCEDURE_PARAM of the caller.
+**/
+VOID
+EFIAPI
+LoggingPathProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PEI_MP2_PROCEDURE_PARAM            *Argument;
+
+  Argument = (PEI_MP2_PROCEDURE_PARAM *)ProcedureArgument;
+  while (!AcquireSpinLockOrFail (&mConsoleLock)) {
+    CpuPause ();
+  }
+
+  DEBUG((DEBUG_INFO, "Stack probe %a, MagicNum = 0x%x, SleepTime = 0x%x.\n", "logging path", Argument->MagicNum, Argument->SleepTime));
+  ReleaseSpinLock (&mConsoleLock);
+}
+
+/**
+  Wrapper run on the AP: paint the stack, run the procedure, scan the stack.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_STACK_PROBE to run.
+**/
+VOID
+EFIAPI
+StackProbeProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PEI_MP2_STACK_PROBE                *Probe;
+  MP_BENCH_STACK_PAINT               Paint;
+
+  Probe = (PEI_MP2_STACK_PROBE *)ProcedureArgument;
+
+  MpBenchStackPaint (&Paint, Probe->PaintSize);
+  Probe->Procedure (Probe->Argument);
+  Probe->Used = MpBenchStackScan (&Paint);
+}
+
+/**
+  Run one procedure on every enabled AP through StackProbeProcedure and
+  report its stack peak.
+
+  @param[in]  Run                  The state of the phase.
+  @param[in]  Name                 Name of the procedure in the report.
+  @param[in]  ApProcedure          The procedure.
+  @param[in]  ProcParam            Argument of the procedure.
+  @param[in]  NumberOfProcessors   Number of processors.
+  @param[in]  BspIndex             Processor index of the BSP.
+**/
+VOID
+TestStackUsageOfProcedure (
+  IN PEI_MP2_RUN                *Run,
+  IN CONST CHAR8                *Name,
+  IN EFI_AP_PROCEDURE           ApProcedure,
+  IN PEI_MP2_PROCEDURE_PARAM    *ProcParam,
+  IN UINTN                      NumberOfProcessors,
+  IN UINTN                      BspIndex
+  )
+{
+  EFI_STATUS                  Status;
+  PEI_MP2_STACK_PROBE         Probe;
+  MP_BENCH_STATS              Stats;
+  UINTN                       Index;
+  UINTN                       PeakAp;
+  UINTN                       Overflows;
+
+  MpBenchStatsReset (&Stats);
+  Probe.Procedure = ApProcedure;
+  Probe.Argument  = ProcParam;
+  Probe.PaintSize = PEI_MP2_STACK_PAINT_SIZE;
+  PeakAp    = 0;
+  Overflows = 0;
+
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    if (Index == BspIndex) {
+      continue;
+    }
+
+    Probe.Used = 0;
+    Status = mCpuMp2Ppi->StartupThisAP (
+                           mCpuMp2Ppi,
+                           StackProbeProcedure,
+                           Index,
+                           0,
+                           &Probe
+                           );
+    if (EFI_ERROR (Status)) {
+      DEBUG((DEBUG_INFO, "Stack %a: StartupThisAP on Ap 0x%x returns %r, skipped.\n", Name, Index, Status));
+      continue;
+    }
+
+    if (Probe.Used == MP_BENCH_STACK_OVERFLOW) {
+      Overflows++;
+      continue;
+    }
+    if (Probe.Used > Stats.Max) {
+      PeakAp = Index;
+    }
+    MpBenchStatsAdd (&Stats, Probe.Used);
+  }
+
+  PeiMp2ResultRecord (Run, Name, "bytes", &Stats);
+  if (Stats.Count != 0) {
+    PEI_MP2_REPORT (Run, (DEBUG_INFO, "  peak on Ap 0x%x\n", PeakAp));
+  }
+  if (Overflows != 0) {
+    DEBUG((DEBUG_ERROR, "  %d APs used the whole painted window, the peak is above 0x%x bytes!\n", Overflows, Probe.PaintSize));
+  }
+}
+
+VOID
+TestStackUsage (
+  IN PEI_MP2_RUN  *Run,
+  IN MP_WORKLOAD  *Workload
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINTN                       BspIndex;
+  PEI_MP2_PROCEDURE_PARAM     ProcParam;
+
+  Status = mCpuMp2Ppi->GetNumberOfProcessors (
+                         mCpuMp2Ppi,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "GetNumberOfProcessors return failure!\n"));
+    return;
   }
+  Status = mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, &BspIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "3.Test stack usage begin, 0x%x of 0x%x bytes painted\n", PEI_MP2_STACK_PAINT_SIZE, PcdGet32 (PcdCpuApStackSize)));
+
+  ProcParam.MagicNum  = 0x5000;
+  ProcParam.SleepTime = 0;
+  ProcParam.Workload  = Workload;
+  ProcParam.PerCpu    = Run->PerCpu;
+  TestStackUsageOfProcedure (Run, "Procedure", Procedure, &ProcParam, NumberOfProcessors, BspIndex);
+
+  ProcParam.SleepTime = 0x30;
+  TestStackUsageOfProcedure (Run, "Procedure with Sleep", Procedure, &ProcParam, NumberOfProcessors, BspIndex);
+
+  TestStackUsageOfProcedure (Run, "DEBUG logging path", LoggingPathProcedure, &ProcParam, NumberOfProcessors, BspIndex);
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "3. Test stack usage End\n"));
 }
 
 VOID
 TestAPIEnableDisableAP (
-  VOID
+  IN PEI_MP2_RUN  *Run,
+  IN MP_WORKLOAD  *Workload
   )
 {
   UINTN                       NumberOfProcessors;
@@ -268,6 +755,8 @@ TestAPIEnableDisableAP (
   // https://bugzilla.tianocore.org/show_bug.cgi?id=2474
   //
   ProcParam.SleepTime = 0x30;
+  ProcParam.Workload  = Workload;
+  ProcParam.PerCpu    = Run->PerCpu;
   DEBUG((DEBUG_INFO, "Trig StartupAllCPUs with SleepTime = 0x%x\n", ProcParam.SleepTime));
   Status = mCpuMp2Ppi->StartupAllCPUs (
                  mCpuMp2Ppi,
@@ -290,13 +779,16 @@ TestAPIEnableDisableAP (
 
 VOID
 TestAPIStartAllCPU (
-  VOID
+  IN PEI_MP2_RUN  *Run,
+  IN MP_WORKLOAD  *Workload
   )
 {
   EFI_STATUS                           Status;
   PEI_MP2_PROCEDURE_PARAM              ProcParam;
 
   ProcParam.SleepTime = 0;
+  ProcParam.Workload  = Workload;
+  ProcParam.PerCpu    = Run->PerCpu;
   DEBUG((DEBUG_INFO, "1.Test StartupAllCPUs begin, SleepTime = 0x%x\n", ProcParam.SleepTime));
   Status = mCpuMp2Ppi->StartupAllCPUs (
                  mCpuMp2Ppi,
@@ -331,6 +823,760 @@ TestAPIStartAllCPU (
   }
 }
 
+/**
+  Set up the workload Procedure runs as its body, selected by
+  PcdPeiMp2WorkloadProfile.
+
+  @param[in]  Run        The state of the phase.
+  @param[out] Workload   The workload to set up.
+
+  @return Workload, or NULL to keep the CpuPause spin.
+**/
+MP_WORKLOAD *
+SelectWorkload (
+  IN  PEI_MP2_RUN  *Run,
+  OUT MP_WORKLOAD  *Workload
+  )
+{
+  UINT8                       Profile;
+  VOID                        *Buffer;
+
+  Profile = PcdGet8 (PcdPeiMp2WorkloadProfile);
+  Buffer  = NULL;
+  if (MpWorkloadSelect (
+        Workload,
+        Profile,
+        &Buffer,
+        PEI_MP2_WORKLOAD_SLOT_SIZE,
+        PEI_MP2_WORKLOAD_SLOTS,
+        PEI_MP2_WORKLOAD_STREAM_MBPS
+        ) == NULL) {
+    return NULL;
+  }
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "Procedure body: %a workload\n", MpWorkloadProfileName ((MP_WORKLOAD_PROFILE) Profile)));
+  return Workload;
+}
+
+/**
+  Procedure doing nothing, for the StartupAllCPUs round trip.
+
+  @param[in]  ProcedureArgument   Unused.
+**/
+VOID
+EFIAPI
+PhaseEmptyProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+}
+
+/**
+  Procedure recording the TSC at which the calling CPU started.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_PHASE_PARAM of the caller.
+**/
+VOID
+EFIAPI
+PhaseStampProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  UINT64                             Tsc;
+  PEI_MP2_PHASE_PARAM                *Param;
+  UINTN                              ProcessorIndex;
+
+  Tsc   = AsmReadTsc ();
+  Param = (PEI_MP2_PHASE_PARAM *)ProcedureArgument;
+  if (!EFI_ERROR (PeiMp2WhoAmI (Param->PerCpu, &ProcessorIndex))) {
+    Param->Slot[ProcessorIndex * MP_BENCH_SLOT_STRIDE] = Tsc;
+  }
+}
+
+/**
+  Procedure running the phase workload for the phase duration and recording
+  the work done by the calling CPU.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_PHASE_PARAM of the caller.
+**/
+VOID
+EFIAPI
+PhaseKernelProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  UINT64                             Work;
+  PEI_MP2_PHASE_PARAM                *Param;
+  UINTN                              ProcessorIndex;
+
+  Param = (PEI_MP2_PHASE_PARAM *)ProcedureArgument;
+  Work  = MpWorkloadRun (Param->Workload, Param->KernelTicks);
+  if (!EFI_ERROR (PeiMp2WhoAmI (Param->PerCpu, &ProcessorIndex))) {
+    Param->Slot[ProcessorIndex * MP_BENCH_SLOT_STRIDE] = Work;
+  }
+}
+
+/**
+  Procedure timing WhoAmI and the per CPU table on the calling CPU, into its
+  own data area of the table. All CPUs run it at once, as MP procedures do.
+
+  @param[in]  ProcedureArgument   The MP_PER_CPU_TABLE of the phase.
+**/
+VOID
+EFIAPI
+PhaseIndexCostProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  EFI_STATUS                         Status;
+  PEI_MP2_INDEX_COST                 *Cost;
+  UINTN                              Call;
+  UINTN                              WhoAmIIndex;
+  UINTN                              TableIndex;
+  UINT64                             Start;
+  MP_PER_CPU_TABLE                   *PerCpu;
+
+  PerCpu = (MP_PER_CPU_TABLE *)ProcedureArgument;
+  Cost   = MpPerCpuData (PerCpu);
+  if (Cost == NULL) {
+    return;
+  }
+
+  Status = EFI_SUCCESS;
+  Start  = AsmReadTsc ();
+  for (Call = 0; Call < PEI_MP2_INDEX_CALLS && !EFI_ERROR (Status); Call++) {
+    Status = mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, &WhoAmIIndex);
+  }
+  Cost->WhoAmICycles = AsmReadTsc () - Start;
+
+  Start = AsmReadTsc ();
+  for (Call = 0; Call < PEI_MP2_INDEX_CALLS; Call++) {
+    TableIndex = MpPerCpuIndex (PerCpu);
+  }
+  Cost->IndexCycles = AsmReadTsc () - Start;
+
+  Cost->Agree = (BOOLEAN) (!EFI_ERROR (Status) && WhoAmIIndex == TableIndex);
+}
+
+/**
+  Measure WhoAmI against the per CPU table on all CPUs and record the cost
+  per call of both.
+
+  @param[in]  Run                  The state of the phase.
+  @param[in]  NumberOfProcessors   Number of processors.
+  @param[in]  TscMhz               TSC rate.
+**/
+VOID
+PhaseIndexCost (
+  IN PEI_MP2_RUN  *Run,
+  IN UINTN        NumberOfProcessors,
+  IN UINT64       TscMhz
+  )
+{
+  EFI_STATUS                  Status;
+  PEI_MP2_INDEX_COST          *Cost;
+  MP_BENCH_STATS              WhoAmI;
+  MP_BENCH_STATS              Index;
+  UINTN                       Cpu;
+  UINTN                       Disagree;
+  MP_PER_CPU_TABLE            *PerCpu;
+
+  PerCpu = Run->PerCpu;
+  if (PerCpu == NULL) {
+    return;
+  }
+
+  ZeroMem (PerCpu->Data, PerCpu->CpuCount * PerCpu->DataSize);
+  Status = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseIndexCostProcedure, 0, PerCpu);
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "  per Cpu index: StartupAllCPUs returns %r\n", Status));
+    return;
+  }
+
+  //
+  // Picoseconds: the table lookup takes a few nanoseconds.
+  //
+  MpBenchStatsReset (&WhoAmI);
+  MpBenchStatsReset (&Index);
+  Disagree = 0;
+  for (Cpu = 0; Cpu < NumberOfProcessors; Cpu++) {
+    Cost = MpPerCpuDataOf (PerCpu, Cpu);
+    if (Cost->IndexCycles == 0) {
+      continue;
+    }
+    if (!Cost->Agree) {
+      Disagree++;
+      continue;
+    }
+    MpBenchStatsAdd (&WhoAmI, DivU64x64Remainder (MultU64x32 (Cost->WhoAmICycles, 1000000), TscMhz * PEI_MP2_INDEX_CALLS, NULL));
+    MpBenchStatsAdd (&Index, DivU64x64Remainder (MultU64x32 (Cost->IndexCycles, 1000000), TscMhz * PEI_MP2_INDEX_CALLS, NULL));
+  }
+  PeiMp2ResultRecord (Run, "WhoAmI per call", "ps", &WhoAmI);
+  PeiMp2ResultRecord (Run, "per Cpu index per call", "ps", &Index);
+  if (Disagree != 0) {
+    DEBUG((DEBUG_ERROR, "  0x%x Cpus got another index from the per Cpu table than from WhoAmI!\n", Disagree));
+  }
+}
+
+/**
+  Procedure counting PEI_MP2_COUNTER_INCREMENTS events on every AP into the
+  shared or the sharded counter. The APs wait for each other first so their
+  loops overlap, the BSP, which starts last, does not count.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_COUNTER_PARAM of the caller.
+**/
+VOID
+EFIAPI
+PhaseCounterProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PEI_MP2_COUNTER_PARAM              *Param;
+  UINTN                              ProcessorIndex;
+  UINTN                              Count;
+  UINT64                             Start;
+
+  Param = (PEI_MP2_COUNTER_PARAM *)ProcedureArgument;
+  if (EFI_ERROR (PeiMp2WhoAmI (Param->PerCpu, &ProcessorIndex)) || ProcessorIndex == Param->BspIndex) {
+    return;
+  }
+
+  if (!MpBenchBarrierWait (Param->Arrived, Param->ApCount)) {
+    return;
+  }
+
+  Start = AsmReadTsc ();
+  if (Param->Sharded) {
+    for (Count = 0; Count < PEI_MP2_COUNTER_INCREMENTS; Count++) {
+      MpShardedCounterIncrement (Param->Counter, ProcessorIndex, 0);
+    }
+  } else {
+    for (Count = 0; Count < PEI_MP2_COUNTER_INCREMENTS; Count++) {
+      InterlockedIncrement (Param->Shared);
+    }
+  }
+  Param->Cycles[ProcessorIndex * MP_BENCH_SLOT_STRIDE] = AsmReadTsc () - Start;
+}
+
+/**
+  Measure InterlockedIncrement of one shared counter against a sharded
+  counter with all enabled APs counting at once, and record the wall cost of
+  one increment of the slowest AP for both.
+
+  @param[in]  Run                         The state of the phase.
+  @param[in]  NumberOfProcessors          Number of processors.
+  @param[in]  NumberOfEnabledProcessors   Number of enabled processors.
+  @param[in]  BspIndex                    The BSP.
+  @param[in]  TscMhz                      TSC rate.
+**/
+VOID
+PhaseCounter (
+  IN PEI_MP2_RUN  *Run,
+  IN UINTN        NumberOfProcessors,
+  IN UINTN        NumberOfEnabledProcessors,
+  IN UINTN        BspIndex,
+  IN UINT64       TscMhz
+  )
+{
+  EFI_STATUS                  Status;
+  PEI_MP2_COUNTER_PARAM       Param;
+  MP_BENCH_STATS              Stats[2];
+  volatile UINT64             *Lines;
+  VOID                        *Buffer;
+  UINTN                       Size;
+  UINTN                       Kind;
+  UINTN                       Sample;
+  UINTN                       Index;
+  UINTN                       Lost;
+  UINT64                      Total;
+  UINT64                      Slowest;
+
+  if (NumberOfEnabledProcessors < 2) {
+    return;
+  }
+
+  Size   = MpShardedCounterSize (NumberOfProcessors);
+  Lines  = AllocateZeroPool ((NumberOfProcessors + 2) * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+  Buffer = (Size == 0) ? NULL : AllocatePool (Size);
+  if (Lines == NULL || Buffer == NULL) {
+    DEBUG((DEBUG_INFO, "  counter: no memory for 0x%x Cpus, skipped.\n", NumberOfProcessors));
+    if (Lines != NULL) {
+      FreePool ((VOID *)Lines);
+    }
+    if (Buffer != NULL) {
+      FreePool (Buffer);
+    }
+    return;
+  }
+
+  Param.BspIndex = BspIndex;
+  Param.PerCpu   = Run->PerCpu;
+  Param.ApCount  = NumberOfEnabledProcessors - 1;
+  Param.Shared   = (volatile UINT32 *)Lines;
+  Param.Arrived  = (volatile UINT32 *)(Lines + MP_BENCH_SLOT_STRIDE);
+  Param.Cycles   = Lines + 2 * MP_BENCH_SLOT_STRIDE;
+  Param.Counter  = MpShardedCounterInitialize (Buffer, Size, NumberOfProcessors, 1);
+  ASSERT (Param.Counter != NULL);
+
+  Lost = 0;
+  for (Kind = 0; Kind < 2; Kind++) {
+    Param.Sharded = (BOOLEAN) (Kind == 1);
+    MpBenchStatsReset (&Stats[Kind]);
+    for (Sample = 0; Sample < PEI_MP2_PHASE_SAMPLES; Sample++) {
+      *Param.Shared  = 0;
+      *Param.Arrived = 0;
+      MpShardedCounterReset (Param.Counter);
+      ZeroMem ((VOID *)Param.Cycles, NumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+
+      Status = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseCounterProcedure, 0, &Param);
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+
+      Total = Param.Sharded ? MpShardedCounterRead (Param.Counter, 0) : *Param.Shared;
+      if (Total != MultU64x32 (Param.ApCount, PEI_MP2_COUNTER_INCREMENTS)) {
+        Lost++;
+        continue;
+      }
+
+      //
+      // Picoseconds: an uncontended increment takes about a nanosecond.
+      //
+      Slowest = 0;
+      for (Index = 0; Index < NumberOfProcessors; Index++) {
+        Slowest = MAX (Slowest, Param.Cycles[Index * MP_BENCH_SLOT_STRIDE]);
+      }
+      MpBenchStatsAdd (&Stats[Kind], DivU64x64Remainder (MultU64x32 (Slowest, 1000000), TscMhz * PEI_MP2_COUNTER_INCREMENTS, NULL));
+    }
+  }
+  PeiMp2ResultRecord (Run, "shared counter increment", "ps", &Stats[0]);
+  PeiMp2ResultRecord (Run, "sharded counter increment", "ps", &Stats[1]);
+  if (Lost != 0) {
+    DEBUG((DEBUG_ERROR, "  counter: %d samples lost events!\n", Lost));
+  }
+
+  FreePool (Buffer);
+  FreePool ((VOID *)Lines);
+}
+
+/**
+  Procedure of the TSC exchange: the BSP measures every AP in turn, each AP
+  answers on its own mailbox.
+
+  @param[in]  ProcedureArgument   The PEI_MP2_TSC_PARAM of the caller.
+**/
+VOID
+EFIAPI
+PhaseTscProcedure (
+  IN VOID  *ProcedureArgument
+  )
+{
+  PEI_MP2_TSC_PARAM                  *Param;
+  UINTN                              ProcessorIndex;
+  UINTN                              Index;
+
+  Param = (PEI_MP2_TSC_PARAM *)ProcedureArgument;
+  if (EFI_ERROR (PeiMp2WhoAmI (Param->PerCpu, &ProcessorIndex))) {
+    return;
+  }
+
+  if (ProcessorIndex != Param->BspIndex) {
+    MpBenchTscExchangeServe (&Param->Exchange[ProcessorIndex]);
+    return;
+  }
+
+  //
+  // A disabled AP never answers and costs one timeout.
+  //
+  for (Index = 0; Index < Param->NumberOfProcessors; Index++) {
+    if (Index != Param->BspIndex) {
+      MpBenchTscExchangeMeasure (&Param->Exchange[Index], PEI_MP2_TSC_ROUNDS, PEI_MP2_TSC_TIMEOUT_US, &Param->Offset[Index]);
+    }
+  }
+}
+
+/**
+  Translate a TSC value read on a processor to the BSP TSC, with the offsets
+  measured in the phase.
+
+  @param[in]  Run              The state of the phase.
+  @param[in]  ProcessorIndex   The processor the value was read on.
+  @param[in]  Tsc              The value.
+
+  @return The BSP TSC value, or Tsc unchanged if the processor was not
+          measured.
+**/
+UINT64
+PeiMp2TscToBsp (
+  IN PEI_MP2_RUN  *Run,
+  IN UINTN        ProcessorIndex,
+  IN UINT64       Tsc
+  )
+{
+  if (Run->TscOffset == NULL || ProcessorIndex >= Run->TscOffsetCount) {
+    return Tsc;
+  }
+
+  return MpBenchTscToReference (&Run->TscOffset[ProcessorIndex], Tsc);
+}
+
+/**
+  Measure the TSC offset of every AP to the BSP, keep them in Run for
+  PeiMp2TscToBsp and record their spread and error bounds.
+
+  @param[in, out] Run                  The state of the phase.
+  @param[in]      NumberOfProcessors   Number of processors.
+  @param[in]      BspIndex             The BSP.
+  @param[in]      TscMhz               TSC rate.
+**/
+VOID
+PhaseTscOffset (
+  IN OUT PEI_MP2_RUN  *Run,
+  IN     UINTN        NumberOfProcessors,
+  IN     UINTN        BspIndex,
+  IN     UINT64       TscMhz
+  )
+{
+  EFI_STATUS                  Status;
+  PEI_MP2_TSC_PARAM           Param;
+  MP_BENCH_TSC_OFFSET         *Offset;
+  MP_BENCH_STATS              Magnitude;
+  MP_BENCH_STATS              Error;
+  UINTN                       Index;
+  UINTN                       Drifting;
+  INT64                       Ticks;
+
+  Run->TscOffset      = NULL;
+  Run->TscOffsetCount = 0;
+
+  Param.Exchange = AllocateZeroPool (NumberOfProcessors * sizeof (MP_BENCH_TSC_EXCHANGE));
+  Param.Offset   = AllocateZeroPool (NumberOfProcessors * sizeof (MP_BENCH_TSC_OFFSET));
+  if (Param.Exchange == NULL || Param.Offset == NULL) {
+    DEBUG((DEBUG_INFO, "  TSC offset: no memory for 0x%x Cpus, skipped.\n", NumberOfProcessors));
+    return;
+  }
+  Param.NumberOfProcessors = NumberOfProcessors;
+  Param.BspIndex           = BspIndex;
+  Param.PerCpu             = Run->PerCpu;
+  Param.Offset[BspIndex].Valid      = TRUE;
+  Param.Offset[BspIndex].Consistent = TRUE;
+
+  Status = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseTscProcedure, 0, &Param);
+  FreePool (Param.Exchange);
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "  TSC offset: StartupAllCPUs returns %r\n", Status));
+    FreePool (Param.Offset);
+    return;
+  }
+
+  //
+  // Offsets are signed, the records hold their magnitude.
+  //
+  MpBenchStatsReset (&Magnitude);
+  MpBenchStatsReset (&Error);
+  Drifting = 0;
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    Offset = &Param.Offset[Index];
+    if (Index == BspIndex || !Offset->Valid) {
+      continue;
+    }
+    Ticks = Offset->Offset < 0 ? -Offset->Offset : Offset->Offset;
+    MpBenchStatsAdd (&Magnitude, DivU64x64Remainder (MultU64x32 ((UINT64) Ticks, 1000), TscMhz, NULL));
+    MpBenchStatsAdd (&Error, DivU64x64Remainder (MultU64x32 (Offset->Error, 1000), TscMhz, NULL));
+    if (!Offset->Consistent) {
+      Drifting++;
+    }
+    PEI_MP2_REPORT (Run, (DEBUG_VERBOSE, "  Cpu 0x%x TSC offset %ld +/- %ld cycles\n", Index, Offset->Offset, Offset->Error));
+  }
+  PeiMp2ResultRecord (Run, "AP TSC offset magnitude", "ns", &Magnitude);
+  PeiMp2ResultRecord (Run, "AP TSC offset error bound", "ns", &Error);
+  if (Drifting != 0) {
+    PEI_MP2_REPORT (Run, (DEBUG_INFO, "  0x%x Aps have a drifting TSC\n", Drifting));
+  }
+
+  Run->TscOffset      = Param.Offset;
+  Run->TscOffsetCount = NumberOfProcessors;
+}
+
+/**
+  Run the kernel once on all CPUs and return the work done per millisecond.
+
+  @param[in]  Param                The phase parameters.
+  @param[in]  NumberOfProcessors   Number of processors.
+
+  @return Work per millisecond, 0 if StartupAllCPUs failed.
+**/
+UINT64
+PhaseKernelThroughput (
+  IN PEI_MP2_PHASE_PARAM  *Param,
+  IN UINTN                NumberOfProcessors
+  )
+{
+  EFI_STATUS                  Status;
+  UINT64                      Start;
+  UINT64                      ElapsedNs;
+  UINT64                      Total;
+  UINTN                       Index;
+
+  ZeroMem ((VOID *)Param->Slot, NumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+
+  Start     = GetPerformanceCounter ();
+  Status    = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseKernelProcedure, 0, Param);
+  ElapsedNs = MpBenchElapsedNs (Start, GetPerformanceCounter ());
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "  kernel: StartupAllCPUs returns %r\n", Status));
+    return 0;
+  }
+
+  Total = 0;
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    Total += Param->Slot[Index * MP_BENCH_SLOT_STRIDE];
+  }
+
+  return DivU64x64Remainder (MultU64x32 (Total, 1000000), MAX (ElapsedNs, 1), NULL);
+}
+
+/**
+  Measure StartupAllCPUs latency, AP start skew and parallel kernel
+  throughput in the current PEI phase.
+
+  @param[in, out] Run         The state of the phase.
+  @param[in]      PhaseName   Name of the phase in the report.
+**/
+VOID
+TestPhaseBenchmark (
+  IN OUT PEI_MP2_RUN  *Run,
+  IN     CONST CHAR8  *PhaseName
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINTN                       BspIndex;
+  UINTN                       Sample;
+  UINTN                       Index;
+  UINT64                      Start;
+  UINT64                      TscStart;
+  UINT64                      TscMhz;
+  UINT64                      First;
+  UINT64                      Last;
+  UINT64                      Stamp;
+  UINT64                      AllRate;
+  UINT64                      BspRate;
+  UINT64                      KernelStart;
+  UINT64                      *ApStartNs;
+  CHAR8                       KernelUnit[PEI_MP2_BENCHMARK_UNIT_SIZE];
+  MP_BENCH_STATS              Rate;
+  MP_BENCH_STATS              Latency;
+  MP_BENCH_STATS              FirstStart;
+  MP_BENCH_STATS              Wake;
+  MP_BENCH_STATS              Skew;
+  MP_WORKLOAD                 WorkloadStorage;
+  MP_WORKLOAD                 IntegerWorkload;
+  PEI_MP2_PHASE_PARAM         Param;
+  PEI_MP2_BENCHMARK_RESULT    *Result;
+
+  Result = Run->Result;
+  Status = mCpuMp2Ppi->GetNumberOfProcessors (
+                         mCpuMp2Ppi,
+                         &NumberOfProcessors,
+                         &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "GetNumberOfProcessors return failure!\n"));
+    return;
+  }
+  Status = mCpuMp2Ppi->WhoAmI (mCpuMp2Ppi, &BspIndex);
+  ASSERT_EFI_ERROR (Status);
+
+  Param.PerCpu = Run->PerCpu;
+  Param.Slot   = AllocateZeroPool (NumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+  if (Param.Slot == NULL) {
+    DEBUG((DEBUG_INFO, "%a benchmark: no memory for 0x%x Cpus, skipped.\n", PhaseName, NumberOfProcessors));
+    return;
+  }
+
+  //
+  // The skew is taken from TSC stamps, calibrated against the performance
+  // counter for the report.
+  //
+  TscStart = AsmReadTsc ();
+  Start    = GetPerformanceCounter ();
+  Sleep (PEI_MP2_PHASE_CALIBRATE_US);
+  TscMhz = DivU64x64Remainder (
+             MultU64x32 (AsmReadTsc () - TscStart, 1000),
+             MAX (MpBenchElapsedNs (Start, GetPerformanceCounter ()), 1),
+             NULL
+             );
+  TscMhz = MAX (TscMhz, 1);
+  if (Result != NULL) {
+    Result->TscMhz = TscMhz;
+  }
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "4.Test %a MP benchmark begin, 0x%x Cpus, 0x%x enabled, TSC %ld MHz, requested AP loop mode %d\n", PhaseName, NumberOfProcessors, NumberOfEnabledProcessors, TscMhz, PcdGet8 (PcdCpuApLoopMode)));
+
+  //
+  // StartupAllCPUs round trip with an empty procedure.
+  //
+  MpBenchStatsReset (&Latency);
+  for (Sample = 0; Sample < PEI_MP2_PHASE_SAMPLES; Sample++) {
+    Start  = GetPerformanceCounter ();
+    Status = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseEmptyProcedure, 0, NULL);
+    if (!EFI_ERROR (Status)) {
+      MpBenchStatsAdd (&Latency, MpBenchElapsedNs (Start, GetPerformanceCounter ()));
+    }
+  }
+  PeiMp2ResultRecord (Run, "StartupAllCPUs latency", "ns", &Latency);
+
+  PhaseIndexCost (Run, NumberOfProcessors, TscMhz);
+  PhaseCounter (Run, NumberOfProcessors, NumberOfEnabledProcessors, BspIndex, TscMhz);
+
+  //
+  // The AP start stamps below are translated to the BSP TSC.
+  //
+  if (NumberOfEnabledProcessors > 1) {
+    PhaseTscOffset (Run, NumberOfProcessors, BspIndex, TscMhz);
+  }
+
+  //
+  // AP start: from the call to every AP, to the first AP, and from the first
+  // AP to the last. The BSP runs the procedure after the APs, so it is left
+  // out. How soon an AP wakes depends on the AP loop mode.
+  //
+  MpBenchStatsReset (&FirstStart);
+  MpBenchStatsReset (&Wake);
+  MpBenchStatsReset (&Skew);
+  for (Sample = 0; Sample < PEI_MP2_PHASE_SAMPLES && NumberOfEnabledProcessors > 1; Sample++) {
+    ZeroMem ((VOID *)Param.Slot, NumberOfProcessors * MP_BENCH_SLOT_STRIDE * sizeof (UINT64));
+    TscStart = AsmReadTsc ();
+    Status   = mCpuMp2Ppi->StartupAllCPUs (mCpuMp2Ppi, PhaseStampProcedure, 0, &Param);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    for (Index = 0; Index < NumberOfProcessors; Index++) {
+      Stamp = Param.Slot[Index * MP_BENCH_SLOT_STRIDE];
+      if (Index != BspIndex && Stamp != 0) {
+        Param.Slot[Index * MP_BENCH_SLOT_STRIDE] = PeiMp2TscToBsp (Run, Index, Stamp);
+      }
+    }
+
+    First = MAX_UINT64;
+    Last  = 0;
+    for (Index = 0; Index < NumberOfProcessors; Index++) {
+      Stamp = Param.Slot[Index * MP_BENCH_SLOT_STRIDE];
+      if (Index == BspIndex || Stamp == 0) {
+        continue;
+      }
+      First = MIN (First, Stamp);
+      Last  = MAX (Last, Stamp);
+      MpBenchStatsAdd (&Wake, DivU64x64Remainder (MultU64x32 (Stamp - MIN (Stamp, TscStart), 1000), TscMhz, NULL));
+    }
+    if (Last == 0) {
+      continue;
+    }
+
+    if (Result != NULL) {
+      ApStartNs = (UINT64 *)(Result + 1);
+      for (Index = 0; Index < Result->ApStampCount; Index++) {
+        Stamp = Param.Slot[Index * MP_BENCH_SLOT_STRIDE];
+        ApStartNs[Index] = (Index == BspIndex || Stamp == 0) ? 0 :
+                           DivU64x64Remainder (MultU64x32 (Stamp - MIN (Stamp, TscStart), 1000), TscMhz, NULL);
+      }
+    }
+
+    MpBenchStatsAdd (&FirstStart, DivU64x64Remainder (MultU64x32 (First - MIN (First, TscStart), 1000), TscMhz, NULL));
+    MpBenchStatsAdd (&Skew, DivU64x64Remainder (MultU64x32 (Last - First, 1000), TscMhz, NULL));
+  }
+  PeiMp2ResultRecord (Run, "call to first AP start", "ns", &FirstStart);
+  PeiMp2ResultRecord (Run, "call to each AP start", "ns", &Wake);
+  PeiMp2ResultRecord (Run, "first to last AP start", "ns", &Skew);
+
+  //
+  // Parallel kernel: the PcdPeiMp2WorkloadProfile workload set up in this
+  // phase's memory, or the integer profile for the CpuPause spin.
+  //
+  Param.Workload = SelectWorkload (Run, &WorkloadStorage);
+  if (Param.Workload == NULL) {
+    Status = MpWorkloadInitialize (&IntegerWorkload, MpWorkloadInteger, NULL, 0, 0, 0);
+    ASSERT_RETURN_ERROR (Status);
+    Param.Workload = &IntegerWorkload;
+  }
+  Param.KernelTicks = CalculateTimeout (PEI_MP2_PHASE_KERNEL_US, &KernelStart);
+
+  AllRate = PhaseKernelThroughput (&Param, NumberOfProcessors);
+
+  Param.Slot[BspIndex * MP_BENCH_SLOT_STRIDE] = 0;
+  Param.Workload->NextSlot = 0;
+  Start = GetPerformanceCounter ();
+  PhaseKernelProcedure (&Param);
+  BspRate = DivU64x64Remainder (
+              MultU64x32 (Param.Slot[BspIndex * MP_BENCH_SLOT_STRIDE], 1000000),
+              MAX (MpBenchElapsedNs (Start, GetPerformanceCounter ()), 1),
+              NULL
+              );
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "%a kernel:\n", MpWorkloadProfileName (Param.Workload->Profile)));
+  AsciiSPrint (KernelUnit, sizeof (KernelUnit), "%a/ms", MpWorkloadProfileUnit (Param.Workload->Profile));
+  MpBenchStatsReset (&Rate);
+  MpBenchStatsAdd (&Rate, AllRate);
+  PeiMp2ResultRecord (Run, "kernel all Cpus", KernelUnit, &Rate);
+  MpBenchStatsReset (&Rate);
+  MpBenchStatsAdd (&Rate, BspRate);
+  PeiMp2ResultRecord (Run, "kernel BSP alone", KernelUnit, &Rate);
+
+  FreePool ((VOID *)Param.Slot);
+
+  PEI_MP2_REPORT (Run, (DEBUG_INFO, "4. Test %a MP benchmark End\n", PhaseName));
+}
+
+/**
+  Run the MP benchmark again once permanent memory is installed.
+
+  @param[in]  PeiServices        Describes the list of possible PEI Services.
+  @param[in]  NotifyDescriptor   The notify descriptor.
+  @param[in]  Ppi                The memory discovered PPI, unused.
+
+  @retval EFI_SUCCESS   Always.
+**/
+EFI_STATUS
+EFIAPI
+PeiMp2MemoryDiscoveredNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  EFI_STATUS                           Status;
+  PEI_MP2_RUN                          Run;
+
+  //
+  // The MP services may have been reinstalled from permanent memory.
+  //
+  Status = PeiServicesLocatePpi (
+             &gEdkiiPeiMpServices2PpiGuid,
+             0,
+             NULL,
+             (VOID **)&mCpuMp2Ppi
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_INFO, "Post-memory MP benchmark: Mp Services2 Ppi not found, %r\n", Status));
+    return EFI_SUCCESS;
+  }
+
+  ZeroMem (&Run, sizeof (Run));
+  PeiMp2ResultBegin (&Run, PeiMp2BenchmarkPostMemory);
+  PeiMp2PerCpuBuild (&Run);
+  TestPhaseBenchmark (&Run, "post-memory");
+
+  return EFI_SUCCESS;
+}
+
+EFI_PEI_NOTIFY_DESCRIPTOR  mMemoryDiscoveredNotifyList = {
+  (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST),
+  &gEfiPeiMemoryDiscoveredPpiGuid,
+  PeiMp2MemoryDiscoveredNotify
+};
+
 /**
   Module's entry function.
   This routine will install EFI_PEI_PCI_CFG2_PPI.
@@ -348,6 +1594,10 @@ PeiMp2UnitTest (
   )
 {
   EFI_STATUS                           Status;
+  MP_WORKLOAD                          WorkloadStorage;
+  MP_WORKLOAD                          *Workload;
+  VOID                                 *MemoryDiscovered;
+  PEI_MP2_RUN                          Run;
 
   InitializeSpinLock((SPIN_LOCK*) &mConsoleLock);
 
@@ -365,9 +1615,45 @@ PeiMp2UnitTest (
   DEBUG((DEBUG_INFO, "=========================================\n"));
   DEBUG((DEBUG_INFO, "Begin do Edkii Pei Mp Services2 Ppi test!\n"));
 
-  TestAPIStartAllCPU ();
+  //
+  // The benchmark runs once from here and once from the memory discovered
+  // notify. When memory is already installed at entry, as with the MP
+  // services of CpuMpPei depending on it, there is no pre-memory phase and
+  // the run from here is the post-memory one.
+  //
+  Status = PeiServicesLocatePpi (
+             &gEfiPeiMemoryDiscoveredPpiGuid,
+             0,
+             NULL,
+             &MemoryDiscovered
+             );
+  ZeroMem (&Run, sizeof (Run));
+  PeiMp2ResultBegin (&Run, EFI_ERROR (Status) ? PeiMp2BenchmarkPreMemory : PeiMp2BenchmarkPostMemory);
+  PeiMp2PerCpuBuild (&Run);
+
+  Workload = SelectWorkload (&Run, &WorkloadStorage);
 
-  TestAPIEnableDisableAP ();
+  //
+  // FPDT records of the two API tests, DEBUG output included.
+  //
+  PERF_INMODULE_BEGIN ("PeiMp2StartupAllCPUs");
+  TestAPIStartAllCPU (&Run, Workload);
+  PERF_INMODULE_END ("PeiMp2StartupAllCPUs");
+
+  PERF_INMODULE_BEGIN ("PeiMp2EnableDisableAP");
+  TestAPIEnableDisableAP (&Run, Workload);
+  PERF_INMODULE_END ("PeiMp2EnableDisableAP");
+
+  TestStackUsage (&Run, Workload);
+
+  if (EFI_ERROR (Status)) {
+    TestPhaseBenchmark (&Run, "pre-memory");
+    Status = PeiServicesNotifyPpi (&mMemoryDiscoveredNotifyList);
+    ASSERT_EFI_ERROR (Status);
+  } else {
+    PEI_MP2_REPORT (&Run, (DEBUG_INFO, "Memory is already installed, no pre-memory MP benchmark.\n"));
+    TestPhaseBenchmark (&Run, "post-memory");
+  }
 
   DEBUG((DEBUG_INFO, "Edkii Pei Mp Services2 Ppi test End!\n"));
   DEBUG((DEBUG_INFO, "=========================================\n"));